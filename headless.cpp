@@ -0,0 +1,3 @@
+#include <fractal/fractal.hpp>
+
+int main(int argc, char **argv) { return frac::headless::run(argc, argv); }
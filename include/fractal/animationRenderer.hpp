@@ -0,0 +1,159 @@
+#pragma once
+
+namespace frac {
+	/// Renders a zoom animation from one view to another and streams the frames to a
+	/// file handle (usually stdout) as YUV4MPEG2 or a sequence of binary PPM images,
+	/// ready to be piped straight into a video encoder.
+	///
+	/// The size of the view shrinks geometrically, so the zoom speed is constant, and
+	/// the center moves in proportion to the zoom so the end point stays fixed on
+	/// screen. Frames are iterated one after another with the regular FractalRenderer,
+	/// which keeps the iteration data rather than colouring it. Each frame's data is
+	/// coloured, downsampled, converted and written on a separate thread while the
+	/// next frame iterates.
+	///
+	/// Anti-aliasing is done by rendering each frame at antiAlias times the output size
+	/// and box-filtering it down, so every sample is a single pixel of the internal
+	/// image. The previous frame's iteration data is reprojected onto each new frame
+	/// before it is iterated. A sample that lands on a sample of the previous frame (to
+	/// within 1e-6 of a sample) is copied, which is exact. Every other sample is
+	/// iterated, unless interpolation is enabled (see setInterpolatedReuse). Colourings
+	/// that keep no iteration data (distance estimation) are taken from the surface
+	/// instead, and reuse nothing.
+	class AnimationRenderer {
+	public:
+		enum class Format {
+			Y4M, // YUV4MPEG2, 4:4:4 chroma, BT.601 limited range
+			PPM	 // Concatenated binary PPM (P6) images
+		};
+
+		/// A position along the animation path
+		struct View {
+			HighVec2 center;	  // Fractal-space center of the frame
+			HighPrecision height; // Fractal-space height of the frame
+		};
+
+		AnimationRenderer()										= delete;
+		AnimationRenderer(const AnimationRenderer &)			= delete;
+		AnimationRenderer(AnimationRenderer &&)					= delete;
+		AnimationRenderer &operator=(const AnimationRenderer &) = delete;
+		AnimationRenderer &operator=(AnimationRenderer &&)		= delete;
+
+		/// Construct an animation between two views. The output size, anti-aliasing and
+		/// fractal settings are taken from the renderer's current configuration
+		/// \param renderer Configured renderer
+		/// \param start First frame of the animation
+		/// \param end Last frame of the animation
+		/// \param frames Total number of frames (at least 1)
+		AnimationRenderer(FractalRenderer &renderer, const View &start, const View &end,
+						  int64_t frames);
+
+		/// The number of doublings of the zoom between two heights
+		/// \param from Starting height
+		/// \param to Final height
+		/// \return Number of octaves (negative when zooming out)
+		LIBRAPID_NODISCARD static double octavesBetween(const HighPrecision &from,
+														const HighPrecision &to);
+
+		/// Zoom a height in by a number of octaves. Whole octaves are applied exactly
+		/// \param height Starting height
+		/// \param octaves Number of doublings of the zoom (negative to zoom out)
+		/// \return New height
+		LIBRAPID_NODISCARD static HighPrecision zoomHeight(const HighPrecision &height,
+														   double octaves);
+
+		/// The view at a given frame
+		/// \param frame Frame index
+		/// \return View
+		LIBRAPID_NODISCARD View frameView(int64_t frame) const;
+
+		/// Write the stream header for a format (only YUV4MPEG2 has one)
+		/// \param output Destination
+		/// \param format Output format
+		/// \param size Frame size in pixels
+		/// \param fps Frame rate
+		/// \return True on success
+		static bool writeStreamHeader(std::FILE *output, Format format,
+									  const lrc::Vec2i &size, int64_t fps);
+
+		/// Write a single frame of tightly packed RGB8 pixels
+		/// \param rgb Pixel data (width * height * 3 bytes)
+		/// \param width Frame width in pixels
+		/// \param height Frame height in pixels
+		/// \param output Destination
+		/// \param format Output format
+		/// \return True on success
+		static bool writeImage(const uint8_t *rgb, int64_t width, int64_t height,
+							   std::FILE *output, Format format);
+
+		/// Enable or disable reprojecting the iteration data of the previous frame
+		/// \param reuse True to reuse samples
+		void setSampleReuse(bool reuse);
+
+		/// Also interpolate samples that land between four samples of the previous
+		/// frame with the same iteration count. This assumes nothing is hidden between
+		/// them, so the frames are an approximation. So that anything that was hidden
+		/// still appears, samples are only interpolated from interpolated samples a few
+		/// times in a row before they are iterated again. Disabled by default
+		/// \param interpolate True to interpolate samples
+		void setInterpolatedReuse(bool interpolate);
+
+		/// Render every frame and write it to \p output
+		/// \param output Destination (must be opened in binary mode)
+		/// \param format Output format
+		/// \param fps Frame rate written to the Y4M header
+		/// \return True if every frame was written
+		bool render(std::FILE *output, Format format, int64_t fps);
+
+	private:
+		/// A rendered frame at the internal (supersampled) resolution
+		struct Frame {
+			HighVec2 topLeft;	 // Fractal-space position of pixel (0, 0)
+			HighVec2 step;		 // Fractal-space size of a single pixel
+			int64_t width;		 // Internal width in pixels
+			int64_t height;		 // Internal height in pixels
+			RenderHandle render; // The job the frame was iterated by
+
+			// Iteration data of every pixel, and the number of interpolations in a row
+			// behind each one (zero if it was iterated). Without iteration data, the
+			// frame is kept as tightly packed RGB8 pixels instead
+			IterationBuffer samples;
+			std::vector<uint8_t> generations;
+			std::vector<uint8_t> pixels;
+		};
+
+		/// Reproject the iteration data of the previous frame onto the renderer's
+		/// current view, copying coincident samples and, if enabled, interpolating the
+		/// rest where their neighbours agree
+		/// \param previous The previous frame, which must have iteration data
+		/// \param mask Output mask of reused pixels (see FractalRenderer::setKnownPixels)
+		/// \param samples Output iteration data of the reused pixels
+		/// \param generations Output interpolations behind each pixel (see Frame)
+		/// \return Number of pixels reused
+		int64_t seedFromPrevious(const Frame &previous, std::vector<uint8_t> &mask,
+								 IterationBuffer &samples,
+								 std::vector<uint8_t> &generations) const;
+
+		/// Colour the iteration data of a frame with the colouring of its job
+		/// \param frame The frame, which must have iteration data
+		/// \param pixels Output tightly packed RGB8 pixels
+		static void colorFrame(const Frame &frame, std::vector<uint8_t> &pixels);
+
+		/// Colour a frame if needed, then downsample it to the output size and write it
+		/// \param frame The frame to write
+		/// \param output Destination
+		/// \param format Output format
+		/// \return True on success
+		bool writeFrame(const Frame &frame, std::FILE *output, Format format) const;
+
+		FractalRenderer &m_renderer;
+		View m_start;
+		View m_end;
+		int64_t m_frames;
+		double m_octavesPerFrame;
+		bool m_reuse		  = true;
+		bool m_interpolate	  = false; // See setInterpolatedReuse
+		int64_t m_supersample = 1;
+		lrc::Vec2i m_outputSize;
+	};
+} // namespace frac
@@ -0,0 +1,63 @@
+#pragma once
+
+namespace frac {
+	/// A single render in a batch
+	struct BatchJob {
+		std::string settings; // Settings file, as written by exportSettings
+		std::string output;	  // Output image path
+	};
+
+	/// Runs many renders through one persistent thread pool. Each job gets its own
+	/// FractalRenderer and a driver thread for its single-threaded work (loading
+	/// settings, allocating the surface and exporting the image), while the render
+	/// boxes of every job share the pool. Boxes from the next job fill in the tail of
+	/// the previous one, and one job's setup or export overlaps with the others'
+	/// rendering, so the cores are kept busy. The number of jobs in flight (and so the
+	/// number of surfaces in memory) is bounded.
+	class BatchRunner {
+	public:
+		BatchRunner()								= delete;
+		BatchRunner(const BatchRunner &)			= delete;
+		BatchRunner(BatchRunner &&)					= delete;
+		BatchRunner &operator=(const BatchRunner &) = delete;
+		BatchRunner &operator=(BatchRunner &&)		= delete;
+
+		/// Construct a batch runner
+		/// \param numThreads Number of render threads in the shared pool
+		/// \param maxInFlight Maximum number of jobs loaded at once
+		BatchRunner(int64_t numThreads, int64_t maxInFlight);
+
+		/// Load a job file. This is a JSON array of objects with "settings" and
+		/// "output" paths, which are relative to the job file's directory
+		/// \param path Path to the job file
+		/// \param jobs Output list of jobs
+		/// \return True on success
+		static bool loadJobFile(const std::string &path, std::vector<BatchJob> &jobs);
+
+		/// Run every job, printing per-job and aggregate throughput
+		/// \param jobs The jobs to run
+		/// \return True if every job succeeded
+		bool run(const std::vector<BatchJob> &jobs);
+
+	private:
+		struct JobResult {
+			bool success	  = false;
+			int64_t pixels	  = 0; // Number of pixels in the image
+			double setupTime  = 0; // Loading settings and allocating the surface
+			double renderTime = 0; // Queueing the first box to the last one finishing
+			double exportTime = 0; // Writing the image
+		};
+
+		/// Load, render and export a single job
+		/// \param job The job to run
+		/// \return Statistics for the job
+		JobResult runJob(const BatchJob &job);
+
+		ThreadPool m_threadPool;
+		int64_t m_maxInFlight;
+
+		std::mutex m_mutex; // Guards everything below
+		std::condition_variable m_slotFree;
+		int64_t m_inFlight = 0;
+	};
+} // namespace frac
@@ -5,6 +5,9 @@ namespace frac {
 	public:
 		using ColorType = lrc::Vec<float, 4>;
 
+		/// Number of lookup table entries between consecutive palette colours
+		static constexpr int64_t lookupResolution = 256;
+
 		ColorPalette()								  = default;
 		ColorPalette(const ColorPalette &)			  = default;
 		ColorPalette(ColorPalette &&)				  = default;
@@ -36,7 +39,21 @@ namespace frac {
 		/// \return The interpolated colour
 		static ColorType merge(const ColorType &a, const ColorType &b, float t);
 
+		/// Rebuild the interpolated lookup table used by lookup. This is called by
+		/// addColor, but must be called manually after changing a colour through the
+		/// non-const indexing operator
+		void updateLookupTable();
+
+		/// Get the colour at a fractional position in the palette, wrapping around at
+		/// the end. This matches merging colours floor(position) and floor(position) + 1
+		/// (see merge), quantised to 1 / lookupResolution, for the cost of a single
+		/// table lookup
+		/// \param position Position in the palette
+		/// \return The interpolated colour
+		LIBRAPID_NODISCARD const ColorType &lookup(float position) const;
+
 	private:
 		std::vector<ColorType> m_colors;
+		std::vector<ColorType> m_lookupTable; // Interpolated colours (see lookup)
 	};
 } // namespace frac
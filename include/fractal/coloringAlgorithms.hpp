@@ -6,6 +6,28 @@ namespace frac::coloring {
 	using ColorFuncHigh = std::function<ci::ColorA(const lrc::Complex<HighPrecision> &,
 												   int64_t, const ColorPalette &)>;
 
+	/// Approximate log2 of a positive, normal float. The absolute error is below 1.2e-4,
+	/// which is far finer than a palette lookup can resolve
+	/// \param value Input value
+	/// \return Approximately log2(value)
+	inline float fastLog2(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		// Split into the exponent and a mantissa in [0, 1), then fit log2(1 + m)
+		const auto exponent = (float)((int32_t)((bits >> 23) & 0xFF) - 127);
+		bits				= (bits & 0x007FFFFF) | 0x3F800000;
+		float mantissa;
+		std::memcpy(&mantissa, &bits, sizeof(mantissa));
+		mantissa -= 1.0f;
+
+		float poly = -0.0828606983f;
+		poly	   = poly * mantissa + 0.321879707f;
+		poly	   = poly * mantissa - 0.677743267f;
+		poly	   = poly * mantissa + 1.43863803f;
+		return exponent + poly * mantissa;
+	}
+
 	template<typename Precision>
 	ci::ColorA logarithmicScaling(const lrc::Complex<Precision> &coord, int64_t iters,
 								  const ColorPalette &palette) {
@@ -26,12 +48,10 @@ namespace frac::coloring {
 
 		float escapeTime = (float)coord.real() * (float)coord.real() +
 							(float)coord.imag() * (float)coord.imag();
-		float smoothValue = iters + 1 - log2(log2(escapeTime));
+		float smoothValue = iters + 1 - fastLog2(fastLog2(escapeTime));
 
 		float s1 = smoothValue + 4;
-		Col color1 = palette[static_cast<size_t>(s1) % palette.size()];
-		Col color2 = palette[(static_cast<size_t>(s1) + 1) % palette.size()];
-		Col merged = ColorPalette::merge(color1, color2, lrc::mod(s1, 1.0f));
+		const Col &merged = palette.lookup(s1);
 		return {merged.x(), merged.y(), merged.z(), 1};
 	}
 
@@ -48,4 +68,27 @@ namespace frac::coloring {
 		auto col = palette[iters % palette.size()];
 		return {col.x(), col.y(), col.z(), 1};
 	}
+
+	/// Name of the distance estimation colouring mode. It is offered for every fractal
+	/// that supports optimisations::DISTANCE_ESTIMATION
+	constexpr const char *distanceEstimation = "Distance Estimation";
+
+	/// Estimated distance from the boundary, in pixels, at which distance estimation
+	/// colouring reaches the last colour of the palette
+	constexpr double distanceSaturation = 64;
+
+	/// Colour a point outside the set by its estimated distance to the boundary. The
+	/// palette is traversed once, logarithmically, from the boundary out to
+	/// distanceSaturation pixels away
+	/// \param pixels Estimated distance to the boundary, in pixels
+	/// \param palette Palette to colour with
+	/// \return Colour of the point
+	inline ci::ColorA distanceColor(double pixels, const ColorPalette &palette) {
+		const double scale		= palette.size() > 1 ? (double)(palette.size() - 1) : 1;
+		const double saturation = std::log2(1 + distanceSaturation);
+		const double position =
+		  std::min(std::log2(1 + std::max(pixels, 0.0)), saturation) / saturation;
+		const auto &color = palette.lookup((float)(position * scale));
+		return {color.x(), color.y(), color.z(), 1};
+	}
 } // namespace frac::coloring
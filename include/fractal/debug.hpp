@@ -25,7 +25,8 @@ namespace frac {
 		DebugLogger &operator=(const DebugLogger &) = delete;
 		DebugLogger &operator=(DebugLogger &&)		= delete;
 
-		/// Create a new DebugLogger instance from a filename
+		/// Create a new DebugLogger instance from a filename. The file is only created
+		/// (and truncated) when the first message is written
 		/// \param filename
 		explicit DebugLogger(const std::string &filename,
 							 Priority priority = Priority::Info);
@@ -33,6 +34,11 @@ namespace frac {
 		/// Close the file stream on destruction
 		~DebugLogger();
 
+		/// Close the current log file and write any further messages to \p filename.
+		/// An empty filename disables file logging
+		/// \param filename The new log file
+		void setFilename(const std::string &filename);
+
 		/// Set the priority level of the debugger's logs. Higher priorities will be
 		/// logged in release mode, while lower priorities will only be logged in debug
 		/// mode
@@ -48,7 +54,15 @@ namespace frac {
 				   const std::string &filename, int64_t line);
 
 	private:
+		/// Open the log file and write the header
+		void open();
+
+		/// Write the footer and close the log file, if it is open
+		void close();
+
+		std::string m_filename;				  // Log file, or empty to disable logging
 		std::fstream m_log;					  // File stream
+		std::mutex m_mutex;					  // Guards the file stream
 		double m_startTime;					  // Time at which the logger was created
 		Priority m_priority = Priority::Info; // Priority level of the logger
 	};
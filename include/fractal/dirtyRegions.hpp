@@ -0,0 +1,47 @@
+#pragma once
+
+namespace frac {
+	/// Regions of an image that have changed since they were last consumed. Any number
+	/// of threads may mark regions at once without locking, while one thread consumes
+	/// them. Checking for changes is a single atomic load, so polling an unchanged
+	/// image costs nothing
+	class DirtyRegionList {
+	public:
+		DirtyRegionList()									= default;
+		DirtyRegionList(const DirtyRegionList &)			= delete;
+		DirtyRegionList(DirtyRegionList &&)					= delete;
+		DirtyRegionList &operator=(const DirtyRegionList &)	= delete;
+		DirtyRegionList &operator=(DirtyRegionList &&)		= delete;
+
+		~DirtyRegionList();
+
+		/// Add a region to the list. This is safe to call from any thread
+		/// \param region The region that changed
+		void mark(const SurfaceRegion &region);
+
+		/// Whether any regions have been marked since the list was last consumed
+		/// \return True if no regions are waiting
+		LIBRAPID_NODISCARD bool empty() const;
+
+		/// Take every region marked so far, leaving the list empty. Only one thread may
+		/// consume or clear the list at a time
+		/// \param regions Vector the regions are appended to, in the order marked
+		/// \return Number of regions appended
+		size_t consume(std::vector<SurfaceRegion> &regions);
+
+		/// Discard every region marked so far
+		void clear();
+
+	private:
+		struct Node {
+			SurfaceRegion region;
+			Node *next;
+		};
+
+		/// Take the whole list, leaving it empty
+		/// \return The most recently marked node, or nullptr
+		Node *take();
+
+		std::atomic<Node *> m_head {nullptr}; // Most recently marked region
+	};
+} // namespace frac
@@ -0,0 +1,82 @@
+#pragma once
+
+namespace frac {
+	/// A single unit of work handed to a worker process: a band of rows of the full
+	/// image
+	struct TileJob {
+		int64_t id;		  // Index of the job (jobs are written out in this order)
+		int64_t firstRow; // First image row covered by the job
+		int64_t rows;	  // Number of rows in the job
+	};
+
+	/// Splits a render into band jobs and farms them out to worker processes (the
+	/// headless renderer started in "worker" mode) over pipes. Each job is sent as a
+	/// complete settings object, in the same format as exportSettings, so worker
+	/// processes see the exact high-precision coordinates of their band. Finished bands
+	/// are reassembled in order and streamed to an ImageStreamWriter. If a worker dies,
+	/// its job is re-queued and a replacement worker is started.
+	///
+	/// This is only available on POSIX systems.
+	class DistributedRenderer {
+	public:
+		DistributedRenderer()										= delete;
+		DistributedRenderer(const DistributedRenderer &)			= delete;
+		DistributedRenderer(DistributedRenderer &&)					= delete;
+		DistributedRenderer &operator=(const DistributedRenderer &) = delete;
+		DistributedRenderer &operator=(DistributedRenderer &&)		= delete;
+
+		/// Construct a coordinator for the full image described by \p renderer
+		/// \param renderer Configured renderer describing the full image
+		/// \param executable Path to the headless renderer executable
+		/// \param numWorkers Number of worker processes to run
+		/// \param threadsPerWorker Render threads used by each worker
+		/// \param rowsPerJob Number of image rows in each job
+		DistributedRenderer(FractalRenderer &renderer, std::string executable,
+							int64_t numWorkers, int64_t threadsPerWorker,
+							int64_t rowsPerJob);
+
+		~DistributedRenderer();
+
+		/// Render the full image, starting from the first row not yet present in
+		/// \p writer
+		/// \param writer Destination for the rendered rows
+		/// \return True if the full image was written
+		bool render(ImageStreamWriter &writer);
+
+		/// Serve jobs sent by a coordinator on stdin, writing the results to stdout,
+		/// until stdin is closed
+		/// \return Process exit code
+		static int runWorker();
+
+	private:
+		struct Worker {
+			int64_t pid		 = -1; // Process ID (-1 if not running)
+			int toWorker	 = -1; // Write end of the worker's stdin
+			int fromWorker	 = -1; // Read end of the worker's stdout
+			int64_t job		 = -1; // Job currently assigned to the worker
+			int64_t jobsDone = 0;  // Number of jobs completed by this worker
+		};
+
+		/// Start a new worker process
+		/// \param worker Worker slot to fill
+		/// \return True on success
+		bool spawnWorker(Worker &worker);
+
+		/// Close a worker's pipes and reap the process
+		/// \param worker The worker to stop
+		/// \param force Send SIGKILL before waiting
+		void stopWorker(Worker &worker, bool force);
+
+		/// Build the settings object describing a single job
+		/// \param job The job
+		/// \return Serialised job
+		std::string serialiseJob(const TileJob &job);
+
+		FractalRenderer &m_renderer;
+		std::string m_executable;
+		int64_t m_numWorkers;
+		int64_t m_threadsPerWorker;
+		int64_t m_rowsPerJob;
+		std::vector<Worker> m_workers;
+	};
+} // namespace frac
@@ -0,0 +1,85 @@
+#pragma once
+
+namespace frac {
+	/// Renders an entire zoom sequence as a single exponential map (log-polar strip)
+	/// and synthesises the frames from it.
+	///
+	/// Each column of the strip is an angle around the zoom center, and each row is a
+	/// logarithmic radius, with the row spacing equal to the angular spacing so
+	/// samples are square. Zooming in by a constant factor is then just a vertical
+	/// shift through the strip. The strip is iterated once with the fractal's regular
+	/// kernels (through FractalRenderer::pixelColorLow/High), after which each frame
+	/// is a cheap, parallel bilinear resampling of it.
+	///
+	/// The strip is sized so samples at the corners of the frame are antiAlias times
+	/// denser than output pixels. Samples toward the center are denser still. Unlike
+	/// AnimationRenderer, the zoom must be about a single fixed point, and frames are
+	/// resampled rather than rendered, so they are slightly softer than a direct
+	/// render.
+	class ExpMapRenderer {
+	public:
+		ExpMapRenderer()								  = delete;
+		ExpMapRenderer(const ExpMapRenderer &)			  = delete;
+		ExpMapRenderer(ExpMapRenderer &&)				  = delete;
+		ExpMapRenderer &operator=(const ExpMapRenderer &) = delete;
+		ExpMapRenderer &operator=(ExpMapRenderer &&)	  = delete;
+
+		/// Construct an exponential map covering a zoom from \p startHeight down to
+		/// \p endHeight about \p center. The output size, anti-aliasing factor and
+		/// thread count are taken from the renderer's current configuration
+		/// \param renderer Configured renderer
+		/// \param center Fractal-space zoom center
+		/// \param startHeight Fractal-space height of the first frame
+		/// \param endHeight Fractal-space height of the last frame
+		ExpMapRenderer(FractalRenderer &renderer, const HighVec2 &center,
+					   const HighPrecision &startHeight, const HighPrecision &endHeight);
+
+		/// Number of angular samples (columns) in the strip
+		/// \return Strip width
+		LIBRAPID_NODISCARD int64_t stripWidth() const;
+
+		/// Number of radial samples (rows) in the strip
+		/// \return Strip height
+		LIBRAPID_NODISCARD int64_t stripHeight() const;
+
+		/// Iterate every sample of the strip. Row 0 is the outermost radius
+		void renderStrip();
+
+		/// Save the strip as an image, mainly for inspection
+		/// \param path Output path (.ppm for PPM, anything else for raw RGB8)
+		/// \return True on success
+		bool saveStrip(const std::string &path) const;
+
+		/// Synthesise a single frame from the strip
+		/// \param octaves Zoom depth of the frame, in doublings from the first frame
+		/// \param out Destination for tightly packed RGB8 pixels (resized to fit)
+		void reproject(double octaves, std::vector<uint8_t> &out);
+
+		/// Render the strip (if it has not been rendered yet), then synthesise every
+		/// frame and write it to \p output
+		/// \param output Destination (must be opened in binary mode)
+		/// \param format Output format
+		/// \param frames Number of frames, evenly spaced in zoom depth
+		/// \param fps Frame rate written to the Y4M header
+		/// \return True if every frame was written
+		bool render(std::FILE *output, AnimationRenderer::Format format, int64_t frames,
+					int64_t fps);
+
+	private:
+		FractalRenderer &m_renderer;
+		HighVec2 m_center;
+		lrc::Vec2i m_outputSize;
+		HighPrecision m_startStep; // Fractal-space size of a pixel in the first frame
+		double m_octaves;		   // Total zoom depth in doublings
+
+		// Radii are stored as the natural log of the radius measured in pixels of the
+		// first frame, so they stay representable at any depth
+		double m_logRadiusMax; // Radius of the first row
+		double m_rowStep;	   // Decrease in log radius per row
+		int64_t m_stripWidth;
+		int64_t m_stripHeight;
+
+		std::vector<uint8_t> m_strip; // Tightly packed RGB8, empty until rendered
+		ThreadPool m_threadPool;
+	};
+} // namespace frac
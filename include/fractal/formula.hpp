@@ -0,0 +1,126 @@
+#pragma once
+
+#include <fractal/genericFractal.hpp>
+
+namespace frac {
+	namespace formula {
+		/// Operations of the formula bytecode. Every register holds a complex number
+		enum class Op : uint8_t {
+			Add,	// dst = a + b
+			Sub,	// dst = a - b
+			Mul,	// dst = a * b
+			Div,	// dst = a / b
+			Neg,	// dst = -a
+			Square, // dst = a * a
+			Conj,	// dst = conj(a)
+			Fold,	// dst = |re(a)| + i |im(a)|, as used by the Burning Ship
+			Real,	// dst = re(a)
+			Imag,	// dst = im(a)
+			Abs		// dst = |a|
+		};
+
+		/// A single instruction of a compiled formula
+		struct Instruction {
+			Op op;
+			uint8_t dst; // Destination register
+			uint8_t a;	 // First operand register
+			uint8_t b;	 // Second operand register, if the operation takes one
+		};
+
+		constexpr uint8_t zRegister	   = 0;	 // Holds the current value of z
+		constexpr uint8_t cRegister	   = 1;	 // Holds the coordinate being iterated
+		constexpr int64_t maxRegisters = 32; // Registers available to a formula
+
+		/// A formula compiled to register bytecode. Each subexpression is written to a
+		/// register of its own, so no instruction overwrites its operands
+		struct Program {
+			// Constants, loaded into their registers before the code is first run
+			std::vector<std::pair<uint8_t, lrc::Complex<LowPrecision>>> constants;
+			std::vector<Instruction> code;
+			uint8_t result		 = zRegister; // Register holding the formula's value
+			int64_t numRegisters = 2;		  // Registers used, including z and c
+		};
+
+		/// Compile a formula in z and c, such as "z = z^2 + c". The formula may use
+		/// + - * / and ^ (with a non-negative integer exponent), parentheses, real
+		/// numbers, imaginary numbers such as 2i (or i alone), and the functions
+		/// conj, fold, re, im and abs. A leading "z =" is optional
+		/// \param source The formula
+		/// \param program Set to the compiled formula
+		/// \param error Set to a description of the problem if the formula is invalid
+		/// \return True if the formula was compiled
+		bool compile(const std::string &source, Program &program, std::string &error);
+	} // namespace formula
+
+	/*
+	 * An escape-time fractal defined by a formula in the settings file, rather than by
+	 * a subclass of Fractal. z starts at the value of the "initial" formula and is
+	 * replaced by the value of the "formula" formula until it escapes. Coordinates are
+	 * iterated in batches of lanes, so each instruction is dispatched once for many
+	 * coordinates (see optimisations::BATCHED_ITERATION)
+	 */
+
+	class FormulaFractal : public Fractal {
+	public:
+		/// Constructor taking a RenderConfig object. The formula is z = z^2 + c, starting
+		/// from 0, until another is set
+		/// \param config RenderConfig object
+		explicit FormulaFractal(const RenderConfig &config);
+		FormulaFractal(const FormulaFractal &)			  = delete;
+		FormulaFractal(FormulaFractal &&)				  = delete;
+		FormulaFractal &operator=(const FormulaFractal &) = delete;
+		FormulaFractal &operator=(FormulaFractal &&)	  = delete;
+
+		~FormulaFractal() override = default;
+
+		/// Read the "formula" and "initial" entries of the fractal's settings
+		/// \param settings The fractal's entry in the settings file
+		void configure(const json &settings) override;
+
+		/// Compile and use a new formula. If either formula is invalid, an error is
+		/// logged and the current formulas are kept
+		/// \param step Formula for the next value of z
+		/// \param initial Formula for the starting value of z
+		/// \return True if both formulas were compiled
+		bool setFormula(const std::string &step, const std::string &initial);
+
+		LIBRAPID_NODISCARD size_t supportedOptimisations() const override;
+
+		LIBRAPID_NODISCARD std::string name() const override;
+
+		LIBRAPID_NODISCARD bool isEscapeTime() const override;
+
+		LIBRAPID_NODISCARD
+		std::unordered_map<std::string, coloring::ColorFuncLow>
+		getLowPrecColoringAlgorithms() const override;
+
+		LIBRAPID_NODISCARD
+		std::unordered_map<std::string, coloring::ColorFuncHigh>
+		getHighPrecColoringAlgorithms() const override;
+
+		LIBRAPID_NODISCARD std::pair<int64_t, lrc::Complex<LowPrecision>>
+		iterCoordLow(const lrc::Complex<LowPrecision> &coord) const override;
+
+		void
+		iterCoordsLow(const lrc::Complex<LowPrecision> *coords, int64_t count,
+					  std::pair<int64_t, lrc::Complex<LowPrecision>> *results)
+		  const override;
+
+		LIBRAPID_NODISCARD std::pair<int64_t, lrc::Complex<HighPrecision>>
+		iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const override;
+
+		LIBRAPID_NODISCARD ci::ColorA
+		getColorLow(const lrc::Complex<LowPrecision> &coord, int64_t iters,
+					const ColorPalette &palette,
+					const coloring::ColorFuncLow &colorFunc) const override;
+
+		LIBRAPID_NODISCARD ci::ColorA
+		getColorHigh(const lrc::Complex<HighPrecision> &coord, int64_t iters,
+					 const ColorPalette &palette,
+					 const coloring::ColorFuncHigh &colorFunc) const override;
+
+	private:
+		formula::Program m_step;	// Next value of z
+		formula::Program m_initial; // Starting value of z
+	};
+} // namespace frac
@@ -3,6 +3,15 @@
 #include <cinderbox/cinderbox.hh>
 #include <librapid>
 #include <fstream>
+#include <filesystem>
+#include <deque>
+#include <map>
+#include <cstring>
+#include <list>
+#include <future>
+#include <atomic>
+#include <random>
+#include <condition_variable>
 #include <nlohmann/json.hpp>
 #include <BS_thread_pool.hpp>
 
@@ -25,13 +34,30 @@ namespace frac {
 
 #include <fractal/debug.hpp>
 #include <fractal/colorPalette.hpp>
+#include <fractal/paletteRegistry.hpp>
 #include <fractal/coloringAlgorithms.hpp>
+#include <fractal/histogramColoring.hpp>
 #include <fractal/openglUtils.hpp>
 #include <fractal/renderConfig.hpp>
+#include <fractal/dirtyRegions.hpp>
+#include <fractal/topology.hpp>
+#include <fractal/highPrecision.hpp>
 #include <fractal/genericFractal.hpp>
 #include <fractal/mandelbrot.hpp>
 #include <fractal/juliaSet.hpp>
 #include <fractal/newton.hpp>
+#include <fractal/formula.hpp>
+#include <fractal/multibrot.hpp>
+#include <fractal/renderKernels.hpp>
+#include <fractal/renderJob.hpp>
 #include <fractal/fractalRenderer.hpp>
 #include <fractal/history.hpp>
 #include <fractal/mainWindow.hpp>
+#include <fractal/imageStream.hpp>
+#include <fractal/streamRenderer.hpp>
+#include <fractal/distributedRenderer.hpp>
+#include <fractal/tileServer.hpp>
+#include <fractal/animationRenderer.hpp>
+#include <fractal/expMapRenderer.hpp>
+#include <fractal/batchRunner.hpp>
+#include <fractal/headless.hpp>
@@ -3,7 +3,10 @@
 namespace frac {
 	namespace optimisations {
 		constexpr size_t OUTLINE_OPTIMISATION = 0x000000000000001;
-	}
+		constexpr size_t DISTANCE_ESTIMATION  = 0x000000000000002;
+		constexpr size_t BOUNDARY_TRACING	 = 0x000000000000004;
+		constexpr size_t BATCHED_ITERATION	 = 0x000000000000008;
+	} // namespace optimisations
 
 	class FractalRenderer {
 	public:
@@ -22,6 +25,25 @@ namespace frac {
 		/// Stop the renderer gracefully and wait for all threads to rejoin main
 		void stopRender();
 
+		/// Block until every queued render box has been rendered
+		void waitForRender();
+
+		/// Render on a thread pool shared with other renderers, instead of this
+		/// renderer's own pool. Boxes from every renderer on the pool are interleaved,
+		/// and waitForRender only waits for this renderer's boxes. The pool must outlive
+		/// the renderer, and RenderConfig::numThreads is ignored while it is in use
+		/// \param pool The shared pool, or nullptr to use the internal pool again
+		void setSharedThreadPool(ThreadPool *pool);
+
+		/// Pin render threads to CPUs and keep each NUMA node's threads working on
+		/// their own horizontal band of the image. Worker w runs on node w % nodes, the
+		/// surface pages of each band are first touched by that node's workers after
+		/// the surface is regenerated, and a node only takes boxes from another band
+		/// once its own is exhausted. Placement is not used with a shared thread pool
+		/// \param nodes The topology to place threads on (see topology::detect), or an
+		/// empty list to let threads float freely
+		void setThreadPlacement(std::vector<topology::NumaNode> nodes);
+
 		/// Set the complex-valued coordinate of the top-left corner of the fractal and
 		/// its size
 		/// \param topLeft Top-left corner
@@ -39,8 +61,20 @@ namespace frac {
 
 		/// Render the fractal into the fractal surface, and copy that to the
 		/// fractal surface to be drawn. This will be executed on a separate thread
-		/// in order to keep the UI updating
-		void renderFractal();
+		/// in order to keep the UI updating. The current settings are captured as a
+		/// job (see captureJob), so they can be changed while the render runs. A render
+		/// that is still running is halted first. To run several renders at once, use
+		/// a renderer for each, sharing one pool (see setSharedThreadPool)
+		/// \param onProgress Called on a render thread each time a box finishes, or
+		/// nullptr
+		/// \return Handle for waiting on the render and following its progress
+		RenderHandle renderFractal(RenderProgressCallback onProgress = nullptr);
+
+		/// Capture the current settings as a job, with its own fractal instance. This
+		/// is done by renderFractal, and can be used to colour single points with the
+		/// pixelColor methods without a render
+		/// \return The job
+		LIBRAPID_NODISCARD std::shared_ptr<const RenderJob> captureJob();
 
 		/// Render a sub-section of the fractal, defined by the \p box variable. This is
 		/// intended to be used within the call queue to render multiple sections in
@@ -59,41 +93,154 @@ namespace frac {
 		///  - 3 -> Left
 		///
 		/// \param box
-		/// \param fractalOrigin
+		/// \param position
 		/// \param aliasFactor
-		/// \param step
-		/// \param aliasStepCorrect
 		/// \param inc
 		/// \param edge
 		/// \return
-		bool renderEdge(const RenderBox &box, const HighVec2 &fractalOrigin,
-						int64_t aliasFactor, const HighVec2 &step,
-						const HighVec2 &aliasStepCorrect, int64_t inc, int64_t edge);
+		bool renderEdge(const RenderBox &box, const BoxPosition &position,
+						int64_t aliasFactor, int64_t inc, int64_t edge);
 
 		/// Calculate the colour of a pixel at standard-precision. This implements
 		/// anti-aliasing as well
+		/// \param job The job the pixel belongs to
 		/// \param pixPos Pixel-space coordinate
 		/// \param aliasFactor Anti-aliasing factor
-		/// \param step Step size
-		/// \param aliasStepCorrect Anti-aliasing step correction
+		/// \param sampleStep Distance between anti-aliasing samples
+		/// \param samples Destination for the iteration data of each of the
+		/// aliasFactor * aliasFactor samples, in row-major order, or nullptr
 		/// \return Color of the pixel
-		ci::ColorA pixelColorLow(const LowVec2 &pixPos, int64_t aliasFactor,
-								 const LowVec2 &step, const LowVec2 &aliasStepCorrect);
+		ci::ColorA pixelColorLow(const RenderJob &job, const LowVec2 &pixPos,
+								 int64_t aliasFactor, const LowVec2 &sampleStep,
+								 IterationSample *samples = nullptr) const;
 
 		/// Calculate the colour of a pixel at high-precision. See pixelColorLow
+		/// \param job The job the pixel belongs to
 		/// \param pixPos Pixel-space coordinate
 		/// \param aliasFactor Anti-aliasing factor
-		/// \param step Step size
-		/// \param aliasStepCorrect Anti-aliasing step correction
+		/// \param sampleStep Distance between anti-aliasing samples
+		/// \param samples Destination for per-sample iteration data, or nullptr
 		/// \return Color of the pixel
 		/// \see pixelColorLow
-		ci::ColorA pixelColorHigh(const HighVec2 &pixPos, int64_t aliasFactor,
-								  const HighVec2 &step, const HighVec2 &aliasStepCorrect);
+		ci::ColorA pixelColorHigh(const RenderJob &job, const HighVec2 &pixPos,
+								  int64_t aliasFactor, const HighVec2 &sampleStep,
+								  IterationSample *samples = nullptr) const;
+
+		/// Render part of a row at standard precision, iterating the samples of every
+		/// pixel as a single batch (see Fractal::iterCoordsLow). This replaces
+		/// pixelColor for fractals that support optimisations::BATCHED_ITERATION
+		/// \param box The box containing the row
+		/// \param position Position of the box
+		/// \param py Row to render
+		/// \param firstX First pixel to render
+		/// \param lastX One past the last pixel to render
+		/// \param inc Distance between rendered pixels
+		/// \param aliasFactor Anti-aliasing factor
+		void renderRowLow(const RenderBox &box, const BoxPosition &position, int64_t py,
+						  int64_t firstX, int64_t lastX, int64_t inc,
+						  int64_t aliasFactor);
+
+		/// Calculate the colour of a pixel by its estimated distance to the boundary of
+		/// the set (see Fractal::distanceEstimateLow). Points with no exterior estimate
+		/// are coloured as part of the set
+		/// \param job The job the pixel belongs to
+		/// \param pixPos Pixel-space coordinate
+		/// \param aliasFactor Anti-aliasing factor
+		/// \param sampleStep Distance between anti-aliasing samples
+		/// \return Color of the pixel
+		ci::ColorA pixelColorDistance(const RenderJob &job, const LowVec2 &pixPos,
+									  int64_t aliasFactor,
+									  const LowVec2 &sampleStep) const;
+
+		/// Use distance estimates to skip work in full renders of fractals that support
+		/// optimisations::DISTANCE_ESTIMATION. Each box is split into blocks, and the
+		/// distance is estimated from the centre of each block. A block that is proven
+		/// to lie inside the set is filled without iterating its pixels. With distance
+		/// estimation colouring, a block far enough outside the set that every pixel
+		/// would get the last palette colour is filled too. Only double precision
+		/// renders are filled
+		/// \param fill True to enable the fill
+		void setDistanceFill(bool fill);
+
+		/// Render fractals that support optimisations::BOUNDARY_TRACING by tracing the
+		/// boundaries of regions of a single colour and filling them, rather than
+		/// computing every pixel (see traceBox). The fill can miss islands too small
+		/// for the probes to find, so the image is an approximation, and this is
+		/// disabled by default
+		/// \param trace True to enable boundary tracing
+		void setBoundaryTracing(bool trace);
+
+		/// When a full render spans the axis (or point) of symmetry of the fractal (see
+		/// Fractal::symmetry), only render the pixels that cannot be reflected from
+		/// the other side, then copy the rest in parallel. The reflection must map
+		/// samples exactly onto samples. Unless it also maps whole pixels onto pixels,
+		/// the iteration data must be kept (see setKeepIterationData) so the reflected
+		/// pixels can be coloured from their samples. Otherwise, every pixel is
+		/// rendered. This is enabled by default
+		/// \param mirror True to enable symmetry
+		void setSymmetry(bool mirror);
+
+		/// Number of pixels computed by the current (or last) render, as opposed to
+		/// being filled or skipped by an optimisation
+		/// \return Pixels computed
+		LIBRAPID_NODISCARD int64_t pixelsComputed() const;
+
+		/// Keep the iteration count and final magnitude of every sample of full
+		/// renders, so the image can be recoloured without iterating again (see
+		/// recolor). This costs 8 bytes per sample. Histogram-equalised colouring always
+		/// keeps this data, since it cannot colour the image without it
+		/// \param keep True to keep the data
+		void setKeepIterationData(bool keep);
+
+		/// Whether the iteration data of full renders is kept (see setKeepIterationData)
+		/// \return True if it is kept
+		LIBRAPID_NODISCARD bool keepIterationData() const;
+
+		/// Recolour the surface from the iteration data of the last render, using the
+		/// current colouring function and palette. Like renderFractal, this runs on the
+		/// render threads (see waitForRender)
+		/// \return False if there is no complete iteration data for the current image,
+		/// in which case the fractal must be rendered again
+		bool recolor();
+
+		/// Hand over the iteration data of the last full render, for example to colour
+		/// it on another thread (see colorSamples). The renderer keeps no copy, so it
+		/// cannot recolour the image afterwards. No render may be running
+		/// \return Every sample in row-major pixel order, with the samples of each pixel
+		/// together, or an empty buffer if there is no complete iteration data for the
+		/// current view
+		LIBRAPID_NODISCARD IterationBuffer takeIterationData();
+
+		/// Leave histogram-equalised renders uncoloured once they have been iterated,
+		/// for callers that colour the iteration data themselves (see
+		/// takeIterationData). Pixels are still written to the surface with the preview
+		/// colouring as they are computed
+		/// \param defer True to skip the colouring pass
+		void setDeferredColoring(bool defer);
+
+		/// Colour a run of samples from their iteration data, as the colouring pass
+		/// does. Only the job is read, so this can run on any thread while the renderer
+		/// moves on to the next job
+		/// \param job Job the samples were rendered by
+		/// \param samples First sample
+		/// \param count Number of samples
+		/// \param maxIters Maximum iteration count the samples were rendered with
+		/// \param histogram Finalised histogram of the samples' render, which is only
+		/// read for histogram-equalised jobs
+		/// \param out Destination for \p count colours
+		static void colorSamples(const RenderJob &job, const IterationSample *samples,
+								 int64_t count, int64_t maxIters,
+								 const coloring::IterationHistogram &histogram,
+								 ci::ColorA *out);
 
 		/// Update the render configuration of the internal fractal pointer
 		void updateRenderConfig();
 
-		void updateFractalType(const std::shared_ptr<Fractal> &fractal);
+		/// Change the fractal being rendered. Each job creates its own instance of it
+		/// (see createFractal)
+		/// \param name Name of the fractal
+		/// \param settings The fractal's entry in renderConfig.fractals
+		void updateFractalType(const std::string &name, const json &settings);
 
 		/// Ensure all values are using the highest precision possible
 		void updateConfigPrecision();
@@ -101,6 +248,40 @@ namespace frac {
 		/// Regenerate the surfaces and resize them to fit the image size
 		void regenerateSurface();
 
+		/// Start the next render from the displayed image, resampled so that a
+		/// rectangle of it fills the image, for example after zooming in. Any render
+		/// still running is stopped. The result is written to both buffers, so it is
+		/// shown until the render replaces it. Call this from the thread that calls
+		/// presentSurface
+		/// \param topLeft Top left pixel of the rectangle
+		/// \param bottomRight Bottom right pixel of the rectangle
+		void reprojectSurface(const lrc::Vec2i &topLeft, const lrc::Vec2i &bottomRight);
+
+		/// Copy the regions that render threads have finished writing since the last
+		/// call from the back buffer (see surface) to the front buffer. Regions are
+		/// published once no render thread will write to them again in the current
+		/// render, so the front buffer never shows a partly written region. If nothing
+		/// has changed, this neither locks nor copies anything
+		/// \param changed Set to the regions of the front buffer that changed since the
+		/// last call
+		/// \return True if any region changed
+		bool presentSurface(std::vector<SurfaceRegion> &changed);
+
+		/// The image to display while rendering, which is updated by presentSurface.
+		/// It must only be used on the thread that calls presentSurface
+		/// \return Surface
+		LIBRAPID_NODISCARD const ci::Surface &frontSurface() const;
+
+		/// Mark pixels that are already present in the surface (for example, copied from
+		/// an earlier render of the same samples), so renderFractal leaves them alone.
+		/// The mask is ignored if it does not match the image size
+		/// \param mask One byte per pixel in row-major order. Non-zero means known. Pass
+		/// an empty mask to render every pixel
+		/// \param samples Iteration data of the known pixels, laid out as
+		/// takeIterationData returns it, or empty. With it, the render still keeps
+		/// complete iteration data, and the entries of the other pixels are overwritten
+		void setKnownPixels(std::vector<uint8_t> mask, IterationBuffer samples = {});
+
 		/// Getter method for the render box time statistics
 		/// \return Statistics
 		LIBRAPID_NODISCARD RenderBoxTimeStats boxTimeStats() const;
@@ -141,23 +322,163 @@ namespace frac {
 		/// \return Settings object
 		LIBRAPID_NODISCARD json &settings();
 
-		/// Constant getter method for the internal surface
+		/// Constant getter method for the internal surface. This is the back buffer,
+		/// which render threads write to, so it only holds a complete image once
+		/// waitForRender returns. To display a render in progress, use frontSurface
 		/// \return Surface
 		LIBRAPID_NODISCARD const ci::Surface &surface() const;
 
-		/// Non-const getter method for the internal surface
+		/// Non-const getter method for the internal surface. See surface() const
 		/// \return Surface
 		LIBRAPID_NODISCARD ci::Surface &surface();
 
 		void exportImage(const std::string &path) const;
 		void exportSettings(const std::string &path) const;
 
+		/// Build the settings object written by exportSettings. All coordinates are
+		/// stored as strings so no precision is lost
+		/// \return Settings object
+		LIBRAPID_NODISCARD json exportSettingsJson() const;
+
 	private:
+		/// Look up the specialised kernels for the current fractal and colouring function
+		void selectKernels();
+
+		/// Find the position of a box of the current render
+		/// \param box The box
+		/// \param aliasFactor Anti-aliasing factor the box is rendered with
+		/// \return Position of the box
+		LIBRAPID_NODISCARD BoxPosition boxPosition(const RenderBox &box,
+												   int64_t aliasFactor) const;
+
+		/// Calculate the colour of a pixel with the precision selected for the current
+		/// render, using a specialised kernel if one exists. See pixelColorLow
+		/// \param position Position of the box containing the pixel
+		/// \param x Column of the pixel within the box
+		/// \param y Row of the pixel within the box
+		/// \param aliasFactor Anti-aliasing factor
+		/// \param samples Destination for per-sample iteration data, or nullptr
+		/// \return Color of the pixel
+		ci::ColorA pixelColor(const BoxPosition &position, int64_t x, int64_t y,
+							  int64_t aliasFactor, IterationSample *samples);
+
+		/// Name of the per-sample colouring function. This is the selected function,
+		/// except in histogram and distance estimation modes, where it is the one used
+		/// to preview boxes (and, for distance estimation, to colour high precision
+		/// renders)
+		/// \return Colouring function name
+		LIBRAPID_NODISCARD std::string sampleColorFuncName() const;
+
+		/// Render a box by boundary tracing. Pixels are scanned in order, and each one
+		/// that is still unknown starts a new region. The boundary of that region is
+		/// followed clockwise, computing pixels as they are needed, and the pixels it
+		/// encloses are then filled with its colour. Each run of pixels is checked for
+		/// islands of another colour before it is filled, by its computed neighbours and
+		/// a coarse grid of computed pixels. Runs containing an island are traced as new
+		/// regions instead. An island smaller than the grid that touches no computed
+		/// pixel can still be missed
+		/// \param box The box to render
+		/// \param position Position of the box
+		/// \param aliasFactor Anti-aliasing factor
+		void traceBox(const RenderBox &box, const BoxPosition &position,
+					  int64_t aliasFactor);
+
+		/// Whether a box of the current render may be filled from distance estimates
+		/// \param box The box
+		/// \return True if setDistanceFill applies to the box
+		LIBRAPID_NODISCARD bool distanceFillApplies(const RenderBox &box) const;
+
+		/// Try to fill a block of pixels from the distance estimate at its centre
+		/// \param box The box containing the block
+		/// \param position Position of the box
+		/// \param aliasFactor Anti-aliasing factor
+		/// \param topLeft Top left pixel of the block
+		/// \param bottomRight One past the bottom right pixel of the block
+		/// \return True if the block was filled, otherwise its pixels must be rendered
+		bool fillBlock(const RenderBox &box, const BoxPosition &position,
+					   int64_t aliasFactor, const lrc::Vec2i &topLeft,
+					   const lrc::Vec2i &bottomRight);
+
+		/// Where to store the iteration data of a pixel in the current render
+		/// \param px Pixel x coordinate
+		/// \param py Pixel y coordinate
+		/// \return Pointer to the pixel's samples, or nullptr if they are not stored
+		IterationSample *sampleSlot(int64_t px, int64_t py);
+
+		/// The pool renders are queued on
+		/// \return The shared pool if one is set, otherwise the internal pool
+		ThreadPool &activePool();
+
+		/// Render a single box from m_renderBoxes on the calling thread and mark it as
+		/// finished
+		/// \param index Index of the box
+		void renderQueuedBox(int64_t index);
+
+		/// Mark a queued task as finished. When the last box of a render finishes, the
+		/// reflected pixels are copied (see setSymmetry). Then the histogram is built
+		/// and, in histogram mode, the colouring pass is queued
+		void finishTask();
+
+		/// Wake threads waiting for the render, and resolve the future of the job's
+		/// handle. The caller must hold m_boxMutex
+		void finishJob();
+
+		/// Mark a region of the back buffer as ready to be presented. No render thread
+		/// may write to it again in the current render. This does not lock
+		/// \param topLeft Top left pixel of the region
+		/// \param dimensions Size of the region
+		void publishRegion(const lrc::Vec2i &topLeft, const lrc::Vec2i &dimensions);
+
+		/// Forget the regions waiting to be presented, before render threads write to
+		/// them again. They must all be published again
+		void discardPublished();
+
+		/// Decide which pixels of the current render can be reflected instead of
+		/// rendered, setting m_mirrorFrom and m_mirrorTo (see setSymmetry)
+		/// \return True if any pixels can be reflected
+		bool planMirror();
+
+		/// Queue the tasks that copy the reflected pixels. The caller must hold
+		/// m_boxMutex
+		/// \return Number of tasks queued
+		int64_t queueMirrorPass();
+
+		/// Copy the reflected pixels (and their iteration data) of some rows
+		/// \param firstRow First row to copy
+		/// \param lastRow One past the last row to copy
+		void mirrorRows(int64_t firstRow, int64_t lastRow);
+
+		/// Colour a single sample from its iteration data
+		/// \param job Job the sample was rendered by
+		/// \param sample The sample
+		/// \return Colour of the sample
+		LIBRAPID_NODISCARD static ci::ColorA sampleColor(const RenderJob &job,
+														 const IterationSample &sample);
+
+		/// Queue the tasks that colour the surface from the stored iteration data. The
+		/// caller must hold m_boxMutex
+		/// \return Number of tasks queued
+		int64_t queueColorPass();
+
+		/// Colour rows of the surface from the stored iteration data
+		/// \param firstRow First row to colour
+		/// \param lastRow One past the last row to colour
+		void colorRows(int64_t firstRow, int64_t lastRow);
+
+		/// Queue one worker per render thread, each pinned to a CPU and pulling boxes
+		/// from its own node's band first (see setThreadPlacement)
+		/// \param numBoxes Number of boxes in each direction
+		void queuePlacedWorkers(const lrc::Vec2i &numBoxes);
+
 		RenderConfig m_renderConfig;		// The settings for the fractal renderer
 		ci::Surface m_fractalSurface;		// The surface that the fractal is rendered to
+		ci::Surface m_frontSurface;			// Displayed copy (see presentSurface)
 		json m_settings;					// The settings for the fractal
 		std::shared_ptr<Fractal> m_fractal; // The fractal to render
+		std::string m_fractalName;			// Name the fractal was created from
+		json m_fractalSettings;				// Settings the fractal was created from
 		ThreadPool m_threadPool;			// Pool for render threads
+		ThreadPool *m_sharedPool = nullptr; // Used instead of m_threadPool if set
 
 		// Colouring functions for the fractal
 		coloring::ColorFuncLow m_colorFuncLow;
@@ -165,7 +486,60 @@ namespace frac {
 		std::string m_paletteName;
 		std::string m_colorFuncName;
 
+		// Specialised kernels for the fractal and colouring function, or nullptr
+		const kernels::KernelSet *m_kernels = nullptr;
+
+		// The job render threads read from, which is only replaced while none are
+		// running, and the progress of the job's handle until it finishes
+		std::shared_ptr<const RenderJob> m_job;
+		std::shared_ptr<RenderProgress> m_progress;
+
+		// Regions of the back buffer waiting to be presented, which render threads add
+		// to without locking. The mutex only stops them being discarded while they are
+		// copied. Regions of the front buffer changed other than by presenting (when
+		// it is reprojected or reallocated) are only used on the presenting thread
+		DirtyRegionList m_published;
+		std::mutex m_presentMutex;
+		std::vector<SurfaceRegion> m_frontChanged;
+
 		std::vector<RenderBox> m_renderBoxes; // The state of each render box
+		std::vector<uint8_t> m_knownPixels;	  // Pixels to skip (see setKnownPixels)
+
+		// Number of boxes from the current render that have not finished yet
+		int64_t m_boxesRemaining = 0;
+		std::mutex m_boxMutex;
+		std::condition_variable m_boxesFinished;
+
+		// Iteration data of every sample of the last full render (see recolor)
+		IterationBuffer m_samples;
+		coloring::IterationHistogram m_histogram;
+		int64_t m_sampleAlias	 = 1;	  // Samples per pixel along each axis
+		int64_t m_sampleMaxIters = 0;	  // maxIters of the render that filled m_samples
+		bool m_storeSamples		 = false; // The current render fills m_samples
+		bool m_samplesValid		 = false; // m_samples holds a complete render
+		bool m_iterating		 = false; // Boxes of the current render are still queued
+		bool m_keepIterationData = false; // See setKeepIterationData
+		bool m_histogramColoring = false; // Colour by histogram equalisation
+		bool m_knownSamples		 = false; // m_samples holds the known pixels' data
+		bool m_deferColoring	 = false; // See setDeferredColoring
+
+		std::vector<topology::NumaNode> m_numaNodes; // Empty unless threads are pinned
+		bool m_surfaceTouched = false;				 // Placed workers have touched it
+		bool m_samplesTouched = false;				 // Likewise for m_samples
+
+		bool m_distanceFill		= false; // See setDistanceFill
+		bool m_boundaryTracing	= false; // See setBoundaryTracing
+		bool m_symmetry			= true;	 // See setSymmetry
+		bool m_distanceColoring = false; // Colour by distance estimation
+
+		// Pixels of the current render that are reflected rather than rendered. Each
+		// sample index j along an axis is reflected onto m_mirrorSamples - j
+		Symmetry m_mirrorSymmetry = Symmetry::None;
+		lrc::Vec2i m_mirrorSamples;	  // Sample index each axis is reflected about
+		lrc::Vec2i m_mirrorFrom;	  // Top left reflected pixel
+		lrc::Vec2i m_mirrorTo;		  // One past the bottom right reflected pixel
+		bool m_mirrorAligned = false; // Whole pixels are reflected onto pixels
+		bool m_mirroring	 = false; // The reflected pixels are still to be copied
 
 		bool m_haltRender = false; // Used to gracefully stop the render threads
 	};
@@ -1,6 +1,36 @@
 #pragma once
 
 namespace frac {
+	/// Result of iterating a coordinate while tracking its derivative (see
+	/// Fractal::distanceEstimateLow)
+	struct DistanceEstimate {
+		int64_t iters;						 // Number of iterations taken
+		lrc::Complex<LowPrecision> endPoint; // Resulting coordinate
+
+		// Estimated distance to the boundary of the set, or 0 if there is no estimate.
+		// The true distance lies between a quarter of this and this
+		double distance;
+
+		bool interior; // True if the distance is from a point proven to be in the set
+	};
+
+	/// Symmetries the renderer can use to copy pixels instead of computing them. Pixels
+	/// are only treated as equal if they would be coloured the same
+	enum class Symmetry {
+		None,	  // No usable symmetry
+		RealAxis, // A coordinate and its conjugate are coloured the same
+		Origin	  // A coordinate and its negation are coloured the same
+	};
+
+	/// Estimate the distance from an escaped coordinate to the boundary of the set
+	/// \param endPoint Resulting coordinate, after escaping
+	/// \param derivative Derivative of the resulting coordinate with respect to the
+	/// initial one
+	/// \return Estimated distance, or 0 if there is no estimate
+	LIBRAPID_NODISCARD double
+	exteriorDistance(const lrc::Complex<LowPrecision> &endPoint,
+					 const lrc::Complex<LowPrecision> &derivative);
+
 	class Fractal {
 	public:
 		/// Constructor taking a RenderConfig object
@@ -16,13 +46,29 @@ namespace frac {
 		/// \param config The new RenderConfig to use
 		virtual void updateRenderConfig(const RenderConfig &config);
 
+		/// Read any options specific to this fractal from its entry in the settings
+		/// file. By default, there are none
+		/// \param settings The fractal's entry in renderConfig.fractals
+		virtual void configure(const json &settings);
+
 		/// Return an integer where the presence of a 1 or 0 at index i represents whether
 		/// optimisation i is valid for this fractal
 		/// \return Unsigned 64-bit integer
 		LIBRAPID_NODISCARD virtual size_t supportedOptimisations() const;
 
+		/// The symmetry of the fractal, which lets the renderer copy one half of a view
+		/// that spans the axis (or point) of symmetry from the other. By default, the
+		/// fractal has no symmetry
+		/// \return Symmetry of the fractal
+		LIBRAPID_NODISCARD virtual Symmetry symmetry() const;
+
 		LIBRAPID_NODISCARD virtual std::string name() const;
 
+		/// Whether this is an escape-time fractal, where the iteration count measures
+		/// how quickly a point diverges. Only these can be histogram-equalised
+		/// \return True for escape-time fractals
+		LIBRAPID_NODISCARD virtual bool isEscapeTime() const;
+
 		LIBRAPID_NODISCARD virtual std::unordered_map<std::string, coloring::ColorFuncLow>
 		getLowPrecColoringAlgorithms() const = 0;
 
@@ -46,6 +92,26 @@ namespace frac {
 		LIBRAPID_NODISCARD virtual std::pair<int64_t, lrc::Complex<HighPrecision>>
 		iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const = 0;
 
+		/// Iterate a batch of coordinates, as iterCoordLow does for one. Fractals can
+		/// override this to iterate the batch together. By default, each coordinate is
+		/// passed to iterCoordLow in turn
+		/// \param coords The initial complex-valued coordinates
+		/// \param count Number of coordinates
+		/// \param results Destination for the result of each coordinate
+		/// \see iterCoordLow(const lrc::Complex<LowPrecision> &coord) const
+		virtual void
+		iterCoordsLow(const lrc::Complex<LowPrecision> *coords, int64_t count,
+					  std::pair<int64_t, lrc::Complex<LowPrecision>> *results) const;
+
+		/// Iterate as iterCoordLow does, while also tracking the derivative needed to
+		/// estimate the coordinate's distance to the boundary of the set. Fractals that
+		/// implement this report optimisations::DISTANCE_ESTIMATION. By default, no
+		/// estimate is made
+		/// \param coord The initial complex-valued coordinate
+		/// \return Iterations, resulting coordinate and distance estimate
+		LIBRAPID_NODISCARD virtual DistanceEstimate
+		distanceEstimateLow(const lrc::Complex<LowPrecision> &coord) const;
+
 		LIBRAPID_NODISCARD virtual ci::ColorA
 		getColorLow(const lrc::Complex<LowPrecision> &coord, int64_t iters,
 					const ColorPalette &palette,
@@ -59,4 +125,15 @@ namespace frac {
 	protected:
 		RenderConfig m_renderConfig;
 	};
+
+	/// Construct a fractal from its name, as returned by Fractal::name() and stored in
+	/// the settings file. Unknown names fall back to the Mandelbrot set
+	/// \param name The name of the fractal
+	/// \param config The RenderConfig to construct the fractal with
+	/// \param settings The fractal's entry in renderConfig.fractals, passed to
+	/// Fractal::configure
+	/// \return Shared pointer to the new fractal
+	LIBRAPID_NODISCARD std::shared_ptr<Fractal>
+	createFractal(const std::string &name, const RenderConfig &config,
+				  const json &settings = json::object());
 } // namespace frac
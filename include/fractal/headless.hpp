@@ -0,0 +1,210 @@
+#pragma once
+
+namespace frac::headless {
+	/// Minimal command line parser for the headless renderer. The first argument is the
+	/// mode, followed by any number of `--key value` pairs or `--flag` switches
+	class Arguments {
+	public:
+		/// Parse the arguments passed to main()
+		/// \param argc Argument count
+		/// \param argv Argument values
+		Arguments(int argc, char **argv);
+
+		/// The path the program was started with (argv[0])
+		/// \return Program path
+		LIBRAPID_NODISCARD const std::string &program() const;
+
+		/// The mode to run in (the first positional argument)
+		/// \return Mode name
+		LIBRAPID_NODISCARD const std::string &mode() const;
+
+		/// Check whether an option or flag was passed
+		/// \param key Option name, without the leading dashes
+		/// \return True if present
+		LIBRAPID_NODISCARD bool has(const std::string &key) const;
+
+		/// Get the value of an option
+		/// \param key Option name, without the leading dashes
+		/// \param fallback Value to return if the option was not passed
+		/// \return Option value
+		LIBRAPID_NODISCARD std::string get(const std::string &key,
+										   const std::string &fallback = "") const;
+
+		/// Get the value of an integer option
+		/// \param key Option name, without the leading dashes
+		/// \param fallback Value to return if the option was not passed
+		/// \return Option value
+		LIBRAPID_NODISCARD int64_t getInt(const std::string &key, int64_t fallback) const;
+
+	private:
+		std::string m_program;
+		std::string m_mode;
+		std::unordered_map<std::string, std::string> m_values;
+	};
+
+	/// Load a settings file in the format written by FractalRenderer::exportSettings
+	/// \param path Path to the settings file
+	/// \param settings Output JSON object
+	/// \return True on success
+	bool loadSettings(const std::string &path, json &settings);
+
+	/// Configure a renderer from a settings object, selecting the fractal type,
+	/// colouring function and palette (see MainWindow::configureFractalDefault)
+	/// \param renderer The renderer to configure
+	/// \param settings The settings object
+	/// \return True on success
+	bool configureRenderer(FractalRenderer &renderer, const json &settings);
+
+	/// Apply common command line overrides (thread count, image size, thread
+	/// placement, distance estimate fill) to a renderer
+	/// \param renderer The renderer to update
+	/// \param args Parsed command line arguments
+	void applyOverrides(FractalRenderer &renderer, const Arguments &args);
+
+	/// The topology to pin render threads to: simulated if --numa-nodes was passed,
+	/// otherwise detected
+	/// \param args Parsed command line arguments
+	/// \return NUMA nodes
+	std::vector<topology::NumaNode> threadPlacement(const Arguments &args);
+
+	/// Print the usage information to stdout
+	void printUsage();
+
+	/// Render a (potentially huge) image in bands, streaming it to disk
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runStream(const Arguments &args);
+
+	/// Render an image in bands across several worker processes, streaming it to disk
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runDistributed(const Arguments &args);
+
+	/// Serve deep-zoom tiles of the configured view over HTTP
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runServe(const Arguments &args);
+
+	/// Work out the start and end views and frame count of a zoom animation from
+	/// --end-settings or --zoom, and --frames or --frames-per-octave
+	/// \param args Parsed command line arguments
+	/// \param renderer Renderer configured with the start view
+	/// \param start Output start view
+	/// \param end Output end view
+	/// \param frames Output number of frames
+	/// \return True on success
+	bool animationPath(const Arguments &args, FractalRenderer &renderer,
+					   AnimationRenderer::View &start, AnimationRenderer::View &end,
+					   int64_t &frames);
+
+	/// Parse the --format option of the animation modes and prepare stdout for binary
+	/// output
+	/// \param args Parsed command line arguments
+	/// \param format Output format
+	/// \return True on success
+	bool animationFormat(const Arguments &args, AnimationRenderer::Format &format);
+
+	/// Render a zoom animation and stream the frames to stdout
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runAnimate(const Arguments &args);
+
+	/// Render a zoom animation from an exponential map and stream the frames to stdout
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runExpMap(const Arguments &args);
+
+	/// Render every job in a batch file through one shared thread pool
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runBatch(const Arguments &args);
+
+	/// Benchmark the configured view with floating and NUMA-pinned render threads
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runPlacement(const Arguments &args);
+
+	/// Benchmark the configured view with and without the distance estimate fill, and
+	/// count the pixels it changes
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runDistanceFill(const Arguments &args);
+
+	/// Benchmark the configured view with and without boundary tracing, and count the
+	/// pixels it changes
+	/// \param args Parsed command line arguments
+	/// \return Process exit code: 1 if any pixel differs from the plain render
+	int runBoundaryTrace(const Arguments &args);
+
+	/// Benchmark the configured view with and without symmetry, and count the pixels
+	/// it changes
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runSymmetry(const Arguments &args);
+
+	/// Benchmark every instantiation of PowerFractal against the same iteration with
+	/// lrc::pow, over the pixels of each fractal's default view
+	/// \param args Parsed command line arguments
+	/// \return Process exit code
+	int runPowers(const Arguments &args);
+
+	/// Iterate every pixel of a fractal's default view with lrc::pow, the unrolled
+	/// power and the batched unrolled power, and print the fastest time of each
+	/// \tparam PowerFractalType An instantiation of PowerFractal
+	/// \param config RenderConfig to take the image size and iteration limit from
+	/// \param settings The fractal's entry in renderConfig.fractals
+	/// \param runs Number of passes of each kind
+	template<typename PowerFractalType>
+	void comparePower(const RenderConfig &config, const json &settings, int64_t runs);
+
+	/// Benchmark the formula interpreter, iterating z^2 + c one coordinate at a time
+	/// and in batches, against Mandelbrot::iterCoordLow over the formula fractal's
+	/// default view. Then time full renders of both fractals through renderFractal
+	/// \param args Parsed command line arguments
+	/// \return Process exit code: 1 if rendering the formula is more than 3x slower
+	int runFormula(const Arguments &args);
+
+	/// A fractal's default view, or the configured view if the fractal has none
+	/// \param config RenderConfig to take the configured view from
+	/// \param settings The fractal's entry in renderConfig.fractals
+	/// \param topLeft Set to the top left corner of the view
+	/// \param size Set to the size of the view
+	void defaultView(const RenderConfig &config, const json &settings, LowVec2 &topLeft,
+					 LowVec2 &size);
+
+	/// The coordinate of every pixel of a fractal's default view, or of the configured
+	/// view if the fractal has none, in row-major order
+	/// \param config RenderConfig to take the image size and view from
+	/// \param settings The fractal's entry in renderConfig.fractals
+	/// \return Pixel coordinates
+	LIBRAPID_NODISCARD std::vector<lrc::Complex<LowPrecision>>
+	defaultViewCoords(const RenderConfig &config, const json &settings);
+
+	/// Count the multiprecision allocations made while iterating the configured view in
+	/// high precision, and how many of them are made per iteration
+	/// \param args Parsed command line arguments
+	/// \return Process exit code: 1 if the inner loop allocates
+	int runAllocations(const Arguments &args);
+
+	/// Render the configured view while presenting it, as the window does, and check
+	/// that the regions presented cover exactly the pixels the render wrote
+	/// \param args Parsed command line arguments
+	/// \return Process exit code: 1 if a written pixel was missed, an unwritten pixel
+	/// was presented, or the front buffer does not match the back buffer
+	int runDirtyRegions(const Arguments &args);
+
+	/// Render the configured view with an optimisation disabled and enabled, and print
+	/// the fastest time, number of pixels computed and number of pixels changed
+	/// \param renderer Configured renderer
+	/// \param runs Number of renders of each kind
+	/// \param enable Function enabling (true) or disabling (false) the optimisation
+	/// \return Number of pixels that differ between the two renders
+	int64_t compareOptimisation(FractalRenderer &renderer, int64_t runs,
+								const std::function<void(bool)> &enable);
+
+	/// Entry point for the headless renderer
+	/// \param argc Argument count
+	/// \param argv Argument values
+	/// \return Process exit code
+	int run(int argc, char **argv);
+} // namespace frac::headless
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace frac::highPrecision {
+	/// Variables for iterating z -> z^2 + c in high precision. They are allocated once
+	/// per thread at the render's precision and every step is computed in place in
+	/// them, so no multiprecision temporaries are created while iterating
+	struct Scratch {
+		/// Allocate every variable with the given precision
+		/// \param precision Precision in bits
+		explicit Scratch(int64_t precision);
+
+		int64_t precision;	   // Precision the variables were allocated with
+		HighPrecision re;	   // Real component of z
+		HighPrecision im;	   // Imaginary component of z
+		HighPrecision cRe;	   // Real component of c
+		HighPrecision cIm;	   // Imaginary component of c
+		HighPrecision bailout; // Squared magnitude at which z has escaped
+		HighPrecision reSq;	   // re^2
+		HighPrecision imSq;	   // im^2
+		HighPrecision normSq;  // re^2 + im^2
+		HighPrecision sumSq;   // (re + im)^2
+	};
+
+	/// The calling thread's scratch variables, reallocated if the precision has changed
+	/// since they were last used
+	/// \param precision Precision in bits
+	/// \return Scratch variables
+	Scratch &threadScratch(int64_t precision);
+
+	/// Iterate z -> z^2 + c in place, starting from scratch.re and scratch.im with c in
+	/// scratch.cRe and scratch.cIm, until |z|^2 exceeds scratch.bailout. z^2 takes
+	/// three multiplications, as 2 re im = (re + im)^2 - re^2 - im^2 reuses the squares
+	/// the bailout test needs anyway
+	/// \param scratch Scratch variables holding z, c and the bailout. z is left holding
+	/// the final coordinate
+	/// \param maxIters Largest number of iterations to allow
+	/// \return Number of iterations
+	int64_t iterateQuadratic(Scratch &scratch, int64_t maxIters);
+} // namespace frac::highPrecision
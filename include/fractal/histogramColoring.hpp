@@ -0,0 +1,107 @@
+#pragma once
+
+namespace frac {
+	/// The result of iterating a single sample, kept so an image can be recoloured
+	/// without iterating it again
+	struct IterationSample {
+		int32_t iters;	// Number of iterations taken
+		float radiusSq; // Squared magnitude of the final coordinate
+	};
+
+	/// Allocator that default-initialises elements instead of value-initialising them,
+	/// so resizing a vector of trivial elements leaves the new memory untouched
+	/// \tparam T Element type
+	template<typename T>
+	struct DefaultInitAllocator : std::allocator<T> {
+		template<typename U>
+		struct rebind {
+			using other = DefaultInitAllocator<U>;
+		};
+
+		DefaultInitAllocator() = default;
+
+		template<typename U>
+		DefaultInitAllocator(const DefaultInitAllocator<U> &) noexcept {}
+
+		template<typename U>
+		void construct(U *ptr) noexcept(std::is_nothrow_default_constructible_v<U>) {
+			::new (static_cast<void *>(ptr)) U;
+		}
+
+		template<typename U, typename... Args>
+		void construct(U *ptr, Args &&...args) {
+			std::allocator_traits<std::allocator<T>>::construct(
+			  static_cast<std::allocator<T> &>(*this), ptr, std::forward<Args>(args)...);
+		}
+	};
+
+	/// Iteration data of every sample of an image. New samples are not initialised, so
+	/// each page of the buffer is placed on the NUMA node of the thread that first
+	/// writes to it
+	using IterationBuffer =
+	  std::vector<IterationSample, DefaultInitAllocator<IterationSample>>;
+} // namespace frac
+
+namespace frac::coloring {
+	/// Name of the histogram-equalised colouring mode. It is offered alongside the
+	/// colouring functions of every escape-time fractal (see Fractal::isEscapeTime)
+	constexpr const char *histogramEqualisation = "Histogram Equalisation";
+
+	/// Per-sample colouring function used to preview boxes while a histogram-equalised
+	/// render is still iterating. Distance estimation colouring also falls back to it
+	/// at high precision
+	constexpr const char *histogramPreview = "Paletted Logarithmic Scaling";
+
+	/// Distribution of escaped iteration counts over an image. Each render thread counts
+	/// into its own histogram as boxes finish, and the histograms are merged and
+	/// prefix-summed into a cumulative distribution once every box is done
+	class IterationHistogram {
+	public:
+		/// Clear every histogram ready for a new render
+		/// \param maxIters Maximum iteration count of the render
+		void reset(int64_t maxIters);
+
+		/// Count the escaped samples in a contiguous run into the calling thread's
+		/// histogram. Samples that reached maxIters are ignored
+		/// \param samples First sample
+		/// \param count Number of samples
+		void add(const IterationSample *samples, int64_t count);
+
+		/// Merge the per-thread histograms and build the normalised cumulative
+		/// distribution. No samples may be added while this runs
+		void finalise();
+
+		/// Look up the fraction of escaped samples with a smaller iteration count,
+		/// interpolating between whole iteration counts
+		/// \param smoothIters Smooth (fractional) iteration count
+		/// \return Equalised value in [0, 1]
+		LIBRAPID_NODISCARD float equalise(float smoothIters) const;
+
+	private:
+		int64_t m_maxIters = 0;
+
+		std::mutex m_mutex; // Guards the map itself, not the histograms inside it
+		std::map<std::thread::id, std::vector<int64_t>> m_threadCounts;
+
+		std::vector<float> m_cdf; // Normalised cumulative distribution, after finalise
+	};
+
+	/// Smooth (fractional) iteration count of an escaped sample
+	/// \param sample The sample
+	/// \return Smooth iteration count
+	inline float smoothIterations(const IterationSample &sample) {
+		return (float)sample.iters + 1 - fastLog2(fastLog2(sample.radiusSq));
+	}
+
+	/// Colour a run of samples with histogram equalisation. The smooth iteration counts
+	/// are computed in a separate, branch-free loop, so it can be vectorised
+	/// \param samples First sample
+	/// \param count Number of samples
+	/// \param maxIters Maximum iteration count of the render (these samples are black)
+	/// \param histogram Finalised histogram of the render
+	/// \param palette Palette to colour with
+	/// \param out Destination for \p count colours
+	void histogramColorBatch(const IterationSample *samples, int64_t count,
+							 int64_t maxIters, const IterationHistogram &histogram,
+							 const ColorPalette &palette, ci::ColorA *out);
+} // namespace frac::coloring
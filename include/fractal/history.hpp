@@ -1,64 +1,56 @@
 #pragma once
 
 namespace frac {
+	class HistoryBuffer;
+
+	/// A point in the render history. Nodes form a tree, where each node's children are
+	/// the views moved to from it. Moving somewhere new after an undo starts a new
+	/// branch rather than discarding the old one. The node's snapshot of the fractal
+	/// surface is stored run-length encoded, and may be spilled to disk by the buffer
+	/// (see HistoryBuffer::setMemoryBudget)
 	class HistoryNode {
 	public:
-		HistoryNode()								= default;
+		/// Construct an empty node. Nodes are only created by HistoryBuffer
+		/// \param buffer The buffer owning the node
+		/// \param index Index of the node in the buffer
+		/// \param parent Index of the node's parent, or -1 for the first node
+		/// \param depth Number of nodes before this one on its branch
+		HistoryNode(HistoryBuffer *buffer, int64_t index, int64_t parent, int64_t depth);
 		HistoryNode(const HistoryNode &)			= delete;
 		HistoryNode(HistoryNode &&)					= delete;
 		HistoryNode &operator=(const HistoryNode &) = delete;
 		HistoryNode &operator=(HistoryNode &&)		= delete;
 		~HistoryNode()								= default;
 
-		/// Append a new node to the end of the linked list
-		/// \param node The node to append (can contain links to other nodes)
-		void append(HistoryNode *node);
-
-		/// Free all child nodes following this one
-		void killChildren();
-
-		/// The number of nodes in the list, iterating forwards from this node
-		/// \param prevSize The number of nodes in the list before this one (default to
-		/// zero) \return The number of nodes in the list
-		LIBRAPID_NODISCARD size_t sizeForward(size_t prevSize = 0) const;
-
-		/// The number of nodes in the list, iterating backwards from this node
-		/// \param prevSize
-		/// \return The number of nodes in the list
-		/// \see sizeForward
-		LIBRAPID_NODISCARD size_t sizeBackward(size_t prevSize = 0) const;
-
-		/// The next node in the linked list. This may be `nullptr`, so always check
+		/// The next node on the active branch. This may be `nullptr`, so always check
 		/// the value is valid
-		/// \return The next node in the linked list
+		/// \return The next node on the active branch
 		LIBRAPID_NODISCARD HistoryNode *next() const;
 
-		/// The previous node in the linked list. See `next()` for more information
-		/// \return The previous node in the linked list
+		/// The parent of this node. See `next()` for more information
+		/// \return The previous node
 		/// \see next
 		LIBRAPID_NODISCARD HistoryNode *prev() const;
 
-		/// Iterate backwards until a node with an invalid parent is found (i.e. the
-		/// first node in the linked list)
-		/// \return The first node in the linked list
-		LIBRAPID_NODISCARD HistoryNode *first();
+		/// The number of branches leading on from this node
+		/// \return Number of children
+		LIBRAPID_NODISCARD size_t branches() const;
 
-		/// return the last node in the linked list
-		/// \return
-		/// \see first
-		LIBRAPID_NODISCARD HistoryNode *last();
+		/// The number of nodes before this one on its branch
+		/// \return Depth of the node
+		LIBRAPID_NODISCARD size_t depth() const;
 
 		/// Update the configuration and surface members of this node
 		/// \param config New configuration
 		/// \param surface New surface
 		void set(const RenderConfig &config, const ci::Surface &surface);
 
-		/// See `set()`
+		/// See `set()`. The palettes are shared, not copied (see PaletteRegistry)
 		/// \param config New configuration
 		/// \see set
 		void setConfig(const RenderConfig &config);
 
-		/// See `set()`
+		/// See `set()`. The surface is compressed, so it is not kept by reference
 		/// \param surface New surface
 		/// \see set
 		void setSurface(const ci::Surface &surface);
@@ -67,24 +59,50 @@ namespace frac {
 		/// \return RenderConfig
 		LIBRAPID_NODISCARD const RenderConfig &config() const;
 
-		/// Getter method for the surface instance stored
+		/// Decompress the stored surface, reading it back from disk if it was spilled
 		/// \return ci::Surface
-		LIBRAPID_NODISCARD const ci::Surface &surface() const;
+		LIBRAPID_NODISCARD ci::Surface surface() const;
 
-		/// Non-const getter method for the configuration instance stored
-		/// \return RenderConfig
-		LIBRAPID_NODISCARD RenderConfig &config();
-
-		/// Non-const getter method for the surface instance stored
+		/// A downscaled copy of the surface, made when the surface is set. See
+		/// HistoryBuffer::setThumbnailWidth
 		/// \return ci::Surface
-		LIBRAPID_NODISCARD ci::Surface &surface();
+		LIBRAPID_NODISCARD const ci::Surface &thumbnail() const;
+
+		/// The thumbnail as a texture. It is uploaded the first time it is requested
+		/// after the surface changes, so this must be called from the GL thread
+		/// \return Texture of the thumbnail
+		LIBRAPID_NODISCARD const ci::gl::Texture2dRef &thumbnailTexture() const;
+
+		/// Overwrite a configuration with the one stored, keeping its palettes, which
+		/// may have been published since this node was stored
+		/// \param config Configuration to overwrite
+		void restore(RenderConfig &config) const;
+
+		/// Size of the compressed surface, wherever it is stored
+		/// \return Number of bytes
+		LIBRAPID_NODISCARD size_t snapshotBytes() const;
 
 	private:
-		HistoryNode *m_next = nullptr;
-		HistoryNode *m_prev = nullptr;
+		friend class HistoryBuffer;
+
+		HistoryBuffer *m_buffer;
+		int64_t m_index;
+		int64_t m_parent;
+		int64_t m_activeChild = -1; // Child followed by next() and redo
+		int64_t m_depth;
+		std::vector<int64_t> m_children;
 
 		RenderConfig m_config;
-		ci::Surface m_surface;
+
+		int32_t m_width	 = 0;
+		int32_t m_height = 0;
+		std::vector<uint8_t> m_snapshot; // Run-length encoded RGBA pixels
+		size_t m_snapshotBytes = 0;		 // Size of the encoded pixels
+		int64_t m_spillOffset  = -1;	 // Offset in the spill file, or -1
+		bool m_resident		   = false;	 // Counted in the buffer's memory usage
+
+		ci::Surface m_thumbnail;
+		mutable ci::gl::Texture2dRef m_thumbnailTexture; // Uploaded on first use
 	};
 
 	class HistoryBuffer {
@@ -97,31 +115,126 @@ namespace frac {
 
 		~HistoryBuffer();
 
-		/// Append a new point to the history buffer
+		/// Append a new point to the history, after the current node. If the current
+		/// node already leads somewhere, the new node starts another branch. The new
+		/// node becomes the current node
 		/// \param config The settings for the fractal renderer
 		/// \param surface A saved copy of the fractal surface
 		void append(const RenderConfig &config, const ci::Surface &surface);
 
 		/// Undo the last operation
+		/// \return True if there was a node to move back to
 		bool undo();
 
-		/// If possible, redo the last operation
+		/// If possible, redo the last operation, following the active branch
+		/// \return True if there was a node to move forward to
 		bool redo();
 
-		/// Return the number of elements in the history buffer
+		/// Make a node current, and make the branch it is on the active one
+		/// \param node Node to select
+		void select(HistoryNode *node);
+
+		/// Discard every node but the first, and make it current
+		void reset();
+
+		/// Return the number of nodes on the active branch
 		/// \return Number of elements
 		LIBRAPID_NODISCARD size_t size() const;
 
+		/// Return the number of nodes on every branch
+		/// \return Number of nodes
+		LIBRAPID_NODISCARD size_t nodeCount() const;
+
 		/// Return the first buffer item (a HistoryNode pointer)
 		/// \return First item in the buffer
 		LIBRAPID_NODISCARD HistoryNode *first() const;
 
-		/// Return the last buffer item (a HistoryNode pointer)
+		/// Return the last item on the active branch
 		/// \return Last item in the buffer
 		LIBRAPID_NODISCARD HistoryNode *last() const;
 
+		/// Return the node the renderer was last moved to
+		/// \return Current item in the buffer
+		LIBRAPID_NODISCARD HistoryNode *current() const;
+
+		/// Return a node on the active branch
+		/// \param depth Number of nodes before it on the branch. Must be less than size()
+		/// \return The node
+		LIBRAPID_NODISCARD HistoryNode *at(size_t depth) const;
+
+		/// Set the width of the thumbnails made for new and updated snapshots
+		/// \param width Thumbnail width in pixels
+		void setThumbnailWidth(int64_t width);
+
+		/// Set the largest number of bytes of snapshots to keep in memory. When it is
+		/// exceeded, the oldest snapshots are moved to a temporary file
+		/// \param bytes Memory budget
+		void setMemoryBudget(size_t bytes);
+
+		/// Set the largest size of the spill file. Space freed by snapshots that are
+		/// replaced is reused, so this bounds the history's total disk usage. Snapshots
+		/// that would not fit are discarded
+		/// \param bytes Disk budget
+		void setSpillBudget(size_t bytes);
+
+		/// The number of bytes of snapshots currently held in memory
+		/// \return Number of bytes
+		LIBRAPID_NODISCARD size_t memoryUsage() const;
+
 	private:
-		HistoryNode *m_listHead	   = nullptr;
-		HistoryNode *m_currentNode = nullptr;
+		friend class HistoryNode;
+
+		/// Get a node from its index
+		/// \param index Index of the node, or -1
+		/// \return The node, or nullptr
+		LIBRAPID_NODISCARD HistoryNode *node(int64_t index) const;
+
+		/// Record that a node's snapshot has been replaced in memory, and spill old
+		/// snapshots until the buffer is within budget
+		/// \param node The node
+		/// \param oldBytes Resident size of the node's previous snapshot
+		void snapshotChanged(HistoryNode &node, size_t oldBytes);
+
+		/// Move a node's snapshot to the spill file
+		/// \param node The node
+		/// \return True if the snapshot was written
+		bool spill(HistoryNode &node);
+
+		/// Give a node's spilled snapshot back to the spill file's free space
+		/// \param node The node
+		void releaseSpilled(HistoryNode &node);
+
+		/// Read a spilled snapshot back from disk
+		/// \param node The node
+		/// \param out Destination for the encoded pixels
+		/// \return True if the snapshot was read
+		bool readSpilled(const HistoryNode &node, std::vector<uint8_t> &out) const;
+
+		/// Downscale a surface to the thumbnail width with a box filter. Bands of
+		/// thumbnail rows are filtered in parallel
+		/// \param surface The surface to downscale
+		/// \return The thumbnail
+		LIBRAPID_NODISCARD ci::Surface makeThumbnail(const ci::Surface &surface);
+
+		// Nodes link to each other by index. Each is allocated once, so pointers to
+		// them stay valid as the history grows
+		std::vector<std::unique_ptr<HistoryNode>> m_nodes;
+		int64_t m_current = -1;
+		std::vector<int64_t> m_branch; // Nodes on the active branch, first to last
+
+		size_t m_memoryBudget  = 256 * 1024 * 1024;
+		size_t m_residentBytes = 0;
+		std::deque<int64_t> m_resident; // Nodes with snapshots in memory, oldest first
+
+		std::filesystem::path m_spillPath;
+		mutable std::fstream m_spillFile;
+		size_t m_spillBudget = size_t(4096) * 1024 * 1024;
+		int64_t m_spillEnd	 = 0; // End of the used part of the spill file
+
+		// Extents of the spill file freed by replaced snapshots, from offset to size
+		std::map<int64_t, int64_t> m_spillFree;
+
+		int64_t m_thumbnailWidth = 150;
+		ThreadPool m_thumbnailPool;
 	};
 } // namespace frac
@@ -0,0 +1,82 @@
+#pragma once
+
+namespace frac {
+	/// Writes an image to disk one band of rows at a time, so the full image never has
+	/// to be held in memory. Supported formats are binary PPM (P6) and headerless raw
+	/// RGB8, both of which can be resumed after an interrupted render.
+	class ImageStreamWriter {
+	public:
+		enum class Format {
+			PPM, // Binary PPM (P6) with an 8-bit RGB payload
+			Raw	 // Headerless, tightly packed 8-bit RGB
+		};
+
+		ImageStreamWriter()										= delete;
+		ImageStreamWriter(const ImageStreamWriter &)			= delete;
+		ImageStreamWriter(ImageStreamWriter &&)					= delete;
+		ImageStreamWriter &operator=(const ImageStreamWriter &) = delete;
+		ImageStreamWriter &operator=(ImageStreamWriter &&)		= delete;
+
+		/// Open (or create) an output image of the given size. If \p resume is true and
+		/// a compatible partial file already exists, writing continues from the last
+		/// complete row in that file
+		/// \param path Output file path
+		/// \param imageSize Dimensions of the full image
+		/// \param format Output format
+		/// \param resume Whether to continue a partially written file
+		ImageStreamWriter(const std::string &path, const lrc::Vec2i &imageSize,
+						  Format format, bool resume);
+
+		~ImageStreamWriter();
+
+		/// Pick an output format from the extension of \p path (".ppm" -> PPM,
+		/// anything else -> Raw)
+		/// \param path Output file path
+		/// \return Output format
+		LIBRAPID_NODISCARD static Format formatFromPath(const std::string &path);
+
+		/// Whether the output file was opened successfully
+		/// \return True if rows can be written
+		LIBRAPID_NODISCARD bool isOpen() const;
+
+		/// The number of complete rows already present in the output
+		/// \return Number of rows
+		LIBRAPID_NODISCARD int64_t rowsWritten() const;
+
+		/// Append the first \p rows rows of \p surface to the output. The surface must
+		/// be the same width as the image
+		/// \param surface Source of pixel data
+		/// \param rows Number of rows to write
+		/// \return True on success
+		bool writeRows(const ci::Surface &surface, int64_t rows);
+
+		/// Append \p rows rows of tightly packed RGB8 data to the output
+		/// \param data Pixel data (width * rows * 3 bytes)
+		/// \param rows Number of rows to write
+		/// \return True on success
+		bool writePacked(const uint8_t *data, int64_t rows);
+
+		/// Convert the first \p rows rows of a surface to tightly packed RGB8
+		/// \param surface Source of pixel data
+		/// \param rows Number of rows to convert
+		/// \param out Destination buffer (resized to fit)
+		static void packRows(const ci::Surface &surface, int64_t rows,
+							 std::vector<uint8_t> &out);
+
+		/// Encode a full surface as an uncompressed 24-bit BMP image
+		/// \param surface Source of pixel data
+		/// \param out Destination buffer (resized to fit)
+		static void encodeBMP(const ci::Surface &surface, std::vector<uint8_t> &out);
+
+	private:
+		/// Size (in bytes) of the file header for the current format
+		LIBRAPID_NODISCARD int64_t headerSize() const;
+
+		std::string m_path;
+		lrc::Vec2i m_imageSize;
+		Format m_format;
+		std::fstream m_file;
+		int64_t m_rowsWritten = 0;
+		std::vector<uint8_t> m_packBuffer; // Scratch space for converted rows
+	};
+} // namespace frac
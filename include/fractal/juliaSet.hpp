@@ -22,8 +22,12 @@ namespace frac {
 
 		LIBRAPID_NODISCARD size_t supportedOptimisations() const override;
 
+		LIBRAPID_NODISCARD Symmetry symmetry() const override;
+
 		LIBRAPID_NODISCARD std::string name() const override;
 
+		LIBRAPID_NODISCARD bool isEscapeTime() const override;
+
 		LIBRAPID_NODISCARD
 		std::unordered_map<std::string, coloring::ColorFuncLow>
 		getLowPrecColoringAlgorithms() const override;
@@ -38,6 +42,9 @@ namespace frac {
 		LIBRAPID_NODISCARD std::pair<int64_t, lrc::Complex<HighPrecision>>
 		iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const override;
 
+		LIBRAPID_NODISCARD DistanceEstimate
+		distanceEstimateLow(const lrc::Complex<LowPrecision> &coord) const override;
+
 		LIBRAPID_NODISCARD ci::ColorA
 		getColorLow(const lrc::Complex<LowPrecision> &coord, int64_t iters,
 					const ColorPalette &palette,
@@ -152,8 +152,10 @@ namespace frac {
 		lrc::Vec2i m_mouseDownPos; // The position of the mouse when it was clicked
 		bool m_mouseDown = false;  // Whether the mouse is currently down
 
+		// Regions of the texture updated by drawFractal, kept to avoid reallocating
+		std::vector<SurfaceRegion> m_changedRegions;
+
 		HistoryBuffer m_history;
-		HistoryNode *m_historyNode	= nullptr;
 		float m_historyScrollTarget = 0.0f;
 
 		bool m_drawingZoomBox = false;
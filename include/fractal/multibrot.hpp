@@ -0,0 +1,112 @@
+#pragma once
+
+#include <fractal/genericFractal.hpp>
+
+namespace frac {
+	/// Raise a complex number to a power in place by repeated squaring. The power is
+	/// known at compile time, so the recursion is unrolled into a fixed sequence of
+	/// multiplications
+	/// \tparam Power The power to raise to. Must be at least 1
+	/// \param re Real component
+	/// \param im Imaginary component
+	template<int64_t Power, typename Scalar>
+	inline void unrolledPower(Scalar &re, Scalar &im) {
+		static_assert(Power >= 1, "Only positive powers can be unrolled");
+
+		if constexpr (Power % 2 == 0) {
+			unrolledPower<Power / 2>(re, im);
+			const Scalar real = re * re - im * im;
+			im				  = 2 * re * im;
+			re				  = real;
+		} else if constexpr (Power > 1) {
+			const Scalar baseRe = re;
+			const Scalar baseIm = im;
+			unrolledPower<Power - 1>(re, im);
+			const Scalar real = re * baseRe - im * baseIm;
+			im				  = re * baseIm + im * baseRe;
+			re				  = real;
+		}
+	}
+
+	/*
+	 * The escape-time family z -> z^Power + c, starting from z = 0. With Fold set, z is
+	 * folded into the first quadrant (|re(z)| + i |im(z)|) before every step, giving the
+	 * Burning Ship and its higher powers. The power is a template parameter, so each
+	 * step is an unrolled sequence of multiplications (see unrolledPower) rather than a
+	 * call to lrc::pow
+	 */
+
+	template<int64_t Power, bool Fold>
+	class PowerFractal : public Fractal {
+		static_assert(Power >= 2, "Power fractals must have a power of at least 2");
+
+	public:
+		/// Constructor taking a RenderConfig object
+		/// \param config RenderConfig object
+		explicit PowerFractal(const RenderConfig &config);
+		PowerFractal(const PowerFractal &)			  = delete;
+		PowerFractal(PowerFractal &&)				  = delete;
+		PowerFractal &operator=(const PowerFractal &) = delete;
+		PowerFractal &operator=(PowerFractal &&)	  = delete;
+
+		~PowerFractal() override = default;
+
+		LIBRAPID_NODISCARD size_t supportedOptimisations() const override;
+
+		LIBRAPID_NODISCARD Symmetry symmetry() const override;
+
+		LIBRAPID_NODISCARD std::string name() const override;
+
+		LIBRAPID_NODISCARD bool isEscapeTime() const override;
+
+		LIBRAPID_NODISCARD
+		std::unordered_map<std::string, coloring::ColorFuncLow>
+		getLowPrecColoringAlgorithms() const override;
+
+		LIBRAPID_NODISCARD
+		std::unordered_map<std::string, coloring::ColorFuncHigh>
+		getHighPrecColoringAlgorithms() const override;
+
+		LIBRAPID_NODISCARD std::pair<int64_t, lrc::Complex<LowPrecision>>
+		iterCoordLow(const lrc::Complex<LowPrecision> &coord) const override;
+
+		void
+		iterCoordsLow(const lrc::Complex<LowPrecision> *coords, int64_t count,
+					  std::pair<int64_t, lrc::Complex<LowPrecision>> *results)
+		  const override;
+
+		LIBRAPID_NODISCARD std::pair<int64_t, lrc::Complex<HighPrecision>>
+		iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const override;
+
+		/// Iterate as iterCoordLow does, but raise z to the power with lrc::pow. This is
+		/// only used to benchmark the unrolled power (see headless::runPowers)
+		/// \param coord The initial complex-valued coordinate
+		/// \return <iterations, resulting coordinate>
+		LIBRAPID_NODISCARD std::pair<int64_t, lrc::Complex<LowPrecision>>
+		iterCoordNaive(const lrc::Complex<LowPrecision> &coord) const;
+
+		LIBRAPID_NODISCARD ci::ColorA
+		getColorLow(const lrc::Complex<LowPrecision> &coord, int64_t iters,
+					const ColorPalette &palette,
+					const coloring::ColorFuncLow &colorFunc) const override;
+
+		LIBRAPID_NODISCARD ci::ColorA
+		getColorHigh(const lrc::Complex<HighPrecision> &coord, int64_t iters,
+					 const ColorPalette &palette,
+					 const coloring::ColorFuncHigh &colorFunc) const override;
+	};
+
+	// Instantiated in multibrot.cpp. Each also needs a name in createFractal and a
+	// kernel registration in kernels::findKernels
+	extern template class PowerFractal<3, false>;
+	extern template class PowerFractal<4, false>;
+	extern template class PowerFractal<5, false>;
+	extern template class PowerFractal<2, true>;
+	extern template class PowerFractal<3, true>;
+
+	using Multibrot3   = PowerFractal<3, false>;
+	using Multibrot4   = PowerFractal<4, false>;
+	using Multibrot5   = PowerFractal<5, false>;
+	using BurningShip  = PowerFractal<2, true>;
+	using BurningShip3 = PowerFractal<3, true>;
+} // namespace frac
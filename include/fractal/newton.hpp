@@ -4,13 +4,15 @@
 
 namespace frac {
 	/*
-	 * No need to document this file, since the class inherits from a generic fractal
-	 * class and does not implement any novel functions.
+	 * Newton's fractal for an arbitrary polynomial. Each coordinate is coloured by the
+	 * root of the polynomial that Newton's method converges to from it. The roots are
+	 * found once, when the polynomial or the precision changes, rather than per pixel
 	 */
 
 	class NewtonFractal : public Fractal {
 	public:
-		/// Constructor taking a RenderConfig object
+		/// Constructor taking a RenderConfig object. The polynomial is z^3 - 1 until
+		/// another is set
 		/// \param config RenderConfig object
 		explicit NewtonFractal(const RenderConfig &config);
 		NewtonFractal(const NewtonFractal &)			= delete;
@@ -20,6 +22,20 @@ namespace frac {
 
 		~NewtonFractal() override = default;
 
+		/// Update the RenderConfig, finding the roots of the polynomial again if the
+		/// precision has changed
+		/// \param config The new RenderConfig to use
+		void updateRenderConfig(const RenderConfig &config) override;
+
+		/// Read the "polynomial" entry of the fractal's settings, if there is one
+		/// \param settings The fractal's entry in the settings file
+		void configure(const json &settings) override;
+
+		/// Set the polynomial to find the roots of
+		/// \param coefficients Complex coefficients, highest power first
+		/// \return False if the polynomial has no roots, in which case it is not changed
+		bool setPolynomial(std::vector<lrc::Complex<LowPrecision>> coefficients);
+
 		LIBRAPID_NODISCARD std::string name() const override;
 
 		size_t supportedOptimisations() const override;
@@ -32,36 +48,27 @@ namespace frac {
 		std::unordered_map<std::string, coloring::ColorFuncHigh>
 		getHighPrecColoringAlgorithms() const override;
 
-		template<typename T>
-		lrc::Complex<T> f(const lrc::Complex<T> &z) const {
-			// return lrc::pow(z, 3) - 1;
-
-			// a^3 + i 3 a^2 b - 3 a b^2 - i b^3 - 1
-			auto real  = z.real();
-			auto imag  = z.imag();
-			auto real2 = real * real;
-			auto imag2 = imag * imag;
-			return lrc::Complex<T>(1, 0) * real2 * real +
-				   lrc::Complex<T>(0, 3) * real2 * imag -
-				   lrc::Complex<T>(3, 0) * real * imag2 -
-				   lrc::Complex<T>(0, 1) * imag2 * imag - 1;
-		}
-
-		template<typename T>
-		lrc::Complex<T> df(const lrc::Complex<T> &z) const {
-			// return 3 * lrc::pow(z, 2);
-			// a^2 + i 2 a b - b^2
-			auto real = z.real();
-			auto imag = z.imag();
-			return lrc::Complex<T>(3, 0) * real * real +
-				   lrc::Complex<T>(0, 6) * real * imag -
-				   lrc::Complex<T>(3, 0) * imag * imag;
-		}
-
 		LIBRAPID_NODISCARD std::pair<int64_t, lrc::Complex<LowPrecision>>
 		iterCoordLow(const lrc::Complex<LowPrecision> &coord) const override;
 
+		void
+		iterCoordsLow(const lrc::Complex<LowPrecision> *coords, int64_t count,
+					  std::pair<int64_t, lrc::Complex<LowPrecision>> *results)
+		  const override;
+
 		LIBRAPID_NODISCARD std::pair<int64_t, lrc::Complex<HighPrecision>>
 		iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const override;
+
+	private:
+		/// Find the high precision roots by refining the low precision ones
+		void findRootsHigh();
+
+		// Coefficients of the polynomial, highest power first
+		std::vector<lrc::Complex<LowPrecision>> m_coefficientsLow;
+		std::vector<lrc::Complex<HighPrecision>> m_coefficientsHigh;
+
+		std::vector<lrc::Complex<LowPrecision>> m_rootsLow;
+		std::vector<lrc::Complex<HighPrecision>> m_rootsHigh;
+		int64_t m_rootsPrecision = 0; // Precision m_rootsHigh was found at
 	};
 } // namespace frac
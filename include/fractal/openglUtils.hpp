@@ -21,4 +21,13 @@ namespace frac::glu {
 	/// \param radius Radius of the cross
 	/// \param thickness Thickness of the cross
 	void drawCross(const lrc::Vec2f &center, float radius, float thickness = 1);
+
+	/// Copy a rectangle of an RGBA surface into the same rectangle of a texture
+	/// created from a surface of the same size
+	/// \param texture The texture to update
+	/// \param surface The surface to copy from
+	/// \param topLeft Top left pixel of the rectangle
+	/// \param size Width and height of the rectangle
+	void updateTexture(const ci::gl::Texture2dRef &texture, const ci::Surface &surface,
+					   const lrc::Vec2i &topLeft, const lrc::Vec2i &size);
 } // namespace frac::glu
@@ -0,0 +1,62 @@
+#pragma once
+
+namespace frac {
+	/// An immutable set of named colour palettes, each with its lookup table already
+	/// built. Render configurations share a handle to a set, so copying a configuration
+	/// never copies a palette. To change the palettes, publish a new set (see
+	/// PaletteRegistry) and leave the old one to the handles still using it
+	class PaletteSet {
+	public:
+		/// Construct a set from a map of palettes
+		/// \param palettes The palettes, keyed by name
+		/// \param version Version number assigned by the registry
+		PaletteSet(std::unordered_map<std::string, ColorPalette> palettes,
+				   int64_t version);
+		PaletteSet(const PaletteSet &)			  = delete;
+		PaletteSet(PaletteSet &&)				  = delete;
+		PaletteSet &operator=(const PaletteSet &) = delete;
+		PaletteSet &operator=(PaletteSet &&)	  = delete;
+		~PaletteSet()							  = default;
+
+		/// Find a palette by name. If there is no palette with the name, an empty
+		/// palette is returned
+		/// \param name Name of the palette
+		/// \return The palette
+		LIBRAPID_NODISCARD const ColorPalette &get(const std::string &name) const;
+
+		/// Whether the set contains a palette with the given name
+		/// \param name Name of the palette
+		/// \return True if the palette exists
+		LIBRAPID_NODISCARD bool contains(const std::string &name) const;
+
+		/// The names of every palette in the set
+		/// \return Palette names
+		LIBRAPID_NODISCARD std::vector<std::string> names() const;
+
+		/// The version of the set. Each published set has a larger version than the last
+		/// \return Version number
+		LIBRAPID_NODISCARD int64_t version() const;
+
+	private:
+		std::unordered_map<std::string, ColorPalette> m_palettes;
+		ColorPalette m_empty; // Returned for unknown names
+		int64_t m_version;
+	};
+
+	using PaletteHandle = std::shared_ptr<const PaletteSet>;
+
+	/// The process-wide source of palette sets. Publishing and fetching the current set
+	/// are thread safe
+	class PaletteRegistry {
+	public:
+		/// Replace the current set of palettes. Handles to older sets remain valid
+		/// \param palettes The new palettes, keyed by name
+		/// \return Handle to the new set
+		static PaletteHandle
+		publish(std::unordered_map<std::string, ColorPalette> palettes);
+
+		/// The most recently published set, or an empty set if none has been published
+		/// \return Handle to the set
+		LIBRAPID_NODISCARD static PaletteHandle current();
+	};
+} // namespace frac
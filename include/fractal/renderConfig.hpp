@@ -15,8 +15,28 @@ namespace frac {
 		lrc::Vec2i dimensions;
 		bool draftRender;
 		int64_t draftInc;
-		RenderBoxState state = RenderBoxState::None;
-		double renderTime	 = 0;
+		RenderBoxState state   = RenderBoxState::None;
+		double renderTime	   = 0;
+		int64_t pixelsComputed = 0; // Pixels computed rather than filled
+	};
+
+	/// A rectangle of pixels in an image
+	struct SurfaceRegion {
+		lrc::Vec2i topLeft;	   // Top left pixel
+		lrc::Vec2i dimensions; // Width and height in pixels
+	};
+
+	/// Fractal-space position of a render box and the spacing of its pixels and samples.
+	/// These are computed once per box in high precision. Renders at double precision
+	/// or lower generate pixel positions from the rounded copies, so they do no high
+	/// precision arithmetic per pixel
+	struct BoxPosition {
+		HighVec2 origin;	   // Position of the box's top left pixel
+		HighVec2 step;		   // Distance between pixels
+		HighVec2 sampleStep;   // Distance between anti-aliasing samples
+		LowVec2 originLow;	   // origin, rounded to double
+		LowVec2 stepLow;	   // step, rounded to double
+		LowVec2 sampleStepLow; // sampleStep, rounded to double
 	};
 
 	/// Information about the time taken to render a box
@@ -44,7 +64,7 @@ namespace frac {
 		lrc::Vec<HighPrecision, 2> fracSize; // The width and height of the fractal space
 		lrc::Vec<HighPrecision, 2> originalFracSize; // Original size
 
-		std::unordered_map<std::string, ColorPalette> palettes; // Colour palettes
+		PaletteHandle palettes; // Shared colour palettes (see PaletteRegistry)
 
 		bool draftRender; // Whether to render the fractal in draft mode
 		int64_t draftInc; // Increment for draft rendering
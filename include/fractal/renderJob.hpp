@@ -0,0 +1,87 @@
+#pragma once
+
+namespace frac {
+	/// Called each time a box of a render finishes, with the fraction of the render's
+	/// boxes that have finished. This runs on a render thread
+	using RenderProgressCallback = std::function<void(double progress)>;
+
+	/// Everything a render reads, captured when the render starts (see
+	/// FractalRenderer::captureJob). Render threads only read the job, never the
+	/// renderer's settings, so the settings can be changed while a render is running.
+	/// The changes are picked up by the next job
+	struct RenderJob {
+		int64_t id = 0;							// Unique, and increasing, per job
+		RenderConfig config;					// Configuration to render
+		std::shared_ptr<const Fractal> fractal;	// Instance owned by this job
+
+		// Colouring functions, the selected palette (kept alive by config.palettes)
+		// and any specialised kernels, with the values they read
+		coloring::ColorFuncLow colorFuncLow;
+		coloring::ColorFuncHigh colorFuncHigh;
+		const ColorPalette *palette		  = nullptr;
+		const kernels::KernelSet *kernels = nullptr;
+		kernels::KernelContext kernelContext {};
+
+		ci::Surface *target		= nullptr; // Surface the pixels are written to
+		double pixelSpacing		= 0;	   // Fractal-space width of a pixel
+		bool histogramColoring	= false;   // Colour by histogram equalisation
+		bool distanceColoring	= false;   // Colour by distance estimation
+		bool distanceFill		= false;   // See FractalRenderer::setDistanceFill
+		bool boundaryTracing	= false;   // See FractalRenderer::setBoundaryTracing
+		bool deferColoring		= false;   // See FractalRenderer::setDeferredColoring
+	};
+
+	/// Progress of a submitted job, shared between the renderer and its RenderHandle
+	struct RenderProgress {
+		std::atomic<int64_t> boxesDone {0};	// Boxes that have finished
+		int64_t boxesTotal = 0;				// Boxes in the render
+		RenderProgressCallback callback;	// Called as boxes finish, or empty
+		std::promise<bool> finished;		// Set when every task has finished
+	};
+
+	/// A job submitted to a FractalRenderer. The handle can be polled for progress,
+	/// or waited on, from any thread, and stays valid after the render finishes
+	class RenderHandle {
+	public:
+		RenderHandle() = default;
+
+		/// Construct a handle for a submitted job. Handles are only created by the
+		/// renderer
+		/// \param job The job being rendered
+		/// \param progress Progress of the job, which must not be resolved yet
+		RenderHandle(std::shared_ptr<const RenderJob> job,
+					 std::shared_ptr<RenderProgress> progress);
+
+		/// Whether the handle refers to a job
+		/// \return True if a job was submitted
+		LIBRAPID_NODISCARD bool valid() const;
+
+		/// The job being rendered. The handle must be valid
+		/// \return The job
+		LIBRAPID_NODISCARD const RenderJob &job() const;
+
+		/// Fraction of the job's boxes that have finished. Symmetry and colouring
+		/// passes run after the last box, so wait for the future to be sure the image
+		/// is complete
+		/// \return Progress from 0 to 1
+		LIBRAPID_NODISCARD double progress() const;
+
+		/// Whether every task of the job has finished, without blocking
+		/// \return True if the job has finished
+		LIBRAPID_NODISCARD bool finished() const;
+
+		/// Block until every task of the job has finished
+		/// \return True if the render completed, false if it was halted
+		bool wait() const;
+
+		/// Future resolved when every task of the job has finished. Its value is false
+		/// if the render was halted before it completed
+		/// \return The future
+		LIBRAPID_NODISCARD const std::shared_future<bool> &future() const;
+
+	private:
+		std::shared_ptr<const RenderJob> m_job;
+		std::shared_ptr<RenderProgress> m_progress;
+		std::shared_future<bool> m_future;
+	};
+} // namespace frac
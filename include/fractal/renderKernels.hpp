@@ -0,0 +1,245 @@
+#pragma once
+
+namespace frac::kernels {
+	/// Per-render values a kernel needs besides the pixel position. These are copied
+	/// out of the RenderConfig once, so kernels do not touch the configuration (or
+	/// the palette map) per pixel
+	struct KernelContext {
+		int64_t maxIters;			 // Largest number of iterations to allow
+		double bailout;				 // Bailout value
+		int64_t aliasFactor;		 // Anti-aliasing factor -- 1 = no anti-aliasing
+		const ColorPalette *palette; // The selected palette
+		int64_t precision;			 // Precision of HighPrecision values, in bits
+	};
+
+	/*
+	 * Iteration policies. Each one mirrors the iterCoord methods of a fractal, but is
+	 * templated on the scalar type so it can be inlined into a kernel at any precision.
+	 * The iteration leaves the final coordinate in re and im and returns the number of
+	 * iterations taken.
+	 */
+
+	struct MandelbrotIteration {
+		static constexpr bool blackInterior = true; // See Mandelbrot::getColorLow
+
+		template<typename Scalar>
+		static int64_t iterate(const Scalar &re_0, const Scalar &im_0,
+							   const KernelContext &context, Scalar &re, Scalar &im) {
+			if constexpr (std::is_same_v<Scalar, HighPrecision>) {
+				// Mandelbrot::iterCoordHigh uses a fixed bailout
+				highPrecision::Scratch &scratch =
+				  highPrecision::threadScratch(context.precision);
+				scratch.re		= 0;
+				scratch.im		= 0;
+				scratch.cRe		= re_0;
+				scratch.cIm		= im_0;
+				scratch.bailout = 1 << 16;
+
+				const int64_t iteration =
+				  highPrecision::iterateQuadratic(scratch, context.maxIters);
+				re = scratch.re;
+				im = scratch.im;
+				return iteration;
+			}
+
+			const Scalar bailout = static_cast<Scalar>(context.bailout);
+			Scalar tmp;
+			int64_t iteration = 0;
+			re				  = 0;
+			im				  = 0;
+
+			while (re * re + im * im <= bailout && iteration < context.maxIters) {
+				tmp = re * re - im * im + re_0;
+				im	= 2 * re * im + im_0;
+				re	= tmp;
+				++iteration;
+			}
+
+			return iteration;
+		}
+	};
+
+	struct JuliaIteration {
+		static constexpr bool blackInterior = true; // See JuliaSet::getColorLow
+
+		template<typename Scalar>
+		static int64_t iterate(const Scalar &re_0, const Scalar &im_0,
+							   const KernelContext &context, Scalar &re, Scalar &im) {
+			if constexpr (std::is_same_v<Scalar, HighPrecision>) {
+				highPrecision::Scratch &scratch =
+				  highPrecision::threadScratch(context.precision);
+				scratch.re		= re_0;
+				scratch.im		= im_0;
+				scratch.cRe		= -0.8; // Julia set constant
+				scratch.cIm		= 0.156;
+				scratch.bailout = context.bailout;
+
+				const int64_t iteration =
+				  highPrecision::iterateQuadratic(scratch, context.maxIters);
+				re = scratch.re;
+				im = scratch.im;
+				return iteration;
+			}
+
+			const Scalar cRe	 = static_cast<Scalar>(-0.8); // Julia set constant
+			const Scalar cIm	 = static_cast<Scalar>(0.156);
+			const Scalar bailout = static_cast<Scalar>(context.bailout);
+			Scalar tmp;
+			int64_t iteration = 0;
+			re				  = re_0;
+			im				  = im_0;
+
+			while (re * re + im * im <= bailout && iteration < context.maxIters) {
+				tmp = re * re - im * im + cRe;
+				im	= 2 * re * im + cIm;
+				re	= tmp;
+				++iteration;
+			}
+
+			return iteration;
+		}
+	};
+
+	template<int64_t Power, bool Fold>
+	struct PowerIteration {
+		static constexpr bool blackInterior = true; // See PowerFractal::getColorLow
+
+		template<typename Scalar>
+		static int64_t iterate(const Scalar &re_0, const Scalar &im_0,
+							   const KernelContext &context, Scalar &re, Scalar &im) {
+			const Scalar bailout = static_cast<Scalar>(context.bailout);
+			int64_t iteration	 = 0;
+			re					 = 0;
+			im					 = 0;
+
+			while (re * re + im * im <= bailout && iteration < context.maxIters) {
+				if constexpr (Fold) {
+					re = lrc::abs(re);
+					im = lrc::abs(im);
+				}
+
+				unrolledPower<Power>(re, im);
+				re += re_0;
+				im += im_0;
+				++iteration;
+			}
+
+			return iteration;
+		}
+	};
+
+	/*
+	 * Colouring policies, wrapping the functions in coloringAlgorithms.hpp so they can
+	 * be passed as template parameters
+	 */
+
+	struct LogarithmicScaling {
+		template<typename Scalar>
+		static ci::ColorA color(const lrc::Complex<Scalar> &coord, int64_t iters,
+								const ColorPalette &palette) {
+			return coloring::logarithmicScaling(coord, iters, palette);
+		}
+	};
+
+	struct PalettedLogarithmicScaling {
+		template<typename Scalar>
+		static ci::ColorA color(const lrc::Complex<Scalar> &coord, int64_t iters,
+								const ColorPalette &palette) {
+			return coloring::palettedLogarithmicScaling(coord, iters, palette);
+		}
+	};
+
+	struct SteppedGradients {
+		template<typename Scalar>
+		static ci::ColorA color(const lrc::Complex<Scalar> &coord, int64_t iters,
+								const ColorPalette &palette) {
+			return coloring::steppedGradients(coord, iters, palette);
+		}
+	};
+
+	struct FixedIterPalette {
+		template<typename Scalar>
+		static ci::ColorA color(const lrc::Complex<Scalar> &coord, int64_t iters,
+								const ColorPalette &palette) {
+			return coloring::fixedIterPalette(coord, iters, palette);
+		}
+	};
+
+	/// Pixel positions are computed in double precision below the high precision tier
+	template<typename Scalar>
+	using Position = std::conditional_t<std::is_same_v<Scalar, HighPrecision>, HighVec2,
+										LowVec2>;
+
+	/// Calculate the colour of a pixel with a fixed fractal, colouring function and
+	/// precision. This produces the same result as FractalRenderer::pixelColorLow
+	/// (or High) with the matching virtual functions, but everything is inlined
+	/// \tparam Iteration Iteration policy
+	/// \tparam Coloring Colouring policy
+	/// \tparam Scalar Scalar type to iterate in
+	/// \tparam AntiAlias If false, a single sample is taken regardless of aliasFactor
+	/// \param context Per-render values
+	/// \param pixPos Fractal-space position of the pixel
+	/// \param sampleStep Fractal-space distance between anti-aliasing samples
+	/// \param samples Destination for the iteration data of each sample, in row-major
+	/// order, or nullptr
+	/// \return Colour of the pixel
+	template<typename Iteration, typename Coloring, typename Scalar, bool AntiAlias>
+	ci::ColorA pixelKernel(const KernelContext &context, const Position<Scalar> &pixPos,
+						   const Position<Scalar> &sampleStep, IterationSample *samples) {
+		using Coord =
+		  std::conditional_t<std::is_same_v<Scalar, HighPrecision>, HighPrecision,
+							 LowPrecision>;
+
+		const int64_t perAxis = AntiAlias ? context.aliasFactor : 1;
+		ci::ColorA pix(0, 0, 0, 1);
+
+		for (int64_t aliasY = 0; aliasY < perAxis; ++aliasY) {
+			for (int64_t aliasX = 0; aliasX < perAxis; ++aliasX) {
+				const Scalar re_0 = static_cast<Scalar>(
+				  pixPos.x() + sampleStep.x() * static_cast<Coord>(aliasX));
+				const Scalar im_0 = static_cast<Scalar>(
+				  pixPos.y() + sampleStep.y() * static_cast<Coord>(aliasY));
+
+				Scalar re, im;
+				const int64_t iters = Iteration::iterate(re_0, im_0, context, re, im);
+
+				const Scalar radiusSq = re * re + im * im;
+
+				if (samples) {
+					samples[aliasY * perAxis + aliasX] = {
+					  (int32_t)iters, static_cast<float>(static_cast<double>(radiusSq))};
+				}
+
+				if (Iteration::blackInterior && radiusSq < 4) {
+					pix += ci::ColorA(0, 0, 0, 1);
+				} else {
+					pix += Coloring::color(
+					  lrc::Complex<Scalar>(re, im), iters, *context.palette);
+				}
+			}
+		}
+
+		if (!AntiAlias) return pix;
+		return pix / static_cast<float>(perAxis * perAxis);
+	}
+
+	using LowKernel	 = ci::ColorA (*)(const KernelContext &, const LowVec2 &,
+									  const LowVec2 &, IterationSample *);
+	using HighKernel = ci::ColorA (*)(const KernelContext &, const HighVec2 &,
+									  const HighVec2 &, IterationSample *);
+
+	/// The kernels for one fractal and colouring function. Each array is indexed by
+	/// whether anti-aliasing is enabled
+	struct KernelSet {
+		LowKernel lowTier[2];
+		HighKernel highTier[2];
+	};
+
+	/// Find the specialised kernels for a fractal and colouring function
+	/// \param fractal Fractal name, as returned by Fractal::name()
+	/// \param colorFunc Colouring function name
+	/// \return The kernels, or nullptr if the combination has no specialisation, in
+	/// which case the fractal's virtual methods must be used
+	LIBRAPID_NODISCARD const KernelSet *findKernels(const std::string &fractal,
+													const std::string &colorFunc);
+} // namespace frac::kernels
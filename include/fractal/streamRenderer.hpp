@@ -0,0 +1,46 @@
+#pragma once
+
+namespace frac {
+	/// Renders images that are too large to fit in memory by splitting them into
+	/// horizontal bands. Each band is rendered with the regular FractalRenderer (so all
+	/// of its threads and optimisations are used) and then streamed to disk through an
+	/// ImageStreamWriter before the next band is started.
+	class StreamRenderer {
+	public:
+		StreamRenderer()								  = delete;
+		StreamRenderer(const StreamRenderer &)			  = delete;
+		StreamRenderer(StreamRenderer &&)				  = delete;
+		StreamRenderer &operator=(const StreamRenderer &) = delete;
+		StreamRenderer &operator=(StreamRenderer &&)	  = delete;
+
+		/// Construct a stream renderer on top of a configured FractalRenderer. The
+		/// renderer's current config defines the full image to be produced
+		/// \param renderer The renderer to use for each band
+		/// \param bandBudget Maximum number of bytes to allocate for a single band
+		StreamRenderer(FractalRenderer &renderer, int64_t bandBudget);
+
+		/// The number of image rows rendered per band, derived from the band budget
+		/// \return Rows per band
+		LIBRAPID_NODISCARD int64_t bandHeight() const;
+
+		/// Render the full image, starting from the first row not yet present in
+		/// \p writer. The renderer's configuration is restored afterwards, but its
+		/// surface is left at the size of a single band
+		/// \param writer Destination for the rendered rows
+		/// \return True if the full image was written
+		bool render(ImageStreamWriter &writer);
+
+		/// Build the configuration for a band of rows of a larger image. The pixel step
+		/// of the band is identical to that of the full image, so bands line up exactly
+		/// \param fullConfig Configuration of the full image
+		/// \param firstRow First row of the band
+		/// \param rows Number of rows in the band
+		/// \return Configuration for the band
+		LIBRAPID_NODISCARD static RenderConfig
+		bandConfig(const RenderConfig &fullConfig, int64_t firstRow, int64_t rows);
+
+	private:
+		FractalRenderer &m_renderer;
+		int64_t m_bandBudget;
+	};
+} // namespace frac
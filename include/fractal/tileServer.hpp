@@ -0,0 +1,127 @@
+#pragma once
+
+namespace frac {
+	/// Identifies a single tile in the deep-zoom pyramid
+	struct TileKey {
+		int64_t z; // Zoom level (the root view is split into 2^z x 2^z tiles)
+		int64_t x; // Column, from the left
+		int64_t y; // Row, from the top
+
+		bool operator<(const TileKey &other) const {
+			return std::tie(z, x, y) < std::tie(other.z, other.x, other.y);
+		}
+
+		bool operator==(const TileKey &other) const {
+			return z == other.z && x == other.x && y == other.y;
+		}
+	};
+
+	/// Serves slippy-map style tiles (`GET /{z}/{x}/{y}`) over HTTP on the loopback
+	/// interface. Tiles are rendered one at a time by a single dispatcher thread using
+	/// the FractalRenderer's thread pool, so each tile is split into render boxes as
+	/// usual.
+	///
+	/// - Concurrent requests for the same tile share a single render
+	/// - Queued tiles are rendered most-recently-requested first
+	/// - Queued tiles are dropped once every client waiting on them has disconnected
+	/// - Recently rendered tiles are kept in an LRU cache
+	///
+	/// `GET /stats` returns request counts and latency percentiles as JSON. This is only
+	/// available on POSIX systems.
+	class TileServer {
+	public:
+		using TileData = std::shared_ptr<const std::vector<uint8_t>>;
+
+		TileServer()							  = delete;
+		TileServer(const TileServer &)			  = delete;
+		TileServer(TileServer &&)				  = delete;
+		TileServer &operator=(const TileServer &) = delete;
+		TileServer &operator=(TileServer &&)	  = delete;
+
+		/// Construct a tile server. The renderer's current view becomes tile 0/0/0
+		/// (expanded to a square about its center)
+		/// \param renderer Configured renderer
+		/// \param port TCP port to listen on
+		/// \param tileSize Width and height of each tile in pixels
+		/// \param cacheSize Maximum number of rendered tiles to keep in memory
+		TileServer(FractalRenderer &renderer, int64_t port, int64_t tileSize,
+				   int64_t cacheSize);
+
+		~TileServer();
+
+		/// Accept and serve requests until an unrecoverable error occurs
+		/// \return Process exit code
+		int run();
+
+		/// Hammer a running tile server with requests from several client threads and
+		/// print the throughput and latency percentiles
+		/// \param port Port the server is listening on
+		/// \param clients Number of concurrent client threads
+		/// \param duration Length of the test in seconds
+		/// \param maxZoom Deepest zoom level to request
+		/// \return Process exit code
+		static int runLoadTest(int64_t port, int64_t clients, double duration,
+							   int64_t maxZoom);
+
+	private:
+		struct Tile {
+			TileKey key;
+			std::promise<TileData> promise;
+			std::shared_future<TileData> result;
+			int64_t waiters		   = 0;		// Clients waiting on this tile
+			uint64_t lastRequested = 0;		// Sequence number of the latest request
+			bool rendering		   = false; // Picked up by the dispatcher
+		};
+
+		/// Fetch a tile from the cache, or queue it and wait for it to be rendered
+		/// \param key The tile to fetch
+		/// \param client Socket of the requesting client (used to detect hang-ups)
+		/// \return Tile data, or nullptr if the client disconnected first
+		TileData requestTile(const TileKey &key, int client);
+
+		/// Render queued tiles until the server stops
+		void dispatchLoop();
+
+		/// Render a single tile and encode it as a BMP image
+		/// \param key The tile to render
+		/// \return Encoded tile
+		TileData renderTile(const TileKey &key);
+
+		/// Read a single request from a client, respond and close the connection
+		/// \param client Client socket
+		void handleConnection(int client);
+
+		/// Build the response body for `GET /stats`
+		/// \return JSON string
+		std::string statsJson();
+
+		FractalRenderer &m_renderer;
+		HighVec2 m_rootTopLeft;
+		HighPrecision m_rootSize;
+		int64_t m_basePrecision; // Precision of the settings, used for shallow tiles
+		int64_t m_port;
+		int64_t m_tileSize;
+		int64_t m_cacheSize;
+
+		std::atomic<bool> m_running = false;
+		std::atomic<int64_t> m_activeConnections = 0;
+		std::thread m_dispatcher;
+
+		std::mutex m_mutex; // Guards everything below
+		std::condition_variable m_workAvailable;
+		std::map<TileKey, std::shared_ptr<Tile>> m_tiles; // Queued and rendering tiles
+		std::list<std::pair<TileKey, TileData>> m_cache;  // Most recently used first
+		std::map<TileKey, std::list<std::pair<TileKey, TileData>>::iterator> m_cacheIndex;
+		uint64_t m_requestCounter = 0;
+
+		// Statistics
+		double m_startTime		= 0;
+		int64_t m_requests		= 0;
+		int64_t m_tilesRendered = 0;
+		int64_t m_cacheHits		= 0;
+		int64_t m_coalesced		= 0;
+		int64_t m_cancelled		= 0;
+		std::vector<double> m_latencies; // Latencies of the most recent requests
+		size_t m_latencyIndex = 0;
+	};
+} // namespace frac
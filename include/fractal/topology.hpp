@@ -0,0 +1,33 @@
+#pragma once
+
+namespace frac::topology {
+	/// A group of logical CPUs sharing the same local memory
+	struct NumaNode {
+		int64_t id;				   // Node number reported by the operating system
+		std::vector<int64_t> cpus; // Logical CPUs on this node the process may use
+	};
+
+	/// Detect the NUMA nodes of the machine. Only CPUs in the process's affinity mask
+	/// are included, so the result respects cpusets and taskset, and nodes with no
+	/// usable CPUs are dropped. On systems without NUMA information (or anything other
+	/// than Linux) every CPU is placed in a single node
+	/// \return The usable nodes
+	LIBRAPID_NODISCARD std::vector<NumaNode> detect();
+
+	/// Split the usable CPUs into \p nodes nodes of (nearly) equal size, ignoring the
+	/// real topology. This is useful for exercising placement on a single-socket
+	/// machine, or to model a larger machine inside a cpuset
+	/// \param nodes Number of nodes to create
+	/// \return The simulated nodes
+	LIBRAPID_NODISCARD std::vector<NumaNode> simulate(int64_t nodes);
+
+	/// Pin the calling thread to a single logical CPU
+	/// \param cpu The CPU to run on
+	/// \return True if the thread was pinned
+	bool pinCurrentThread(int64_t cpu);
+
+	/// Describe a topology in a single line, for logging
+	/// \param nodes The nodes to describe
+	/// \return Description, e.g. "2 nodes: [0-7] [8-15]"
+	LIBRAPID_NODISCARD std::string describe(const std::vector<NumaNode> &nodes);
+} // namespace frac::topology
@@ -0,0 +1,450 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	namespace {
+		// Samples closer than this (in samples) to a sample of the previous frame are
+		// treated as the same sample. This only absorbs rounding in the frame
+		// coordinates
+		constexpr double coincidenceTolerance = 1e-6;
+
+		// Interpolated samples are interpolated from at most this many times in a row,
+		// after which they are iterated again. This bounds how many frames anything
+		// hidden between the samples of one frame stays hidden for
+		constexpr uint8_t maxGenerations = 3;
+
+		// Where a sample of the new frame lies among the samples of the previous frame
+		// along one axis
+		struct AxisPosition {
+			int64_t first  = -1; // Sample before it, or -1 if it is outside the frame
+			int64_t second = -1; // Sample after it, which is first if they coincide
+			float weight   = 0;	 // Weight of the second sample
+		};
+
+		uint8_t toByte(float value) {
+			return (uint8_t)(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+		}
+
+		/// Locate each of \p count samples along one axis of the new frame among the
+		/// samples along the same axis of the previous frame
+		/// \param map Output positions
+		/// \param count Number of samples in the new frame
+		/// \param scale Ratio of the new sample spacing to the previous sample spacing
+		/// \param offset Position of the new frame's first sample in previous samples
+		/// \param limit Number of samples in the previous frame
+		/// \return True if at least one sample lies inside the previous frame
+		bool buildAxisMap(std::vector<AxisPosition> &map, int64_t count,
+						  const HighPrecision &scale, const HighPrecision &offset,
+						  int64_t limit) {
+			// The offset is only ever a few frame widths, so double precision is ample
+			// here, even when the frame coordinates themselves need far more
+			const double a = static_cast<double>(scale);
+			const double b = static_cast<double>(offset);
+
+			bool any = false;
+			map.assign(count, AxisPosition());
+			for (int64_t i = 0; i < count; ++i) {
+				const double u		 = a * (double)i + b;
+				const double nearest = std::round(u);
+				const double before	 = std::floor(u);
+
+				AxisPosition position;
+				if (std::abs(u - nearest) <= coincidenceTolerance) {
+					position.first	= (int64_t)nearest;
+					position.second = position.first;
+				} else {
+					position.first	= (int64_t)before;
+					position.second = position.first + 1;
+					position.weight = (float)(u - before);
+				}
+
+				if (position.first < 0 || position.second >= limit) continue;
+				map[i] = position;
+				any	   = true;
+			}
+			return any;
+		}
+	} // namespace
+
+	AnimationRenderer::AnimationRenderer(FractalRenderer &renderer, const View &start,
+										 const View &end, int64_t frames) :
+			m_renderer(renderer),
+			m_start(start),
+			m_end(end),
+			m_frames(lrc::max(int64_t(1), frames)) {
+		m_octavesPerFrame = 0;
+		if (m_frames > 1)
+			m_octavesPerFrame = octavesBetween(start.height, end.height) /
+								static_cast<double>(m_frames - 1);
+	}
+
+	double AnimationRenderer::octavesBetween(const HighPrecision &from,
+											 const HighPrecision &to) {
+		return static_cast<double>(lrc::log2(from / to));
+	}
+
+	HighPrecision AnimationRenderer::zoomHeight(const HighPrecision &height,
+												double octaves) {
+		// Apply whole octaves as exact powers of two, so frames a whole number of
+		// octaves apart have exactly proportional sample grids
+		const double whole		 = std::floor(octaves);
+		const HighPrecision half = HighPrecision(1) / HighPrecision(2);
+
+		HighPrecision result = height;
+		for (int64_t i = 0; i < (int64_t)whole; ++i) result *= half;
+		for (int64_t i = 0; i > (int64_t)whole; --i) result *= HighPrecision(2);
+
+		return result * HighPrecision(std::exp2(-(octaves - whole)));
+	}
+
+	AnimationRenderer::View AnimationRenderer::frameView(int64_t frame) const {
+		if (m_frames <= 1) return m_start;
+
+		View view;
+		view.height = zoomHeight(m_start.height, m_octavesPerFrame * (double)frame);
+
+		// Move the center in proportion to how far the zoom has progressed. For a pure
+		// pan (no change in height), move it linearly instead
+		HighPrecision progress;
+		if (m_start.height == m_end.height) {
+			progress = HighPrecision(frame) / HighPrecision(m_frames - 1);
+		} else {
+			progress =
+			  (m_start.height - view.height) / (m_start.height - m_end.height);
+		}
+
+		view.center = m_start.center + (m_end.center - m_start.center) *
+										 HighVec2(progress, progress);
+		return view;
+	}
+
+	void AnimationRenderer::setSampleReuse(bool reuse) { m_reuse = reuse; }
+
+	void AnimationRenderer::setInterpolatedReuse(bool interpolate) {
+		m_interpolate = interpolate;
+	}
+
+	bool AnimationRenderer::render(std::FILE *output, Format format, int64_t fps) {
+		const RenderConfig original = m_renderer.config();
+		const bool keptIterations	= m_renderer.keepIterationData();
+		RenderConfig &config		= m_renderer.config();
+
+		// Anti-aliasing is replaced by rendering at a higher resolution and filtering
+		// down when writing, so that every sample is a pixel of the iteration data
+		m_supersample = lrc::max(int64_t(1), original.antiAlias);
+		m_outputSize  = original.imageSize;
+
+		const HighPrecision aspect = original.fracSize.x() / original.fracSize.y();
+		const int64_t width		   = m_outputSize.x() * m_supersample;
+		const int64_t height	   = m_outputSize.y() * m_supersample;
+
+		config.imageSize   = lrc::Vec2i(width, height);
+		config.antiAlias   = 1;
+		config.draftRender = false;
+		m_renderer.updateRenderConfig();
+		m_renderer.regenerateSurface();
+
+		// Frames are only iterated here. They are coloured on the encoding thread
+		m_renderer.setKeepIterationData(true);
+		m_renderer.setDeferredColoring(true);
+
+		writeStreamHeader(output, format, m_outputSize, fps);
+
+		FRAC_LOG(fmt::format("Rendering {} frame animation at {}x{} (supersampled {}x)",
+							 m_frames,
+							 m_outputSize.x(),
+							 m_outputSize.y(),
+							 m_supersample));
+
+		const double start	= lrc::now();
+		int64_t totalReused = 0;
+		bool success		= true;
+		std::future<bool> encoder;
+		std::shared_ptr<const Frame> previous;
+
+		for (int64_t frame = 0; frame < m_frames; ++frame) {
+			const View view = frameView(frame);
+			m_renderer.moveFractalCenter(view.center,
+										 HighVec2(view.height * aspect, view.height));
+
+			// The encoding thread may still be colouring the previous frame, but both
+			// only read its iteration data
+			std::vector<uint8_t> mask;
+			IterationBuffer seed;
+			std::vector<uint8_t> generations;
+			int64_t reused = 0;
+			if (m_reuse && previous && !previous->samples.empty())
+				reused = seedFromPrevious(*previous, mask, seed, generations);
+			m_renderer.setKnownPixels(std::move(mask), std::move(seed));
+
+			auto rendered	  = std::make_shared<Frame>();
+			rendered->render  = m_renderer.renderFractal();
+			rendered->topLeft = config.fracTopLeft;
+			rendered->step	  = config.fracSize / HighVec2(width, height);
+			rendered->width	  = width;
+			rendered->height  = height;
+			if (!rendered->render.wait()) {
+				success = false;
+				break;
+			}
+
+			rendered->samples = m_renderer.takeIterationData();
+			if (rendered->samples.empty()) {
+				ImageStreamWriter::packRows(
+				  m_renderer.surface(), height, rendered->pixels);
+			} else {
+				if (generations.empty()) generations.assign(width * height, 0);
+				rendered->generations = std::move(generations);
+			}
+
+			// Frames must be written in order, so the previous frame has to be finished
+			// before this one is handed over. It has had the whole of this frame's
+			// iteration to complete, so this rarely waits
+			if (encoder.valid() && !encoder.get()) {
+				success = false;
+				break;
+			}
+
+			encoder = std::async(std::launch::async, [this, rendered, output, format]() {
+				return writeFrame(*rendered, output, format);
+			});
+			previous = rendered;
+
+			// Progress goes to stderr, since stdout usually carries the video
+			totalReused += reused;
+			const double elapsed = lrc::now() - start;
+			const double fpsDone = (double)(frame + 1) / elapsed;
+			fmt::print(stderr,
+					   "\r[{:6.2f}%] Frame {} / {} | {:.2f} frames/s | {:.1f}% reused | "
+					   "ETA {}   ",
+					   100.0 * (double)(frame + 1) / (double)m_frames,
+					   frame + 1,
+					   m_frames,
+					   fpsDone,
+					   100.0 * (double)reused / (double)(width * height),
+					   lrc::formatTime((double)(m_frames - frame - 1) / fpsDone));
+		}
+
+		if (encoder.valid() && !encoder.get()) success = false;
+		std::fflush(output);
+
+		fmt::print(stderr,
+				   "\nRendered {} frames in {} ({:.1f}% of samples reused)\n",
+				   m_frames,
+				   lrc::formatTime(lrc::now() - start),
+				   100.0 * (double)totalReused / (double)(width * height * m_frames));
+
+		// Restore the original view, surface and iteration data settings
+		m_renderer.setKnownPixels({});
+		m_renderer.setDeferredColoring(false);
+		m_renderer.setKeepIterationData(keptIterations);
+		config = original;
+		m_renderer.updateRenderConfig();
+		m_renderer.regenerateSurface();
+
+		if (!success) FRAC_ERROR("Failed to render animation frame");
+		return success;
+	}
+
+	int64_t AnimationRenderer::seedFromPrevious(const Frame &previous,
+												std::vector<uint8_t> &mask,
+												IterationBuffer &samples,
+												std::vector<uint8_t> &generations) const {
+		const RenderConfig &config = m_renderer.config();
+		const int64_t width		   = config.imageSize.x();
+		const int64_t height	   = config.imageSize.y();
+		const HighVec2 step		   =
+		  config.fracSize / static_cast<HighVec2>(config.imageSize);
+
+		const HighVec2 scale  = step / previous.step;
+		const HighVec2 offset = (config.fracTopLeft - previous.topLeft) / previous.step;
+
+		std::vector<AxisPosition> mapX;
+		std::vector<AxisPosition> mapY;
+		if (!buildAxisMap(mapX, width, scale.x(), offset.x(), previous.width) ||
+			!buildAxisMap(mapY, height, scale.y(), offset.y(), previous.height))
+			return 0;
+
+		// The entries of pixels that are not reused are written by the render
+		mask.assign(width * height, 0);
+		samples.resize(width * height);
+		generations.assign(width * height, 0);
+		int64_t reused = 0;
+
+		for (int64_t y = 0; y < height; ++y) {
+			const AxisPosition &posY = mapY[y];
+			if (posY.first < 0) continue;
+
+			const int64_t rowA			 = posY.first * previous.width;
+			const int64_t rowB			 = posY.second * previous.width;
+			const IterationSample *fromA = previous.samples.data() + rowA;
+			const IterationSample *fromB = previous.samples.data() + rowB;
+			const uint8_t *generationA	 = previous.generations.data() + rowA;
+			const uint8_t *generationB	 = previous.generations.data() + rowB;
+
+			for (int64_t x = 0; x < width; ++x) {
+				const AxisPosition &posX = mapX[x];
+				if (posX.first < 0) continue;
+
+				const int64_t index = y * width + x;
+				if (posX.first == posX.second && posY.first == posY.second) {
+					// A copy of a sample is as good as the sample itself
+					samples[index]	   = fromA[posX.first];
+					generations[index] = generationA[posX.first];
+				} else {
+					if (!m_interpolate) continue;
+
+					// Only interpolate between samples with the same iteration count,
+					// none of which has been interpolated too many times already
+					const IterationSample &s00 = fromA[posX.first];
+					const IterationSample &s10 = fromA[posX.second];
+					const IterationSample &s01 = fromB[posX.first];
+					const IterationSample &s11 = fromB[posX.second];
+					if (s00.iters != s10.iters || s00.iters != s01.iters ||
+						s00.iters != s11.iters)
+						continue;
+
+					const uint8_t generation =
+					  std::max({generationA[posX.first],
+								generationA[posX.second],
+								generationB[posX.first],
+								generationB[posX.second]});
+					if (generation >= maxGenerations) continue;
+
+					// Within an iteration band, the final magnitude varies smoothly
+					const float top =
+					  s00.radiusSq + (s10.radiusSq - s00.radiusSq) * posX.weight;
+					const float bottom =
+					  s01.radiusSq + (s11.radiusSq - s01.radiusSq) * posX.weight;
+					const float radiusSq = top + (bottom - top) * posY.weight;
+
+					samples[index]	   = {s00.iters, radiusSq};
+					generations[index] = (uint8_t)(generation + 1);
+				}
+
+				mask[index] = 1;
+				++reused;
+			}
+		}
+
+		// An empty mask leaves every optimisation available to the render
+		if (reused == 0) {
+			mask.clear();
+			IterationBuffer().swap(samples);
+			generations.clear();
+		}
+		return reused;
+	}
+
+	void AnimationRenderer::colorFrame(const Frame &frame, std::vector<uint8_t> &pixels) {
+		const RenderJob &job   = frame.render.job();
+		const int64_t maxIters = job.config.maxIters;
+
+		// The renderer's histogram belongs to the frame it is iterating now, so the
+		// frame's own histogram is built here
+		coloring::IterationHistogram histogram;
+		if (job.histogramColoring) {
+			histogram.reset(maxIters);
+			histogram.add(frame.samples.data(), frame.width * frame.height);
+			histogram.finalise();
+		}
+
+		pixels.resize(frame.width * frame.height * 3);
+		std::vector<ci::ColorA> colors(frame.width);
+		for (int64_t y = 0; y < frame.height; ++y) {
+			FractalRenderer::colorSamples(job,
+										  frame.samples.data() + y * frame.width,
+										  frame.width,
+										  maxIters,
+										  histogram,
+										  colors.data());
+
+			uint8_t *dst = pixels.data() + y * frame.width * 3;
+			for (int64_t x = 0; x < frame.width; ++x, dst += 3) {
+				dst[0] = toByte(colors[x].r);
+				dst[1] = toByte(colors[x].g);
+				dst[2] = toByte(colors[x].b);
+			}
+		}
+	}
+
+	bool AnimationRenderer::writeFrame(const Frame &frame, std::FILE *output,
+									   Format format) const {
+		const int64_t width	  = m_outputSize.x();
+		const int64_t height  = m_outputSize.y();
+		const int64_t samples = m_supersample * m_supersample;
+
+		// Colouring happens here, rather than on the render threads, so the next frame
+		// can iterate in the meantime
+		std::vector<uint8_t> colored;
+		if (!frame.samples.empty()) colorFrame(frame, colored);
+		const std::vector<uint8_t> &pixels =
+		  frame.samples.empty() ? frame.pixels : colored;
+
+		// Box-filter the supersampled frame down to the output size
+		std::vector<uint8_t> rgb(width * height * 3);
+		for (int64_t y = 0; y < height; ++y) {
+			for (int64_t x = 0; x < width; ++x) {
+				uint32_t sum[3] = {0, 0, 0};
+				for (int64_t sy = 0; sy < m_supersample; ++sy) {
+					const int64_t row = y * m_supersample + sy;
+					const uint8_t *src =
+					  pixels.data() + (row * frame.width + x * m_supersample) * 3;
+					for (int64_t sx = 0; sx < m_supersample; ++sx, src += 3) {
+						sum[0] += src[0];
+						sum[1] += src[1];
+						sum[2] += src[2];
+					}
+				}
+
+				uint8_t *dst = rgb.data() + (y * width + x) * 3;
+				for (int64_t c = 0; c < 3; ++c)
+					dst[c] = (uint8_t)((sum[c] + samples / 2) / samples);
+			}
+		}
+
+		return writeImage(rgb.data(), width, height, output, format);
+	}
+
+	bool AnimationRenderer::writeStreamHeader(std::FILE *output, Format format,
+											  const lrc::Vec2i &size, int64_t fps) {
+		if (format != Format::Y4M) return true;
+
+		std::string header = fmt::format(
+		  "YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C444\n", size.x(), size.y(), fps);
+		return std::fwrite(header.data(), 1, header.size(), output) == header.size();
+	}
+
+	bool AnimationRenderer::writeImage(const uint8_t *rgb, int64_t width, int64_t height,
+									   std::FILE *output, Format format) {
+		const size_t bytes = width * height * 3;
+
+		if (format == Format::PPM) {
+			std::string header = fmt::format("P6\n{} {}\n255\n", width, height);
+			const size_t written =
+			  std::fwrite(header.data(), 1, header.size(), output) +
+			  std::fwrite(rgb, 1, bytes, output);
+			return written == header.size() + bytes;
+		}
+
+		// YUV4MPEG2 frames are planar: a full Y plane, then U, then V
+		const int64_t planeSize = width * height;
+		std::vector<uint8_t> yuv(planeSize * 3);
+		for (int64_t i = 0; i < planeSize; ++i) {
+			const double r = rgb[i * 3 + 0];
+			const double g = rgb[i * 3 + 1];
+			const double b = rgb[i * 3 + 2];
+
+			// BT.601, limited range
+			yuv[i] = (uint8_t)std::clamp(
+			  16.0 + (65.738 * r + 129.057 * g + 25.064 * b) / 256.0 + 0.5, 0.0, 255.0);
+			yuv[planeSize + i] = (uint8_t)std::clamp(
+			  128.0 + (-37.945 * r - 74.494 * g + 112.439 * b) / 256.0 + 0.5, 0.0, 255.0);
+			yuv[planeSize * 2 + i] = (uint8_t)std::clamp(
+			  128.0 + (112.439 * r - 94.154 * g - 18.285 * b) / 256.0 + 0.5, 0.0, 255.0);
+		}
+
+		static const char frameHeader[] = "FRAME\n";
+		return std::fwrite(frameHeader, 1, 6, output) == 6 &&
+			   std::fwrite(yuv.data(), 1, yuv.size(), output) == yuv.size();
+	}
+} // namespace frac
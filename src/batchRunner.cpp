@@ -0,0 +1,168 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	BatchRunner::BatchRunner(int64_t numThreads, int64_t maxInFlight) :
+			m_threadPool((unsigned)lrc::max(int64_t(1), numThreads)),
+			m_maxInFlight(lrc::max(int64_t(1), maxInFlight)) {}
+
+	bool BatchRunner::loadJobFile(const std::string &path, std::vector<BatchJob> &jobs) {
+		json jobList;
+		if (!headless::loadSettings(path, jobList)) return false;
+
+		if (!jobList.is_array()) {
+			FRAC_ERROR(fmt::format("Job file {} must contain a JSON array", path));
+			return false;
+		}
+
+		const std::filesystem::path baseDir = std::filesystem::path(path).parent_path();
+		auto resolve = [&](const std::string &file) {
+			std::filesystem::path filePath(file);
+			if (filePath.is_relative()) filePath = baseDir / filePath;
+			return filePath.string();
+		};
+
+		for (const auto &entry : jobList) {
+			if (!entry.contains("settings") || !entry.contains("output")) {
+				FRAC_ERROR(fmt::format("Job {} in {} needs \"settings\" and \"output\"",
+									   jobs.size(),
+									   path));
+				return false;
+			}
+
+			jobs.push_back({resolve(entry["settings"].get<std::string>()),
+							resolve(entry["output"].get<std::string>())});
+		}
+
+		return true;
+	}
+
+	bool BatchRunner::run(const std::vector<BatchJob> &jobs) {
+		std::vector<JobResult> results(jobs.size());
+		std::vector<std::thread> drivers;
+		drivers.reserve(jobs.size());
+		int64_t completed = 0;
+
+		fmt::print("Running {} jobs on {} threads, at most {} at a time\n",
+				   jobs.size(),
+				   m_threadPool.get_thread_count(),
+				   m_maxInFlight);
+
+		const double start = lrc::now();
+
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			// Wait for a free slot, so no more than m_maxInFlight surfaces are alive
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_slotFree.wait(lock, [this]() { return m_inFlight < m_maxInFlight; });
+				++m_inFlight;
+			}
+
+			drivers.emplace_back([&, i]() {
+				JobResult result = runJob(jobs[i]);
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				results[i] = result;
+				++completed;
+				--m_inFlight;
+				m_slotFree.notify_one();
+
+				if (!result.success) {
+					fmt::print(
+					  "[{}/{}] {} failed\n", completed, jobs.size(), jobs[i].output);
+					return;
+				}
+
+				fmt::print("[{}/{}] {} | {:.2f} Mpx | setup {} | render {} | export {} | "
+						   "{:.2f} Mpx/s\n",
+						   completed,
+						   jobs.size(),
+						   jobs[i].output,
+						   (double)result.pixels / 1e6,
+						   lrc::formatTime(result.setupTime),
+						   lrc::formatTime(result.renderTime),
+						   lrc::formatTime(result.exportTime),
+						   (double)result.pixels / 1e6 / result.renderTime);
+			});
+		}
+
+		for (auto &driver : drivers) driver.join();
+
+		const double elapsed = lrc::now() - start;
+
+		int64_t failed		= 0;
+		int64_t totalPixels = 0;
+		double renderTime	= 0;
+		for (const auto &result : results) {
+			if (!result.success) {
+				++failed;
+				continue;
+			}
+			totalPixels += result.pixels;
+			renderTime += result.renderTime;
+		}
+
+		// Render times overlap, so their sum exceeding the wall-clock time shows how
+		// much of the batch was spent with several jobs rendering at once
+		fmt::print("\nCompleted {} of {} jobs in {}\n",
+				   (int64_t)jobs.size() - failed,
+				   jobs.size(),
+				   lrc::formatTime(elapsed));
+		fmt::print("Throughput: {:.2f} jobs/min, {:.2f} Mpx/s\n",
+				   (double)(jobs.size() - failed) * 60.0 / elapsed,
+				   (double)totalPixels / 1e6 / elapsed);
+		fmt::print("Render overlap: {:.2f}x (sum of job render times / wall time)\n",
+				   renderTime / elapsed);
+
+		return failed == 0;
+	}
+
+	BatchRunner::JobResult BatchRunner::runJob(const BatchJob &job) {
+		JobResult result;
+		const double start = lrc::now();
+
+		json settings;
+		if (!headless::loadSettings(job.settings, settings)) return result;
+
+		FractalRenderer renderer;
+		if (!headless::configureRenderer(renderer, settings)) return result;
+
+		RenderConfig &config = renderer.config();
+		config.draftRender	 = false;
+		renderer.setSharedThreadPool(&m_threadPool);
+		renderer.regenerateSurface();
+		result.pixels = config.imageSize.x() * config.imageSize.y();
+
+		const double renderStart = lrc::now();
+		result.setupTime		 = renderStart - start;
+		renderer.renderFractal();
+		renderer.waitForRender();
+
+		const double exportStart = lrc::now();
+		result.renderTime		 = exportStart - renderStart;
+
+		// PPM and raw output go through the stream writer, everything else through
+		// Cinder (PNG, JPEG, TIFF, ...)
+		const std::string extension =
+		  std::filesystem::path(job.output).extension().string();
+		if (extension == ".ppm" || extension == ".raw") {
+			ImageStreamWriter writer(job.output,
+									 config.imageSize,
+									 ImageStreamWriter::formatFromPath(job.output),
+									 false);
+			if (!writer.isOpen() ||
+				!writer.writeRows(renderer.surface(), config.imageSize.y()))
+				return result;
+		} else {
+			try {
+				renderer.exportImage(job.output);
+			} catch (std::exception &e) {
+				FRAC_ERROR(fmt::format("Failed to export {}: {}", job.output, e.what()));
+				return result;
+			}
+		}
+
+		result.exportTime = lrc::now() - exportStart;
+		result.success	  = true;
+		return result;
+	}
+} // namespace frac
@@ -4,6 +4,7 @@ namespace frac {
 	void ColorPalette::addColor(const ColorType &color) {
 		m_colors.push_back(color);
 		FRAC_LOG(fmt::format("Adding Color: {} {} {} {}", color.x(), color.y(), color.z(), color.w()));
+		updateLookupTable();
 	}
 
 	size_t ColorPalette::size() const { return m_colors.size(); }
@@ -25,4 +26,32 @@ namespace frac {
 	ColorPalette::ColorType ColorPalette::merge(const ColorType &a, const ColorType &b, float t) {
 		return a + (b - a) * t;
 	}
+
+	void ColorPalette::updateLookupTable() {
+		const auto numColors = (int64_t)m_colors.size();
+		m_lookupTable.resize(numColors * lookupResolution);
+
+		for (int64_t i = 0; i < numColors; ++i) {
+			const ColorType &from = m_colors[i];
+			const ColorType &to	  = m_colors[(i + 1) % numColors];
+			for (int64_t j = 0; j < lookupResolution; ++j) {
+				m_lookupTable[i * lookupResolution + j] =
+				  merge(from, to, (float)j / (float)lookupResolution);
+			}
+		}
+	}
+
+	const ColorPalette::ColorType &ColorPalette::lookup(float position) const {
+		static const ColorType black(0, 0, 0, 1);
+		if (m_lookupTable.empty()) return black;
+
+		// Also catches NaN, which the smooth iteration count gives for points that
+		// never escaped
+		if (!(std::abs(position) < 1e15f)) position = 0;
+
+		const auto size = (int64_t)m_lookupTable.size();
+		int64_t index	= (int64_t)std::floor(position * (float)lookupResolution) % size;
+		if (index < 0) index += size;
+		return m_lookupTable[index];
+	}
 } // namespace frac
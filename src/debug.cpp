@@ -1,14 +1,26 @@
 #include <fractal/fractal.hpp>
 
 namespace frac {
-	DebugLogger::DebugLogger(const std::string &filename, Priority priority) {
-		m_log.open(filename, std::fstream::out);
+	DebugLogger::DebugLogger(const std::string &filename, Priority priority) :
+			m_filename(filename) {
 		m_startTime = lrc::now();
+	}
+
+	DebugLogger::~DebugLogger() { close(); }
 
+	void DebugLogger::setFilename(const std::string &filename) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		close();
+		m_filename = filename;
+	}
+
+	void DebugLogger::open() {
+		m_log.open(m_filename, std::fstream::out);
 		m_log << "============[ FRACTAL RENDERER DEBUG LOG ]============\n" << std::endl;
 	}
 
-	DebugLogger::~DebugLogger() {
+	void DebugLogger::close() {
+		if (!m_log.is_open()) return;
 		m_log << "\n============[ FRACTAL RENDERER DEBUG LOG ]============";
 		m_log.flush();
 		m_log.close();
@@ -18,6 +30,10 @@ namespace frac {
 							const std::string &filename, int64_t line) {
 		if (static_cast<size_t>(priority) < static_cast<size_t>(m_priority)) return;
 
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_filename.empty()) return;
+		if (!m_log.is_open()) open();
+
 		double time						   = lrc::now();
 		constexpr size_t maxFilenameLength = 40;
 		std::string truncatedFilename;
@@ -0,0 +1,43 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	DirtyRegionList::~DirtyRegionList() { clear(); }
+
+	void DirtyRegionList::mark(const SurfaceRegion &region) {
+		Node *node = new Node {region, m_head.load(std::memory_order_relaxed)};
+		while (!m_head.compare_exchange_weak(
+		  node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+	}
+
+	bool DirtyRegionList::empty() const {
+		return m_head.load(std::memory_order_relaxed) == nullptr;
+	}
+
+	size_t DirtyRegionList::consume(std::vector<SurfaceRegion> &regions) {
+		// The list is newest first, so it is appended backwards
+		const size_t start = regions.size();
+		for (Node *node = take(); node != nullptr;) {
+			regions.push_back(node->region);
+			Node *next = node->next;
+			delete node;
+			node = next;
+		}
+
+		std::reverse(regions.begin() + (std::ptrdiff_t)start, regions.end());
+		return regions.size() - start;
+	}
+
+	void DirtyRegionList::clear() {
+		for (Node *node = take(); node != nullptr;) {
+			Node *next = node->next;
+			delete node;
+			node = next;
+		}
+	}
+
+	DirtyRegionList::Node *DirtyRegionList::take() {
+		// Nodes are never reused while in the list, so taking all of them at once does
+		// not suffer from the ABA problem a single pop would
+		return m_head.exchange(nullptr, std::memory_order_acquire);
+	}
+} // namespace frac
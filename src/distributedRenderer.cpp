@@ -0,0 +1,344 @@
+#include <fractal/fractal.hpp>
+
+#if !defined(_WIN32)
+#	include <fcntl.h>
+#	include <poll.h>
+#	include <signal.h>
+#	include <sys/wait.h>
+#	include <unistd.h>
+#endif
+
+namespace frac {
+#if !defined(_WIN32)
+	namespace {
+		// Refuse messages larger than this, since they can only be the result of a
+		// corrupted stream
+		constexpr uint64_t maxMessageSize = uint64_t(1) << 36;
+
+		/// Write exactly \p bytes bytes to a file descriptor
+		bool writeAll(int fd, const void *data, size_t bytes) {
+			const auto *ptr = static_cast<const char *>(data);
+			while (bytes > 0) {
+				ssize_t written = ::write(fd, ptr, bytes);
+				if (written < 0 && errno == EINTR) continue;
+				if (written <= 0) return false;
+				ptr += written;
+				bytes -= static_cast<size_t>(written);
+			}
+			return true;
+		}
+
+		/// Read exactly \p bytes bytes from a file descriptor
+		bool readAll(int fd, void *data, size_t bytes) {
+			auto *ptr = static_cast<char *>(data);
+			while (bytes > 0) {
+				ssize_t received = ::read(fd, ptr, bytes);
+				if (received < 0 && errno == EINTR) continue;
+				if (received <= 0) return false; // Error or end of stream
+				ptr += received;
+				bytes -= static_cast<size_t>(received);
+			}
+			return true;
+		}
+
+		/// Messages are sent as a 64-bit length followed by the payload
+		bool writeMessage(int fd, const void *data, uint64_t bytes) {
+			return writeAll(fd, &bytes, sizeof(bytes)) && writeAll(fd, data, bytes);
+		}
+
+		bool readMessage(int fd, std::vector<uint8_t> &out) {
+			uint64_t bytes = 0;
+			if (!readAll(fd, &bytes, sizeof(bytes))) return false;
+			if (bytes > maxMessageSize) return false;
+			out.resize(bytes);
+			return readAll(fd, out.data(), bytes);
+		}
+	} // namespace
+#endif
+
+	DistributedRenderer::DistributedRenderer(FractalRenderer &renderer,
+											 std::string executable, int64_t numWorkers,
+											 int64_t threadsPerWorker,
+											 int64_t rowsPerJob) :
+			m_renderer(renderer),
+			m_executable(std::move(executable)),
+			m_numWorkers(lrc::max(int64_t(1), numWorkers)),
+			m_threadsPerWorker(lrc::max(int64_t(1), threadsPerWorker)),
+			m_rowsPerJob(lrc::max(int64_t(1), rowsPerJob)) {}
+
+	DistributedRenderer::~DistributedRenderer() {
+		for (auto &worker : m_workers) stopWorker(worker, true);
+	}
+
+	bool DistributedRenderer::render(ImageStreamWriter &writer) {
+#if defined(_WIN32)
+		FRAC_ERROR("Distributed rendering is only supported on POSIX systems");
+		return false;
+#else
+		// A worker dying mid-write must not take the coordinator down with it
+		signal(SIGPIPE, SIG_IGN);
+
+		const int64_t imageWidth  = m_renderer.config().imageSize.x();
+		const int64_t imageHeight = m_renderer.config().imageSize.y();
+		const int64_t firstRow	  = writer.rowsWritten();
+
+		std::vector<TileJob> jobs;
+		for (int64_t row = firstRow; row < imageHeight; row += m_rowsPerJob) {
+			jobs.push_back(
+			  {(int64_t)jobs.size(), row, lrc::min(m_rowsPerJob, imageHeight - row)});
+		}
+
+		std::deque<int64_t> pending;
+		for (const auto &job : jobs) pending.push_back(job.id);
+
+		// Jobs can finish out of order, so hold on to them until every job before them
+		// has been written
+		std::map<int64_t, std::vector<uint8_t>> finished;
+		int64_t nextToWrite = 0;
+
+		// Limit the number of replacement workers, so a worker that crashes on start-up
+		// cannot cause an endless spawn loop
+		int64_t respawnsLeft = m_numWorkers * 4;
+
+		m_workers.resize(m_numWorkers);
+		for (auto &worker : m_workers) {
+			if (!spawnWorker(worker)) return false;
+		}
+
+		auto handleFailure = [&](Worker &worker) {
+			FRAC_WARN(fmt::format(
+			  "Worker {} failed. Re-queueing job {}", worker.pid, worker.job));
+			if (worker.job >= 0) pending.push_front(worker.job);
+			worker.job = -1;
+			stopWorker(worker, true);
+			if (respawnsLeft-- > 0) spawnWorker(worker);
+		};
+
+		FRAC_LOG(fmt::format(
+		  "Distributing {} jobs over {} workers", jobs.size(), m_numWorkers));
+
+		const double start = lrc::now();
+		std::vector<uint8_t> header;
+		std::vector<uint8_t> pixels;
+
+		while (nextToWrite < (int64_t)jobs.size()) {
+			// Hand out work to any idle workers
+			for (auto &worker : m_workers) {
+				if (worker.pid < 0 || worker.job >= 0 || pending.empty()) continue;
+
+				const int64_t jobId = pending.front();
+				pending.pop_front();
+
+				std::string message = serialiseJob(jobs[jobId]);
+				worker.job			= jobId;
+				if (!writeMessage(worker.toWorker, message.data(), message.size()))
+					handleFailure(worker);
+			}
+
+			std::vector<pollfd> fds;
+			std::vector<Worker *> busy;
+			for (auto &worker : m_workers) {
+				if (worker.pid < 0 || worker.job < 0) continue;
+				fds.push_back({worker.fromWorker, POLLIN, 0});
+				busy.push_back(&worker);
+			}
+
+			if (fds.empty()) {
+				FRAC_ERROR("No workers left to render with");
+				return false;
+			}
+
+			if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+				FRAC_ERROR(fmt::format("poll() failed: {}", std::strerror(errno)));
+				return false;
+			}
+
+			for (size_t i = 0; i < fds.size(); ++i) {
+				if (fds[i].revents == 0) continue;
+				Worker &worker = *busy[i];
+
+				if (!readMessage(worker.fromWorker, header) ||
+					!readMessage(worker.fromWorker, pixels)) {
+					handleFailure(worker);
+					continue;
+				}
+
+				const TileJob &job = jobs[worker.job];
+
+				json result = json::parse(header.begin(), header.end(), nullptr, false);
+				if (result.is_discarded() || result["id"] != job.id ||
+					(int64_t)pixels.size() != imageWidth * job.rows * 3) {
+					handleFailure(worker);
+					continue;
+				}
+
+				finished[job.id] = std::move(pixels);
+				worker.job		 = -1;
+				worker.jobsDone += 1;
+			}
+
+			// Write out every band that is now contiguous with the rest of the image
+			for (auto it = finished.find(nextToWrite); it != finished.end();
+				 it = finished.find(nextToWrite)) {
+				if (!writer.writePacked(it->second.data(), jobs[nextToWrite].rows)) {
+					FRAC_ERROR(fmt::format("Failed to write job {}", nextToWrite));
+					return false;
+				}
+				finished.erase(it);
+				++nextToWrite;
+			}
+
+			const int64_t done	 = writer.rowsWritten();
+			const double elapsed = lrc::now() - start;
+			fmt::print("\r[{:6.2f}%] {} / {} rows | {:.1f} rows/s   ",
+					   100.0 * (double)done / (double)imageHeight,
+					   done,
+					   imageHeight,
+					   (double)(done - firstRow) / elapsed);
+			std::fflush(stdout);
+		}
+
+		const double elapsed = lrc::now() - start;
+		fmt::print("\nRendered {} rows in {} ({:.1f} rows/s)\n",
+				   imageHeight - firstRow,
+				   lrc::formatTime(elapsed),
+				   (double)(imageHeight - firstRow) / elapsed);
+
+		for (size_t i = 0; i < m_workers.size(); ++i) {
+			fmt::print("  Worker {}: {} jobs\n", i, m_workers[i].jobsDone);
+			stopWorker(m_workers[i], false);
+		}
+
+		return true;
+#endif
+	}
+
+	int DistributedRenderer::runWorker() {
+#if defined(_WIN32)
+		FRAC_ERROR("Distributed rendering is only supported on POSIX systems");
+		return 1;
+#else
+		// Every worker runs from the coordinator's directory, so log to a file of our
+		// own rather than truncating and interleaving with the coordinator's log
+		debugLogger.setFilename(fmt::format("./log-worker-{}.txt", getpid()));
+
+		FractalRenderer renderer;
+		std::vector<uint8_t> message;
+		std::vector<uint8_t> pixels;
+
+		// The coordinator closes stdin when there is no more work
+		while (readMessage(STDIN_FILENO, message)) {
+			json job = json::parse(message.begin(), message.end(), nullptr, false);
+			if (job.is_discarded()) {
+				FRAC_ERROR("Received an invalid job");
+				return 1;
+			}
+
+			if (!headless::configureRenderer(renderer, job["settings"])) return 1;
+			renderer.config().draftRender = false;
+			renderer.regenerateSurface();
+			renderer.renderFractal();
+			renderer.waitForRender();
+
+			const RenderConfig &config = renderer.config();
+			ImageStreamWriter::packRows(renderer.surface(), config.imageSize.y(), pixels);
+
+			std::string header = json {{"id", job["id"]},
+										{"width", config.imageSize.x()},
+										{"rows", config.imageSize.y()}}
+								   .dump();
+
+			if (!writeMessage(STDOUT_FILENO, header.data(), header.size()) ||
+				!writeMessage(STDOUT_FILENO, pixels.data(), pixels.size()))
+				return 1;
+		}
+
+		return 0;
+#endif
+	}
+
+	bool DistributedRenderer::spawnWorker(Worker &worker) {
+#if defined(_WIN32)
+		return false;
+#else
+		int toChild[2];
+		int fromChild[2];
+		if (pipe(toChild) != 0) {
+			FRAC_ERROR(fmt::format("pipe() failed: {}", std::strerror(errno)));
+			return false;
+		}
+		if (pipe(fromChild) != 0) {
+			FRAC_ERROR(fmt::format("pipe() failed: {}", std::strerror(errno)));
+			close(toChild[0]);
+			close(toChild[1]);
+			return false;
+		}
+
+		pid_t pid = fork();
+		if (pid < 0) {
+			FRAC_ERROR(fmt::format("fork() failed: {}", std::strerror(errno)));
+			for (int fd : {toChild[0], toChild[1], fromChild[0], fromChild[1]}) close(fd);
+			return false;
+		}
+
+		if (pid == 0) {
+			// Child: wire the pipes to stdin/stdout and become a worker
+			dup2(toChild[0], STDIN_FILENO);
+			dup2(fromChild[1], STDOUT_FILENO);
+			for (int fd : {toChild[0], toChild[1], fromChild[0], fromChild[1]}) close(fd);
+			execl(m_executable.c_str(), m_executable.c_str(), "worker", (char *)nullptr);
+			_exit(127);
+		}
+
+		close(toChild[0]);
+		close(fromChild[1]);
+
+		// Make sure workers spawned later do not inherit this worker's pipes, otherwise
+		// closing them would never signal end-of-stream
+		fcntl(toChild[1], F_SETFD, FD_CLOEXEC);
+		fcntl(fromChild[0], F_SETFD, FD_CLOEXEC);
+
+		worker.pid		  = pid;
+		worker.toWorker	  = toChild[1];
+		worker.fromWorker = fromChild[0];
+		worker.job		  = -1;
+
+		FRAC_LOG(fmt::format("Spawned worker {}", pid));
+		return true;
+#endif
+	}
+
+	void DistributedRenderer::stopWorker(Worker &worker, bool force) {
+#if !defined(_WIN32)
+		if (worker.toWorker >= 0) close(worker.toWorker);
+		if (worker.fromWorker >= 0) close(worker.fromWorker);
+		worker.toWorker	  = -1;
+		worker.fromWorker = -1;
+
+		if (worker.pid > 0) {
+			if (force) kill((pid_t)worker.pid, SIGKILL);
+			int status = 0;
+			waitpid((pid_t)worker.pid, &status, 0);
+		}
+#endif
+		worker.pid = -1;
+	}
+
+	std::string DistributedRenderer::serialiseJob(const TileJob &job) {
+		// Temporarily point the renderer at the job's band so exportSettingsJson can
+		// produce the job's settings, coordinates and all
+		const RenderConfig fullConfig = m_renderer.config();
+		RenderConfig &config		  = m_renderer.config();
+
+		config = StreamRenderer::bandConfig(fullConfig, job.firstRow, job.rows);
+		// Workers run alongside each other, so each only gets a share of the cores
+		config.numThreads = m_threadsPerWorker;
+
+		json message;
+		message["id"]		= job.id;
+		message["settings"] = m_renderer.exportSettingsJson();
+
+		m_renderer.config() = fullConfig;
+		return message.dump();
+	}
+} // namespace frac
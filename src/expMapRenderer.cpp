@@ -0,0 +1,250 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	namespace {
+		constexpr double pi	 = 3.14159265358979323846;
+		constexpr double ln2 = 0.69314718055994530942;
+
+		// Number of strip (or frame) rows handed to each task
+		constexpr int64_t rowsPerTask = 8;
+
+		uint8_t toByte(float value) {
+			return (uint8_t)(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+		}
+	} // namespace
+
+	ExpMapRenderer::ExpMapRenderer(FractalRenderer &renderer, const HighVec2 &center,
+								   const HighPrecision &startHeight,
+								   const HighPrecision &endHeight) :
+			m_renderer(renderer),
+			m_center(center) {
+		const RenderConfig &config = m_renderer.config();
+		const int64_t antiAlias	   = lrc::max(int64_t(1), config.antiAlias);
+
+		m_outputSize = config.imageSize;
+		m_startStep	 = startHeight / static_cast<HighPrecision>(m_outputSize.y());
+		m_octaves	 = AnimationRenderer::octavesBetween(startHeight, endHeight);
+
+		// Space the columns so samples at the corners of the frame are antiAlias times
+		// denser than pixels, and match the row spacing so samples are square
+		const double halfDiagonal = 0.5 * std::hypot((double)m_outputSize.x(),
+													 (double)m_outputSize.y());
+		m_stripWidth = (int64_t)std::ceil(2.0 * pi * halfDiagonal * (double)antiAlias);
+		m_rowStep	 = 2.0 * pi / (double)m_stripWidth;
+
+		// Cover the corners of the shallowest frame down to the pixels next to the
+		// center of the deepest one, with a row of margin at either end
+		const double shallowest = lrc::min(0.0, m_octaves);
+		const double deepest	= lrc::max(0.0, m_octaves);
+		const double logMin		= std::log(0.5) - deepest * ln2;
+
+		m_logRadiusMax = std::log(halfDiagonal) - shallowest * ln2 + m_rowStep;
+		m_stripHeight  = (int64_t)std::ceil((m_logRadiusMax - logMin) / m_rowStep) + 2;
+	}
+
+	int64_t ExpMapRenderer::stripWidth() const { return m_stripWidth; }
+	int64_t ExpMapRenderer::stripHeight() const { return m_stripHeight; }
+
+	void ExpMapRenderer::renderStrip() {
+		// Every point is coloured with the same snapshot of the renderer's settings
+		const std::shared_ptr<const RenderJob> job = m_renderer.captureJob();
+		const bool lowPrecision					   = job->config.precision <= 64;
+
+		FRAC_LOG(fmt::format("Rendering {}x{} exponential map ({:.1f} octaves)",
+							 m_stripWidth,
+							 m_stripHeight,
+							 m_octaves));
+
+		const double start = lrc::now();
+		m_strip.assign(m_stripWidth * m_stripHeight * 3, 0);
+		m_threadPool.reset(job->config.numThreads);
+
+		// The angle of each column is the same on every row
+		std::vector<double> cosines(m_stripWidth);
+		std::vector<double> sines(m_stripWidth);
+		for (int64_t col = 0; col < m_stripWidth; ++col) {
+			cosines[col] = std::cos((double)col * m_rowStep);
+			sines[col]	 = std::sin((double)col * m_rowStep);
+		}
+
+		const LowVec2 centerLow(static_cast<double>(m_center.x()),
+								static_cast<double>(m_center.y()));
+
+		auto renderRows = [&, this](int64_t firstRow, int64_t lastRow) {
+			for (int64_t row = firstRow; row < lastRow; ++row) {
+				// Build the radius from exact powers of two, since it can be far smaller
+				// than a double can represent
+				const double logRadius = m_logRadiusMax - (double)row * m_rowStep;
+				const HighPrecision radius =
+				  AnimationRenderer::zoomHeight(m_startStep, -logRadius / ln2);
+				const double radiusLow = static_cast<double>(radius);
+
+				uint8_t *dst = m_strip.data() + row * m_stripWidth * 3;
+				for (int64_t col = 0; col < m_stripWidth; ++col, dst += 3) {
+					ci::ColorA color;
+					if (lowPrecision) {
+						LowVec2 pos = centerLow + LowVec2(radiusLow * cosines[col],
+														  radiusLow * sines[col]);
+						color = m_renderer.pixelColorLow(*job, pos, 1, LowVec2(0, 0));
+					} else {
+						HighVec2 pos =
+						  m_center + HighVec2(radius * HighPrecision(cosines[col]),
+											  radius * HighPrecision(sines[col]));
+						color = m_renderer.pixelColorHigh(*job, pos, 1, HighVec2(0, 0));
+					}
+
+					dst[0] = toByte(color.r);
+					dst[1] = toByte(color.g);
+					dst[2] = toByte(color.b);
+				}
+			}
+		};
+
+		for (int64_t row = 0; row < m_stripHeight; row += rowsPerTask) {
+			const int64_t lastRow = lrc::min(row + rowsPerTask, m_stripHeight);
+			m_threadPool.push_task(
+			  [renderRows, row, lastRow]() { renderRows(row, lastRow); });
+		}
+
+		m_threadPool.wait_for_tasks();
+
+		// Progress goes to stderr, since stdout usually carries the video
+		fmt::print(stderr,
+				   "Rendered {}x{} strip in {}\n",
+				   m_stripWidth,
+				   m_stripHeight,
+				   lrc::formatTime(lrc::now() - start));
+	}
+
+	bool ExpMapRenderer::saveStrip(const std::string &path) const {
+		if (m_strip.empty()) return false;
+
+		ImageStreamWriter writer(path,
+								 lrc::Vec2i(m_stripWidth, m_stripHeight),
+								 ImageStreamWriter::formatFromPath(path),
+								 false);
+		return writer.isOpen() && writer.writePacked(m_strip.data(), m_stripHeight);
+	}
+
+	void ExpMapRenderer::reproject(double octaves, std::vector<uint8_t> &out) {
+		const int64_t width	 = m_outputSize.x();
+		const int64_t height = m_outputSize.y();
+
+		// Log of this frame's pixel size, in pixels of the first frame
+		const double logStep	= -octaves * ln2;
+		const double invRowStep = 1.0 / m_rowStep;
+		const double maxRow		= (double)(m_stripHeight - 1);
+
+		out.resize(width * height * 3);
+
+		auto reprojectRows = [&, this](int64_t firstRow, int64_t lastRow) {
+			for (int64_t y = firstRow; y < lastRow; ++y) {
+				// Pixels are sampled at their top-left corner, as in FractalRenderer, so
+				// the zoom center lies exactly on pixel (width / 2, height / 2)
+				const double dy = (double)y - (double)(height / 2);
+				uint8_t *dst	= out.data() + y * width * 3;
+
+				for (int64_t x = 0; x < width; ++x, dst += 3) {
+					const double dx		= (double)x - (double)(width / 2);
+					const double radius = std::hypot(dx, dy);
+
+					// The center pixel itself maps to the innermost row
+					double rowPos = maxRow;
+					if (radius > 0) {
+						const double logRadius = std::log(radius) + logStep;
+						rowPos = std::clamp((m_logRadiusMax - logRadius) * invRowStep,
+											0.0,
+											maxRow);
+					}
+
+					double angle = std::atan2(dy, dx);
+					if (angle < 0) angle += 2.0 * pi;
+					const double colPos = angle * invRowStep;
+
+					// Bilinear interpolation, wrapping around in angle
+					const int64_t row0 = (int64_t)rowPos;
+					const int64_t row1 = lrc::min(row0 + 1, m_stripHeight - 1);
+					const int64_t col0 = (int64_t)colPos % m_stripWidth;
+					const int64_t col1 = (col0 + 1) % m_stripWidth;
+					const double fy	   = rowPos - (double)row0;
+					const double fx	   = colPos - std::floor(colPos);
+
+					const uint8_t *strip = m_strip.data();
+					const uint8_t *p00	 = strip + (row0 * m_stripWidth + col0) * 3;
+					const uint8_t *p01	 = strip + (row0 * m_stripWidth + col1) * 3;
+					const uint8_t *p10	 = strip + (row1 * m_stripWidth + col0) * 3;
+					const uint8_t *p11	 = strip + (row1 * m_stripWidth + col1) * 3;
+
+					for (int64_t c = 0; c < 3; ++c) {
+						const double top	= p00[c] + (p01[c] - p00[c]) * fx;
+						const double bottom = p10[c] + (p11[c] - p10[c]) * fx;
+						const double value	= top + (bottom - top) * fy;
+						dst[c]				= (uint8_t)(value + 0.5);
+					}
+				}
+			}
+		};
+
+		for (int64_t y = 0; y < height; y += rowsPerTask) {
+			const int64_t lastRow = lrc::min(y + rowsPerTask, height);
+			m_threadPool.push_task(
+			  [reprojectRows, y, lastRow]() { reprojectRows(y, lastRow); });
+		}
+
+		m_threadPool.wait_for_tasks();
+	}
+
+	bool ExpMapRenderer::render(std::FILE *output, AnimationRenderer::Format format,
+								int64_t frames, int64_t fps) {
+		frames = lrc::max(int64_t(1), frames);
+
+		if (m_strip.empty()) renderStrip();
+
+		if (!AnimationRenderer::writeStreamHeader(output, format, m_outputSize, fps))
+			return false;
+
+		const double octavesPerFrame =
+		  frames > 1 ? m_octaves / static_cast<double>(frames - 1) : 0.0;
+
+		// Frames are written on a separate thread while the next one is reprojected,
+		// alternating between two buffers
+		std::vector<uint8_t> buffers[2];
+		std::future<bool> encoder;
+		bool success = true;
+
+		const double start = lrc::now();
+		for (int64_t frame = 0; frame < frames; ++frame) {
+			std::vector<uint8_t> &buffer = buffers[frame % 2];
+			reproject(octavesPerFrame * (double)frame, buffer);
+
+			if (encoder.valid() && !encoder.get()) {
+				success = false;
+				break;
+			}
+
+			encoder = std::async(std::launch::async, [this, &buffer, output, format]() {
+				return AnimationRenderer::writeImage(
+				  buffer.data(), m_outputSize.x(), m_outputSize.y(), output, format);
+			});
+
+			const double elapsed = lrc::now() - start;
+			fmt::print(stderr,
+					   "\r[{:6.2f}%] Frame {} / {} | {:.1f} frames/s   ",
+					   100.0 * (double)(frame + 1) / (double)frames,
+					   frame + 1,
+					   frames,
+					   (double)(frame + 1) / elapsed);
+		}
+
+		if (encoder.valid() && !encoder.get()) success = false;
+		std::fflush(output);
+
+		fmt::print(stderr,
+				   "\nReprojected {} frames in {}\n",
+				   frames,
+				   lrc::formatTime(lrc::now() - start));
+
+		if (!success) FRAC_ERROR("Failed to write animation frame");
+		return success;
+	}
+} // namespace frac
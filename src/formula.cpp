@@ -0,0 +1,625 @@
+#include <fractal/fractal.hpp>
+
+namespace frac::formula {
+	namespace {
+		// Largest exponent accepted by ^, which keeps the length of the code bounded
+		constexpr int64_t maxExponent = 64;
+
+		/// Recursive descent compiler. Each parse function emits the code for one
+		/// subexpression, and returns the register holding its value
+		class Compiler {
+		public:
+			Compiler(const std::string &source, Program &program) :
+					m_source(source), m_program(program) {}
+
+			bool compile(std::string &error) {
+				m_program = Program();
+
+				// "z =" is optional
+				skipSpace();
+				const size_t start = m_pos;
+				if (identifier() == "z") {
+					skipSpace();
+					if (!consume('=')) m_pos = start;
+				} else {
+					m_pos = start;
+				}
+
+				uint8_t result;
+				bool valid = expression(result);
+				skipSpace();
+				if (valid && m_pos < m_source.size())
+					valid = fail("Unexpected character");
+
+				if (!valid) {
+					error = fmt::format(
+					  "{} at position {} of \"{}\"", m_error, m_pos, m_source);
+					return false;
+				}
+
+				m_program.result = result;
+				return true;
+			}
+
+		private:
+			bool fail(const std::string &message) {
+				if (m_error.empty()) m_error = message;
+				return false;
+			}
+
+			void skipSpace() {
+				while (m_pos < m_source.size() && std::isspace((uint8_t)m_source[m_pos]))
+					++m_pos;
+			}
+
+			bool consume(char c) {
+				skipSpace();
+				if (m_pos >= m_source.size() || m_source[m_pos] != c) return false;
+				++m_pos;
+				return true;
+			}
+
+			std::string identifier() {
+				skipSpace();
+				const size_t start = m_pos;
+				while (m_pos < m_source.size() && std::isalpha((uint8_t)m_source[m_pos]))
+					++m_pos;
+				return m_source.substr(start, m_pos - start);
+			}
+
+			bool allocate(uint8_t &reg) {
+				if (m_program.numRegisters >= maxRegisters)
+					return fail("Formula is too long");
+				reg = (uint8_t)m_program.numRegisters++;
+				return true;
+			}
+
+			bool emit(Op op, uint8_t a, uint8_t b, uint8_t &dst) {
+				if (!allocate(dst)) return false;
+				m_program.code.push_back({op, dst, a, b});
+				return true;
+			}
+
+			bool constant(const lrc::Complex<LowPrecision> &value, uint8_t &reg) {
+				for (const auto &[existing, existingValue] : m_program.constants) {
+					if (existingValue.real() == value.real() &&
+						existingValue.imag() == value.imag()) {
+						reg = existing;
+						return true;
+					}
+				}
+
+				if (!allocate(reg)) return false;
+				m_program.constants.emplace_back(reg, value);
+				return true;
+			}
+
+			// expression := term (('+' | '-') term)*
+			bool expression(uint8_t &reg) {
+				if (!term(reg)) return false;
+
+				while (true) {
+					Op op;
+					if (consume('+')) {
+						op = Op::Add;
+					} else if (consume('-')) {
+						op = Op::Sub;
+					} else {
+						return true;
+					}
+
+					uint8_t rhs;
+					if (!term(rhs) || !emit(op, reg, rhs, reg)) return false;
+				}
+			}
+
+			// term := unary (('*' | '/') unary)*
+			bool term(uint8_t &reg) {
+				if (!unary(reg)) return false;
+
+				while (true) {
+					Op op;
+					if (consume('*')) {
+						op = Op::Mul;
+					} else if (consume('/')) {
+						op = Op::Div;
+					} else {
+						return true;
+					}
+
+					uint8_t rhs;
+					if (!unary(rhs) || !emit(op, reg, rhs, reg)) return false;
+				}
+			}
+
+			// unary := '-' unary | power
+			bool unary(uint8_t &reg) {
+				if (!consume('-')) return power(reg);
+				return unary(reg) && emit(Op::Neg, reg, reg, reg);
+			}
+
+			// power := primary ('^' integer)?
+			bool power(uint8_t &reg) {
+				if (!primary(reg)) return false;
+				if (!consume('^')) return true;
+
+				skipSpace();
+				const size_t start = m_pos;
+				while (m_pos < m_source.size() && std::isdigit((uint8_t)m_source[m_pos]))
+					++m_pos;
+				if (m_pos == start)
+					return fail("Expected a non-negative integer exponent");
+
+				const int64_t exponent =
+				  std::stoll(m_source.substr(start, m_pos - start));
+				if (exponent > maxExponent) return fail("Exponent is too large");
+				if (exponent == 0) return constant(lrc::Complex<LowPrecision>(1, 0), reg);
+
+				// Exponentiation by squaring
+				uint8_t base = reg;
+				bool first	 = true;
+				for (int64_t remaining = exponent; remaining > 0; remaining >>= 1) {
+					if (remaining & 1) {
+						if (first) {
+							reg = base;
+						} else if (!emit(Op::Mul, reg, base, reg)) {
+							return false;
+						}
+						first = false;
+					}
+					if (remaining > 1 && !emit(Op::Square, base, base, base))
+						return false;
+				}
+				return true;
+			}
+
+			// primary := number 'i'? | 'i' | 'z' | 'c' | function '(' expression ')'
+			//			| '(' expression ')'
+			bool primary(uint8_t &reg) {
+				skipSpace();
+				if (m_pos >= m_source.size()) return fail("Unexpected end of formula");
+
+				const char next = m_source[m_pos];
+				if (std::isdigit((uint8_t)next) || next == '.') {
+					size_t length = 0;
+					double value;
+					try {
+						value = std::stod(m_source.substr(m_pos), &length);
+					} catch (const std::exception &) {
+						return fail("Invalid number");
+					}
+					m_pos += length;
+
+					// Numbers followed directly by i are imaginary
+					if (m_pos < m_source.size() && m_source[m_pos] == 'i' &&
+						(m_pos + 1 >= m_source.size() ||
+						 !std::isalpha((uint8_t)m_source[m_pos + 1]))) {
+						++m_pos;
+						return constant(lrc::Complex<LowPrecision>(0, value), reg);
+					}
+					return constant(lrc::Complex<LowPrecision>(value, 0), reg);
+				}
+
+				if (consume('(')) {
+					if (!expression(reg)) return false;
+					return consume(')') || fail("Expected ')'");
+				}
+
+				const std::string name = identifier();
+				if (name.empty()) return fail("Expected a number, variable or function");
+				if (name == "z") {
+					reg = zRegister;
+					return true;
+				}
+				if (name == "c") {
+					reg = cRegister;
+					return true;
+				}
+				if (name == "i") return constant(lrc::Complex<LowPrecision>(0, 1), reg);
+
+				static const std::map<std::string, Op> functions = {{"conj", Op::Conj},
+																	 {"fold", Op::Fold},
+																	 {"re", Op::Real},
+																	 {"im", Op::Imag},
+																	 {"abs", Op::Abs}};
+				auto function = functions.find(name);
+				if (function == functions.end())
+					return fail(fmt::format("Unknown name \"{}\"", name));
+
+				if (!consume('(')) return fail("Expected '('");
+				if (!expression(reg)) return false;
+				if (!consume(')')) return fail("Expected ')'");
+				return emit(function->second, reg, reg, reg);
+			}
+
+			const std::string &m_source;
+			Program &m_program;
+			size_t m_pos = 0;
+			std::string m_error;
+		};
+	} // namespace
+
+	bool compile(const std::string &source, Program &program, std::string &error) {
+		return Compiler(source, program).compile(error);
+	}
+} // namespace frac::formula
+
+namespace frac {
+	namespace {
+		// Coordinates iterated together by FormulaFractal::iterCoordsLow. Each
+		// instruction is dispatched once for all of them
+		constexpr int64_t laneCount = 64;
+
+		/// Load a program's constants into every lane of their registers. Register r of
+		/// lane l is stored at re[r * stride + l] and im[r * stride + l]
+		template<typename Scalar>
+		void loadConstants(const formula::Program &program, Scalar *re, Scalar *im,
+						   int64_t stride, int64_t lanes) {
+			for (const auto &[reg, value] : program.constants) {
+				for (int64_t lane = 0; lane < lanes; ++lane) {
+					re[reg * stride + lane] = static_cast<Scalar>(value.real());
+					im[reg * stride + lane] = static_cast<Scalar>(value.imag());
+				}
+			}
+		}
+
+		/// Run a program once over some lanes, using the register layout of
+		/// loadConstants
+		template<typename Scalar>
+		void execute(const formula::Program &program, Scalar *re, Scalar *im,
+					 int64_t stride, int64_t lanes) {
+			using formula::Op;
+
+			for (const formula::Instruction &instruction : program.code) {
+				Scalar *dstRe	  = re + instruction.dst * stride;
+				Scalar *dstIm	  = im + instruction.dst * stride;
+				const Scalar *aRe = re + instruction.a * stride;
+				const Scalar *aIm = im + instruction.a * stride;
+				const Scalar *bRe = re + instruction.b * stride;
+				const Scalar *bIm = im + instruction.b * stride;
+
+				// Each case is a simple loop over the lanes, so it can be vectorised
+				switch (instruction.op) {
+					case Op::Add:
+						for (int64_t l = 0; l < lanes; ++l) {
+							dstRe[l] = aRe[l] + bRe[l];
+							dstIm[l] = aIm[l] + bIm[l];
+						}
+						break;
+					case Op::Sub:
+						for (int64_t l = 0; l < lanes; ++l) {
+							dstRe[l] = aRe[l] - bRe[l];
+							dstIm[l] = aIm[l] - bIm[l];
+						}
+						break;
+					case Op::Mul:
+						for (int64_t l = 0; l < lanes; ++l) {
+							const Scalar real = aRe[l] * bRe[l] - aIm[l] * bIm[l];
+							dstIm[l]		  = aRe[l] * bIm[l] + aIm[l] * bRe[l];
+							dstRe[l]		  = real;
+						}
+						break;
+					case Op::Div:
+						for (int64_t l = 0; l < lanes; ++l) {
+							const Scalar denom = bRe[l] * bRe[l] + bIm[l] * bIm[l];
+							const Scalar real  = aRe[l] * bRe[l] + aIm[l] * bIm[l];
+							const Scalar imag  = aIm[l] * bRe[l] - aRe[l] * bIm[l];
+							dstRe[l]		   = real / denom;
+							dstIm[l]		   = imag / denom;
+						}
+						break;
+					case Op::Neg:
+						for (int64_t l = 0; l < lanes; ++l) {
+							dstRe[l] = -aRe[l];
+							dstIm[l] = -aIm[l];
+						}
+						break;
+					case Op::Square:
+						for (int64_t l = 0; l < lanes; ++l) {
+							const Scalar real = aRe[l] * aRe[l] - aIm[l] * aIm[l];
+							dstIm[l]		  = 2 * aRe[l] * aIm[l];
+							dstRe[l]		  = real;
+						}
+						break;
+					case Op::Conj:
+						for (int64_t l = 0; l < lanes; ++l) {
+							dstRe[l] = aRe[l];
+							dstIm[l] = -aIm[l];
+						}
+						break;
+					case Op::Fold:
+						for (int64_t l = 0; l < lanes; ++l) {
+							dstRe[l] = lrc::abs(aRe[l]);
+							dstIm[l] = lrc::abs(aIm[l]);
+						}
+						break;
+					case Op::Real:
+						for (int64_t l = 0; l < lanes; ++l) {
+							dstRe[l] = aRe[l];
+							dstIm[l] = 0;
+						}
+						break;
+					case Op::Imag:
+						for (int64_t l = 0; l < lanes; ++l) {
+							dstRe[l] = aIm[l];
+							dstIm[l] = 0;
+						}
+						break;
+					case Op::Abs:
+						for (int64_t l = 0; l < lanes; ++l) {
+							dstRe[l] = lrc::sqrt(aRe[l] * aRe[l] + aIm[l] * aIm[l]);
+							dstIm[l] = 0;
+						}
+						break;
+				}
+			}
+		}
+
+		/// Iterate a single coordinate, as Mandelbrot::iterCoordLow does for z^2 + c
+		template<typename Scalar>
+		std::pair<int64_t, lrc::Complex<Scalar>>
+		iterateSingle(const formula::Program &initial, const formula::Program &step,
+					  const lrc::Complex<Scalar> &coord, double bailout,
+					  int64_t maxIters) {
+			std::array<Scalar, formula::maxRegisters> re;
+			std::array<Scalar, formula::maxRegisters> im;
+
+			re[formula::zRegister] = 0;
+			im[formula::zRegister] = 0;
+			re[formula::cRegister] = coord.real();
+			im[formula::cRegister] = coord.imag();
+			loadConstants(initial, re.data(), im.data(), 1, 1);
+			execute(initial, re.data(), im.data(), 1, 1);
+
+			Scalar zRe = re[initial.result];
+			Scalar zIm = im[initial.result];
+			loadConstants(step, re.data(), im.data(), 1, 1);
+
+			int64_t iteration = 0;
+			while (zRe * zRe + zIm * zIm <= bailout && iteration < maxIters) {
+				re[formula::zRegister] = zRe;
+				im[formula::zRegister] = zIm;
+				execute(step, re.data(), im.data(), 1, 1);
+				zRe = re[step.result];
+				zIm = im[step.result];
+				++iteration;
+			}
+
+			return {iteration, lrc::Complex<Scalar>(zRe, zIm)};
+		}
+	} // namespace
+
+	FormulaFractal::FormulaFractal(const RenderConfig &config) : Fractal(config) {
+		setFormula("z = z^2 + c", "0");
+	}
+
+	void FormulaFractal::configure(const json &settings) {
+		if (!settings.contains("formula")) return;
+		setFormula(settings["formula"].get<std::string>(),
+				   settings.value("initial", std::string("0")));
+	}
+
+	bool FormulaFractal::setFormula(const std::string &step, const std::string &initial) {
+		formula::Program stepProgram;
+		formula::Program initialProgram;
+		std::string error;
+
+		if (!formula::compile(step, stepProgram, error) ||
+			!formula::compile(initial, initialProgram, error)) {
+			FRAC_ERROR(fmt::format("Invalid formula: {}", error));
+			return false;
+		}
+
+		m_step	  = std::move(stepProgram);
+		m_initial = std::move(initialProgram);
+		return true;
+	}
+
+	size_t FormulaFractal::supportedOptimisations() const {
+		// Nothing is known about the shape of an arbitrary formula
+		return optimisations::BATCHED_ITERATION;
+	}
+
+	std::string FormulaFractal::name() const { return "Formula"; }
+
+	bool FormulaFractal::isEscapeTime() const { return true; }
+
+	std::unordered_map<std::string, coloring::ColorFuncLow>
+	FormulaFractal::getLowPrecColoringAlgorithms() const {
+		return {{"Logarithmic Scaling",
+				 std::function([](const lrc::Complex<LowPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::logarithmicScaling(coord, iters, palette);
+				 })},
+				{"Paletted Logarithmic Scaling",
+				 std::function([](const lrc::Complex<LowPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::palettedLogarithmicScaling(coord, iters, palette);
+				 })},
+				{"Stepped Gradients",
+				 std::function([](const lrc::Complex<LowPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::steppedGradients(coord, iters, palette);
+				 })},
+				{"Fixed Iteration Palette",
+				 std::function([](const lrc::Complex<LowPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::fixedIterPalette(coord, iters, palette);
+				 })}};
+	}
+
+	std::unordered_map<std::string, coloring::ColorFuncHigh>
+	FormulaFractal::getHighPrecColoringAlgorithms() const {
+		return {{"Logarithmic Scaling",
+				 std::function([](const lrc::Complex<HighPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::logarithmicScaling(coord, iters, palette);
+				 })},
+				{"Paletted Logarithmic Scaling",
+				 std::function([](const lrc::Complex<HighPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::palettedLogarithmicScaling(coord, iters, palette);
+				 })},
+				{"Stepped Gradients",
+				 std::function([](const lrc::Complex<HighPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::steppedGradients(coord, iters, palette);
+				 })},
+				{"Fixed Iteration Palette",
+				 std::function([](const lrc::Complex<HighPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::fixedIterPalette(coord, iters, palette);
+				 })}};
+	}
+
+	std::pair<int64_t, lrc::Complex<LowPrecision>>
+	FormulaFractal::iterCoordLow(const lrc::Complex<LowPrecision> &coord) const {
+		return iterateSingle(
+		  m_initial, m_step, coord, m_renderConfig.bail, m_renderConfig.maxIters);
+	}
+
+	void FormulaFractal::iterCoordsLow(
+	  const lrc::Complex<LowPrecision> *coords, int64_t count,
+	  std::pair<int64_t, lrc::Complex<LowPrecision>> *results) const {
+		using formula::cRegister;
+		using formula::zRegister;
+
+		const double bailout   = m_renderConfig.bail;
+		const int64_t maxIters = m_renderConfig.maxIters;
+
+		// Register r of lane l is stored at index r * laneCount + l
+		double re[formula::maxRegisters * laneCount];
+		double im[formula::maxRegisters * laneCount];
+		double *zRe = re + zRegister * laneCount;
+		double *zIm = im + zRegister * laneCount;
+		double *cRe = re + cRegister * laneCount;
+		double *cIm = im + cRegister * laneCount;
+
+		// Find the starting value of every coordinate first, a batch at a time
+		thread_local std::vector<lrc::Complex<LowPrecision>> starts;
+		starts.resize(count);
+		loadConstants(m_initial, re, im, laneCount, laneCount);
+		for (int64_t first = 0; first < count; first += laneCount) {
+			const int64_t lanes = lrc::min(laneCount, count - first);
+			for (int64_t lane = 0; lane < lanes; ++lane) {
+				zRe[lane] = 0;
+				zIm[lane] = 0;
+				cRe[lane] = coords[first + lane].real();
+				cIm[lane] = coords[first + lane].imag();
+			}
+
+			execute(m_initial, re, im, laneCount, lanes);
+
+			const double *startRe = re + m_initial.result * laneCount;
+			const double *startIm = im + m_initial.result * laneCount;
+			for (int64_t lane = 0; lane < lanes; ++lane)
+				starts[first + lane] = {startRe[lane], startIm[lane]};
+		}
+
+		loadConstants(m_step, re, im, laneCount, laneCount);
+		const double *nextRe = re + m_step.result * laneCount;
+		const double *nextIm = im + m_step.result * laneCount;
+		int64_t iters[laneCount];
+		int64_t index[laneCount]; // Coordinate each lane is iterating
+
+		// Give a lane the next coordinate that needs iterating. Coordinates that start
+		// outside the bailout radius are finished straight away
+		int64_t next = 0;
+
+		auto load = [&](int64_t lane) {
+			while (next < count) {
+				const int64_t i	  = next++;
+				const auto &start = starts[i];
+				const double startSq =
+				  start.real() * start.real() + start.imag() * start.imag();
+
+				if (maxIters > 0 && startSq <= bailout) {
+					zRe[lane]	= start.real();
+					zIm[lane]	= start.imag();
+					cRe[lane]	= coords[i].real();
+					cIm[lane]	= coords[i].imag();
+					iters[lane] = 0;
+					index[lane] = i;
+					return true;
+				}
+
+				results[i] = {0, start};
+			}
+			return false;
+		};
+
+		int64_t lanes = 0;
+		while (lanes < laneCount && load(lanes)) ++lanes;
+
+		while (lanes > 0) {
+			execute(m_step, re, im, laneCount, lanes);
+			if (m_step.result != zRegister) {
+				for (int64_t lane = 0; lane < lanes; ++lane) {
+					zRe[lane] = nextRe[lane];
+					zIm[lane] = nextIm[lane];
+				}
+			}
+
+			// A lane that finishes is given the next coordinate. Once there are none
+			// left, the last lane is moved into its place, so the lanes stay packed
+			for (int64_t lane = 0; lane < lanes;) {
+				++iters[lane];
+				const double radiusSq = zRe[lane] * zRe[lane] + zIm[lane] * zIm[lane];
+				if (radiusSq <= bailout && iters[lane] < maxIters) {
+					++lane;
+					continue;
+				}
+
+				results[index[lane]] = {iters[lane],
+										lrc::Complex<LowPrecision>(zRe[lane], zIm[lane])};
+				if (load(lane)) {
+					++lane;
+					continue;
+				}
+
+				--lanes;
+				zRe[lane]	= zRe[lanes];
+				zIm[lane]	= zIm[lanes];
+				cRe[lane]	= cRe[lanes];
+				cIm[lane]	= cIm[lanes];
+				iters[lane] = iters[lanes];
+				index[lane] = index[lanes];
+			}
+		}
+	}
+
+	std::pair<int64_t, lrc::Complex<HighPrecision>>
+	FormulaFractal::iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const {
+		return iterateSingle(
+		  m_initial, m_step, coord, m_renderConfig.bail, m_renderConfig.maxIters);
+	}
+
+	ci::ColorA
+	FormulaFractal::getColorLow(const lrc::Complex<LowPrecision> &coord, int64_t iters,
+								const ColorPalette &palette,
+								const coloring::ColorFuncLow &colorFunc) const {
+		// Coordinates that never escaped are in the set
+		if (coord.real() * coord.real() + coord.imag() * coord.imag() <=
+			m_renderConfig.bail)
+			return {0, 0, 0, 1};
+		return colorFunc(coord, iters, palette);
+	}
+
+	ci::ColorA
+	FormulaFractal::getColorHigh(const lrc::Complex<HighPrecision> &coord, int64_t iters,
+								 const ColorPalette &palette,
+								 const coloring::ColorFuncHigh &colorFunc) const {
+		if (coord.real() * coord.real() + coord.imag() * coord.imag() <=
+			m_renderConfig.bail)
+			return {0, 0, 0, 1};
+		return colorFunc(coord, iters, palette);
+	}
+} // namespace frac
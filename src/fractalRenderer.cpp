@@ -1,6 +1,80 @@
 #include <fractal/fractal.hpp>
 
 namespace frac {
+	namespace {
+		// Width and height, in pixels, of the blocks filled from a single distance
+		// estimate (see FractalRenderer::setDistanceFill)
+		constexpr int64_t distanceFillBlock = 16;
+
+		// Pixels passed to FractalRenderer::pixelColor on this thread. Boxes are
+		// rendered on a single thread, so the difference across renderBox is the
+		// number of pixels the box computed
+		thread_local int64_t pixelsComputedOnThread = 0;
+
+		// Pixel states used by FractalRenderer::traceBox. Traced regions are numbered
+		// from 1
+		constexpr int32_t unknownPixel	= 0;
+		constexpr int32_t computedPixel = -1;
+
+		// Spacing of the pixels computed inside a traced region to check that it does
+		// not enclose an island of another colour (see FractalRenderer::traceBox)
+		constexpr int64_t traceProbeStride = 2;
+
+		// Directions for boundary tracing, in clockwise order: right, down, left, up
+		constexpr int64_t traceDirX[4] = {1, 0, -1, 0};
+		constexpr int64_t traceDirY[4] = {0, 1, 0, -1};
+
+		// Largest distance, in samples, from the axis of symmetry to the sample grid for
+		// a reflection to be used (see FractalRenderer::planMirror)
+		constexpr double mirrorTolerance = 1e-6;
+
+		// Identifier of the next job captured by any renderer
+		std::atomic<int64_t> nextJobId {1};
+
+		/// Append the parts of a box that lie outside a rectangle, as up to four boxes
+		/// \param box The box to split
+		/// \param from Top left of the rectangle
+		/// \param to One past the bottom right of the rectangle
+		/// \param boxes Boxes to append to
+		void appendOutside(const RenderBox &box, const lrc::Vec2i &from,
+						   const lrc::Vec2i &to, std::vector<RenderBox> &boxes) {
+			const lrc::Vec2i end = box.topLeft + box.dimensions;
+
+			auto append = [&](int64_t left, int64_t top, int64_t right, int64_t bottom) {
+				if (right <= left || bottom <= top) return;
+				RenderBox part	= box;
+				part.topLeft	= lrc::Vec2i(left, top);
+				part.dimensions = lrc::Vec2i(right - left, bottom - top);
+				boxes.push_back(part);
+			};
+
+			if (to.x() <= box.topLeft.x() || from.x() >= end.x() ||
+				to.y() <= box.topLeft.y() || from.y() >= end.y()) {
+				boxes.push_back(box);
+				return;
+			}
+
+			const int64_t top	 = lrc::max(box.topLeft.y(), from.y());
+			const int64_t bottom = lrc::min(end.y(), to.y());
+			append(box.topLeft.x(), box.topLeft.y(), end.x(), top);
+			append(box.topLeft.x(), top, lrc::min(end.x(), from.x()), bottom);
+			append(lrc::max(box.topLeft.x(), to.x()), top, end.x(), bottom);
+			append(box.topLeft.x(), bottom, end.x(), end.y());
+		}
+
+		bool sameColor(const ci::ColorA &a, const ci::ColorA &b) {
+			return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+		}
+
+		// Iteration data kept for recolouring a sample
+		template<typename Scalar>
+		IterationSample makeSample(int64_t iters, const lrc::Complex<Scalar> &endPoint) {
+			const Scalar radiusSq =
+			  endPoint.real() * endPoint.real() + endPoint.imag() * endPoint.imag();
+			return {(int32_t)iters, static_cast<float>(static_cast<double>(radiusSq))};
+		}
+	} // namespace
+
 	FractalRenderer::FractalRenderer(const json &config) { setConfig(config); }
 	FractalRenderer::~FractalRenderer() { stopRender(); }
 
@@ -30,7 +104,7 @@ namespace frac {
 
 			  lrc::Vec<HighPrecision, 2>(0, 0),
 
-			  {}, // Default for now -- colors added later
+			  PaletteRegistry::current(), // Default for now -- colors added later
 
 			  m_settings["renderConfig"]["draftRender"].get<bool>(),
 			  m_settings["renderConfig"]["draftInc"].get<int64_t>()};
@@ -61,7 +135,9 @@ namespace frac {
 
 			m_renderConfig.originalFracSize = m_renderConfig.fracSize;
 
-			// Load the colour palettes from the JSON object
+			// Load the colour palettes from the JSON object. They are published once,
+			// and every configuration copied from this one shares them
+			std::unordered_map<std::string, ColorPalette> palettes;
 			for (const auto &palette : m_settings["renderConfig"]["colorPalettes"]) {
 				// If no palette name has been set, set it to the first palette in the
 				// list
@@ -74,8 +150,9 @@ namespace frac {
 														 color["blue"].get<float>(),
 														 color["alpha"].get<float>()));
 				}
-				m_renderConfig.palettes[palette["name"]] = tmp;
+				palettes[palette["name"]] = std::move(tmp);
 			}
+			m_renderConfig.palettes = PaletteRegistry::publish(std::move(palettes));
 		} catch (std::exception &e) {
 			FRAC_LOG(fmt::format("Failed to load settings: {}", e.what()));
 			stopRender();
@@ -84,14 +161,40 @@ namespace frac {
 
 	void FractalRenderer::stopRender() {
 		m_haltRender = true;
-		m_threadPool.wait_for_tasks();
+		waitForRender();
 		m_haltRender = false;
 	}
 
+	void FractalRenderer::waitForRender() {
+		if (!m_sharedPool) {
+			m_threadPool.wait_for_tasks();
+			return;
+		}
+
+		// Other renderers' boxes may still be running in a shared pool, so only wait
+		// for this renderer's boxes
+		std::unique_lock<std::mutex> lock(m_boxMutex);
+		m_boxesFinished.wait(lock, [this]() { return m_boxesRemaining == 0; });
+	}
+
+	void FractalRenderer::setSharedThreadPool(ThreadPool *pool) {
+		stopRender();
+		m_sharedPool = pool;
+	}
+
+	void FractalRenderer::setThreadPlacement(std::vector<topology::NumaNode> nodes) {
+		stopRender();
+		m_numaNodes = std::move(nodes);
+		if (!m_numaNodes.empty())
+			FRAC_LOG(fmt::format("Pinning render threads to {}",
+								 topology::describe(m_numaNodes)));
+	}
+
 	void FractalRenderer::moveFractalCorner(const lrc::Vec<HighPrecision, 2> &topLeft,
 											const lrc::Vec<HighPrecision, 2> &size) {
 		m_renderConfig.fracTopLeft = topLeft;
 		m_renderConfig.fracSize	   = size;
+		m_samplesValid			   = false;
 		if (m_fractal) m_fractal->updateRenderConfig(m_renderConfig);
 	}
 
@@ -100,23 +203,66 @@ namespace frac {
 		moveFractalCorner(center - size / lrc::Vec<HighPrecision, 2>(2, 2), size);
 	}
 
-	void FractalRenderer::renderFractal() {
-		if (m_threadPool.get_tasks_queued() > 0) {
-			FRAC_WARN("Render already in progress. Halting...");
-			m_haltRender = true;
-			m_threadPool.wait_for_tasks();
-			m_haltRender = false;
-			FRAC_LOG("Render halted");
+	RenderHandle FractalRenderer::renderFractal(RenderProgressCallback onProgress) {
+		// The last tasks of the previous job can still be running once none are
+		// queued, and they read the job and the state reset below. Stopping an idle
+		// renderer returns immediately, so the render is always stopped
+		bool inProgress;
+		{
+			std::lock_guard<std::mutex> lock(m_boxMutex);
+			inProgress = m_boxesRemaining > 0;
 		}
 
+		if (inProgress) FRAC_WARN("Render already in progress. Halting...");
+		stopRender();
+		if (inProgress) FRAC_LOG("Render halted");
+
 		FRAC_LOG("Rendering Fractal...");
 
+		// Nothing from the previous job is running, so it can be replaced. From here
+		// on, only the job's copy of the settings is read
+		m_job					   = captureJob();
+		const RenderConfig &config = m_job->config;
+
 		m_renderBoxes.clear();
-		m_threadPool.reset(m_renderConfig.numThreads);
+
+		// A shared pool is sized by its owner
+		if (!m_sharedPool) m_threadPool.reset(config.numThreads);
 
 		// Split the render into boxes to be rendered in parallel
-		auto imageSize = m_renderConfig.imageSize;
-		auto boxSize   = m_renderConfig.boxSize;
+		auto imageSize = config.imageSize;
+		auto boxSize   = config.boxSize;
+
+		// Only full renders can be recoloured later. Drafts skip pixels, and known
+		// pixels are never iterated, so they are only kept if the caller supplied the
+		// known pixels' data. Distance estimates are not stored, so they are not kept
+		// either
+		const int64_t numPixels = imageSize.x() * imageSize.y();
+		m_sampleAlias			= lrc::max(int64_t(1), config.antiAlias);
+		m_sampleMaxIters		= config.maxIters;
+		m_samplesValid			= false;
+
+		const auto numSamples  = (size_t)(numPixels * m_sampleAlias * m_sampleAlias);
+		const bool knownPixels = m_knownPixels.size() == (size_t)numPixels;
+		const bool knownSeeded = m_knownSamples && m_samples.size() == numSamples;
+
+		m_storeSamples = (m_keepIterationData || m_job->histogramColoring) &&
+						 !m_job->distanceColoring && !config.draftRender &&
+						 (!knownPixels || knownSeeded);
+		if (m_storeSamples) {
+			// A new buffer is left uninitialised, so its pages are placed by the render
+			// threads (see queuePlacedWorkers). Every sample is written before the data
+			// is used. It is freed first, so no samples are copied on the way
+			if (m_samples.size() != numSamples) {
+				IterationBuffer().swap(m_samples);
+				m_samples.resize(numSamples);
+				m_samplesTouched = false;
+			}
+			m_histogram.reset(config.maxIters);
+		}
+
+		// Pixels that can be reflected are left out of the boxes
+		const bool mirror = planMirror();
 
 		// Round number of boxes up so the full image is covered
 		auto numBoxes =
@@ -132,53 +278,631 @@ namespace frac {
 				  lrc::min(boxSize.y(), imageSize.y() - i * boxSize.y()));
 				RenderBox box {lrc::Vec2i(j, i) * boxSize,
 							   adjustedBoxSize,
-							   m_renderConfig.draftRender,
-							   m_renderConfig.draftInc,
+							   config.draftRender,
+							   config.draftInc,
 							   RenderBoxState::Queued};
 
-				auto prevSize = (int64_t)m_renderBoxes.size();
+				// Every box must exist before any are pushed to the render queue
+				if (mirror) {
+					appendOutside(box, m_mirrorFrom, m_mirrorTo, m_renderBoxes);
+				} else {
+					m_renderBoxes.emplace_back(box);
+				}
+			}
+		}
 
-				// Must happen before pushing to render queue
-				m_renderBoxes.emplace_back(box);
+		// Regions of the halted render will be written again by this one
+		discardPublished();
 
-				m_threadPool.push_task(
-				  [this, box, prevSize]() { renderBox(box, prevSize); });
-			}
+		auto progress		 = std::make_shared<RenderProgress>();
+		progress->boxesTotal = (int64_t)m_renderBoxes.size();
+		progress->callback	 = std::move(onProgress);
+		RenderHandle handle(m_job, progress);
+
+		{
+			std::lock_guard<std::mutex> lock(m_boxMutex);
+			m_boxesRemaining = (int64_t)m_renderBoxes.size();
+			m_iterating		 = m_boxesRemaining > 0;
+			m_mirroring		 = mirror;
+			m_progress		 = progress;
+
+			// With no boxes, no task will finish the job
+			if (m_boxesRemaining == 0) finishJob();
+		}
+
+		if (!m_numaNodes.empty() && !m_sharedPool) {
+			queuePlacedWorkers(numBoxes);
+		} else {
+			for (int64_t i = 0; i < (int64_t)m_renderBoxes.size(); ++i)
+				activePool().push_task([this, i]() { renderQueuedBox(i); });
 		}
 
 		FRAC_LOG("Fractal Complete...");
+		return handle;
+	}
+
+	std::shared_ptr<const RenderJob> FractalRenderer::captureJob() {
+		auto job		   = std::make_shared<RenderJob>();
+		job->id			   = nextJobId++;
+		job->config		   = m_renderConfig;
+		job->fractal	   = createFractal(m_fractalName, job->config, m_fractalSettings);
+		job->colorFuncLow  = m_colorFuncLow;
+		job->colorFuncHigh = m_colorFuncHigh;
+		job->palette	   = &job->config.palettes->get(m_paletteName);
+		job->kernels	   = m_kernels;
+		job->kernelContext = {job->config.maxIters,
+							  job->config.bail,
+							  job->config.antiAlias,
+							  job->palette,
+							  job->config.precision};
+
+		job->target = &m_fractalSurface;
+		job->pixelSpacing =
+		  lrc::min(std::abs(static_cast<double>(job->config.fracSize.x())) /
+					 (double)job->config.imageSize.x(),
+				   std::abs(static_cast<double>(job->config.fracSize.y())) /
+					 (double)job->config.imageSize.y());
+		job->histogramColoring = m_histogramColoring;
+		job->distanceColoring  = m_distanceColoring;
+		job->distanceFill	   = m_distanceFill;
+		job->boundaryTracing   = m_boundaryTracing;
+		job->deferColoring	   = m_deferColoring;
+		return job;
+	}
+
+	ThreadPool &FractalRenderer::activePool() {
+		return m_sharedPool ? *m_sharedPool : m_threadPool;
+	}
+
+	void FractalRenderer::renderQueuedBox(int64_t index) {
+		const RenderBox box = m_renderBoxes[index];
+		renderBox(box, index);
+		publishRegion(box.topLeft, box.dimensions);
+
+		// The job cannot finish before this box does, so m_progress is still its
+		// progress
+		if (m_progress) {
+			const int64_t done = ++m_progress->boxesDone;
+			if (m_progress->callback)
+				m_progress->callback((double)done / (double)m_progress->boxesTotal);
+		}
+
+		finishTask();
+	}
+
+	void FractalRenderer::finishTask() {
+		std::lock_guard<std::mutex> lock(m_boxMutex);
+		if (--m_boxesRemaining > 0) return;
+
+		// The reflected pixels are copied once every box has been rendered
+		if (m_mirroring) {
+			m_mirroring = false;
+			if (!m_haltRender) m_boxesRemaining = queueMirrorPass();
+			if (m_boxesRemaining > 0) return;
+		}
+
+		if (m_iterating) {
+			m_iterating = false;
+
+			// A halted render leaves gaps in the iteration data
+			if (m_storeSamples && !m_haltRender) {
+				m_histogram.finalise();
+				m_samplesValid = true;
+
+				// Waiting for the render includes waiting for the colouring pass. It
+				// rewrites every row, so the published regions are published again
+				if (m_job->histogramColoring && !m_job->deferColoring) {
+					discardPublished();
+					m_boxesRemaining = queueColorPass();
+				}
+			}
+		}
+
+		if (m_boxesRemaining == 0) finishJob();
+	}
+
+	void FractalRenderer::finishJob() {
+		m_boxesFinished.notify_all();
+		if (!m_progress) return;
+
+		m_progress->finished.set_value(!m_haltRender);
+		m_progress.reset();
+	}
+
+	void FractalRenderer::publishRegion(const lrc::Vec2i &topLeft,
+										const lrc::Vec2i &dimensions) {
+		m_published.mark({topLeft, dimensions});
+	}
+
+	void FractalRenderer::discardPublished() {
+		std::lock_guard<std::mutex> lock(m_presentMutex);
+		m_published.clear();
+	}
+
+	bool FractalRenderer::presentSurface(std::vector<SurfaceRegion> &changed) {
+		changed.clear();
+
+		// The back buffer is only reallocated on this thread, so nothing needs to be
+		// locked to find out that there is nothing to do
+		const int32_t width	 = m_fractalSurface.getWidth();
+		const int32_t height = m_fractalSurface.getHeight();
+		const bool resized =
+		  m_frontSurface.getWidth() != width || m_frontSurface.getHeight() != height;
+		if (!resized && m_published.empty() && m_frontChanged.empty()) return false;
+
+		// The lock is held while copying, so a region cannot be discarded and written
+		// again by a render thread until it has been copied
+		std::lock_guard<std::mutex> lock(m_presentMutex);
+
+		// The front buffer is only allocated once something presents it
+		if (resized && width > 0 && height > 0) {
+			m_frontSurface		  = ci::Surface(width, height, true);
+			const size_t rowBytes = m_frontSurface.getRowBytes();
+			std::memset(m_frontSurface.getData(), 0, rowBytes * height);
+			m_frontChanged.assign(1, {lrc::Vec2i(0, 0), lrc::Vec2i(width, height)});
+		}
+
+		changed.swap(m_frontChanged);
+		const size_t first = changed.size();
+		m_published.consume(changed);
+		for (size_t i = first; i < changed.size(); ++i) {
+			const lrc::Vec2i end = changed[i].topLeft + changed[i].dimensions;
+			m_frontSurface.copyFrom(m_fractalSurface,
+									ci::Area((int32_t)changed[i].topLeft.x(),
+											 (int32_t)changed[i].topLeft.y(),
+											 (int32_t)end.x(),
+											 (int32_t)end.y()));
+		}
+
+		return !changed.empty();
+	}
+
+	void FractalRenderer::reprojectSurface(const lrc::Vec2i &topLeft,
+										   const lrc::Vec2i &bottomRight) {
+		stopRender();
+
+		std::lock_guard<std::mutex> lock(m_presentMutex);
+		m_published.clear();
+
+		// No render thread is running, so the back buffer holds the newest image. It is
+		// resampled from a copy in the front buffer, which is then updated to match
+		const int32_t width	 = m_fractalSurface.getWidth();
+		const int32_t height = m_fractalSurface.getHeight();
+		const ci::Area area(0, 0, width, height);
+		if (m_frontSurface.getWidth() != width || m_frontSurface.getHeight() != height)
+			m_frontSurface = ci::Surface(width, height, true);
+		m_frontSurface.copyFrom(m_fractalSurface, area);
+
+		for (int64_t y = 0; y < height; ++y) {
+			for (int64_t x = 0; x < width; ++x) {
+				lrc::Vec2i pixPos = lrc::map(lrc::Vec2f(x, y),
+											 lrc::Vec2f(0, 0),
+											 lrc::Vec2f(width, height),
+											 lrc::Vec2f(topLeft),
+											 lrc::Vec2f(bottomRight));
+				m_fractalSurface.setPixel(lrc::Vec2i(x, y),
+										  m_frontSurface.getPixel(pixPos));
+			}
+		}
+
+		m_frontSurface.copyFrom(m_fractalSurface, area);
+		m_frontChanged.assign(1, {lrc::Vec2i(0, 0), lrc::Vec2i(width, height)});
+	}
+
+	const ci::Surface &FractalRenderer::frontSurface() const { return m_frontSurface; }
+
+	int64_t FractalRenderer::queueColorPass() {
+		const int64_t width		  = m_job->config.imageSize.x();
+		const int64_t height	  = m_job->config.imageSize.y();
+		const int64_t rowsPerTask = lrc::max(int64_t(1), m_job->config.boxSize.y());
+
+		int64_t tasks = 0;
+		for (int64_t row = 0; row < height; row += rowsPerTask, ++tasks) {
+			const int64_t lastRow = lrc::min(row + rowsPerTask, height);
+			activePool().push_task([this, row, lastRow, width]() {
+				colorRows(row, lastRow);
+				publishRegion(lrc::Vec2i(0, row), lrc::Vec2i(width, lastRow - row));
+				finishTask();
+			});
+		}
+
+		return tasks;
+	}
+
+	void FractalRenderer::colorRows(int64_t firstRow, int64_t lastRow) {
+		const RenderJob &job		= *m_job;
+		const int64_t width			= job.config.imageSize.x();
+		const int64_t perPixel		= m_sampleAlias * m_sampleAlias;
+		const int64_t rowSamples	= width * perPixel;
+		std::vector<ci::ColorA> colors(rowSamples);
+
+		for (int64_t py = firstRow; py < lastRow; ++py) {
+			if (m_haltRender) return;
+
+			colorSamples(job,
+						 m_samples.data() + py * rowSamples,
+						 rowSamples,
+						 m_sampleMaxIters,
+						 m_histogram,
+						 colors.data());
+
+			// Average the samples of each pixel, as pixelColorLow does
+			for (int64_t px = 0; px < width; ++px) {
+				ci::ColorA pix(0, 0, 0, 1);
+				for (int64_t i = 0; i < perPixel; ++i) pix += colors[px * perPixel + i];
+				job.target->setPixel(lrc::Vec2i(px, py),
+									 pix / static_cast<float>(perPixel));
+			}
+		}
+	}
+
+	void FractalRenderer::colorSamples(const RenderJob &job,
+									   const IterationSample *samples, int64_t count,
+									   int64_t maxIters,
+									   const coloring::IterationHistogram &histogram,
+									   ci::ColorA *out) {
+		if (job.histogramColoring) {
+			coloring::histogramColorBatch(
+			  samples, count, maxIters, histogram, *job.palette, out);
+			return;
+		}
+
+		for (int64_t i = 0; i < count; ++i) out[i] = sampleColor(job, samples[i]);
+	}
+
+	ci::ColorA FractalRenderer::sampleColor(const RenderJob &job,
+											const IterationSample &sample) {
+		// The colouring functions only use the magnitude of the final coordinate
+		const double radius = std::sqrt((double)sample.radiusSq);
+		return job.fractal->getColorLow(lrc::Complex<LowPrecision>(radius, 0),
+										sample.iters,
+										*job.palette,
+										job.colorFuncLow);
+	}
+
+	bool FractalRenderer::planMirror() {
+		const RenderConfig &config = m_job->config;
+		m_mirrorSymmetry		   = m_job->fractal->symmetry();
+		if (!m_symmetry || config.draftRender || m_mirrorSymmetry == Symmetry::None)
+			return false;
+
+		const int64_t alias			= m_sampleAlias;
+		const lrc::Vec2i &imageSize = config.imageSize;
+		const bool pointSymmetric	= m_mirrorSymmetry == Symmetry::Origin;
+
+		// Sample j along an axis lies at topLeft + j * size / (pixels * alias), so the
+		// reflection through zero maps it onto sample -2 topLeft pixels alias / size - j.
+		// Nothing can be reflected unless that lies on the sample grid, with the axis
+		// inside the image
+		auto reflection = [&](const HighPrecision &topLeft, const HighPrecision &size,
+							  int64_t pixels, int64_t &samples) {
+			const auto value = static_cast<double>(
+			  HighPrecision(-2) * topLeft * HighPrecision(pixels * alias) / size);
+			if (!(value >= 0 && value <= 2.0 * (double)(pixels * alias))) return false;
+			samples = std::llround(value);
+			return std::abs(value - (double)samples) < mirrorTolerance;
+		};
+
+		int64_t samplesX = 0;
+		int64_t samplesY = 0;
+		if (!reflection(
+			  config.fracTopLeft.y(), config.fracSize.y(), imageSize.y(), samplesY))
+			return false;
+		if (pointSymmetric && !reflection(config.fracTopLeft.x(),
+										  config.fracSize.x(),
+										  imageSize.x(),
+										  samplesX))
+			return false;
+
+		// Pixels map onto pixels when the last sample of one pixel is reflected onto
+		// the first sample of another. Otherwise, a reflected pixel takes its samples
+		// from two pixels, and can only be coloured from their iteration data
+		m_mirrorAligned = (samplesY + 1) % alias == 0 &&
+						  (!pointSymmetric || (samplesX + 1) % alias == 0);
+		if (!m_mirrorAligned && !m_storeSamples) return false;
+
+		// Rows below the axis are reflected from rows above it. Columns are only
+		// reflected if the pixel they are reflected from is inside the image
+		const int64_t firstRow = samplesY / (2 * alias) + 1;
+		const int64_t lastRow  = lrc::min(imageSize.y(), (samplesY + 1) / alias);
+		int64_t firstCol	   = 0;
+		int64_t lastCol		   = imageSize.x();
+		if (pointSymmetric) {
+			firstCol = lrc::max(int64_t(0), (samplesX + alias) / alias - imageSize.x());
+			lastCol	 = lrc::min(imageSize.x(), (samplesX + 1) / alias);
+		}
+
+		m_mirrorSamples = lrc::Vec2i(samplesX, samplesY);
+		m_mirrorFrom	= lrc::Vec2i(firstCol, firstRow);
+		m_mirrorTo		= lrc::Vec2i(lastCol, lastRow);
+		return firstCol < lastCol && firstRow < lastRow;
+	}
+
+	int64_t FractalRenderer::queueMirrorPass() {
+		const int64_t rowsPerTask = lrc::max(int64_t(1), m_job->config.boxSize.y());
+		const int64_t width		  = m_mirrorTo.x() - m_mirrorFrom.x();
+
+		int64_t tasks = 0;
+		for (int64_t row = m_mirrorFrom.y(); row < m_mirrorTo.y();
+			 row += rowsPerTask, ++tasks) {
+			const int64_t lastRow = lrc::min(row + rowsPerTask, m_mirrorTo.y());
+			activePool().push_task([this, row, lastRow, width]() {
+				mirrorRows(row, lastRow);
+				publishRegion(lrc::Vec2i(m_mirrorFrom.x(), row),
+							  lrc::Vec2i(width, lastRow - row));
+				finishTask();
+			});
+		}
+
+		return tasks;
+	}
+
+	void FractalRenderer::mirrorRows(int64_t firstRow, int64_t lastRow) {
+		const int64_t alias			= m_sampleAlias;
+		const int64_t perPixel		= alias * alias;
+		const int64_t firstCol		= m_mirrorFrom.x();
+		const int64_t lastCol		= m_mirrorTo.x();
+		const bool pointSymmetric	= m_mirrorSymmetry == Symmetry::Origin;
+		ci::Surface &target			= *m_job->target;
+		const uint8_t pixelInc		= target.getPixelInc();
+
+		for (int64_t py = firstRow; py < lastRow; ++py) {
+			if (m_haltRender) return;
+
+			for (int64_t px = firstCol; px < lastCol; ++px) {
+				// Reflect each sample. When whole pixels are reflected, the samples all
+				// come from the same pixel
+				IterationSample *samples = sampleSlot(px, py);
+				int64_t fromX			 = px;
+				int64_t fromY			 = py;
+				for (int64_t aliasY = 0; aliasY < alias; ++aliasY) {
+					for (int64_t aliasX = 0; aliasX < alias; ++aliasX) {
+						int64_t sampleX = px * alias + aliasX;
+						if (pointSymmetric) sampleX = m_mirrorSamples.x() - sampleX;
+						const int64_t sampleY = m_mirrorSamples.y() - py * alias - aliasY;
+
+						fromX = sampleX / alias;
+						fromY = sampleY / alias;
+						if (!samples) continue;
+
+						const IterationSample *from = sampleSlot(fromX, fromY);
+						samples[aliasY * alias + aliasX] =
+						  from[(sampleY % alias) * alias + sampleX % alias];
+					}
+				}
+
+				if (m_mirrorAligned) {
+					std::memcpy(target.getData(ci::ivec2(px, py)),
+								target.getData(ci::ivec2(fromX, fromY)),
+								pixelInc);
+				} else if (!m_job->histogramColoring) {
+					// In histogram mode, the colouring pass colours every pixel anyway
+					ci::ColorA pix(0, 0, 0, 1);
+					for (int64_t i = 0; i < perPixel; ++i)
+						pix += sampleColor(*m_job, samples[i]);
+					target.setPixel(lrc::Vec2i(px, py),
+									pix / static_cast<float>(perPixel));
+				}
+			}
+
+			if (m_storeSamples) {
+				const int64_t rowSamples = (lastCol - firstCol) * perPixel;
+				m_histogram.add(sampleSlot(firstCol, py), rowSamples);
+			}
+		}
+	}
+
+	void FractalRenderer::setKeepIterationData(bool keep) {
+		m_keepIterationData = keep;
+		if (keep || m_histogramColoring) return;
+
+		stopRender();
+		m_samplesValid = false;
+		IterationBuffer().swap(m_samples);
+	}
+
+	bool FractalRenderer::keepIterationData() const { return m_keepIterationData; }
+
+	IterationBuffer FractalRenderer::takeIterationData() {
+		const lrc::Vec2i &imageSize = m_renderConfig.imageSize;
+		const int64_t numSamples =
+		  imageSize.x() * imageSize.y() * m_sampleAlias * m_sampleAlias;
+		if (!m_samplesValid || m_samples.size() != (size_t)numSamples) return {};
+
+		// The next render allocates a new buffer, which is touched again
+		IterationBuffer samples;
+		samples.swap(m_samples);
+		m_samplesValid	 = false;
+		m_samplesTouched = false;
+		return samples;
+	}
+
+	void FractalRenderer::setDeferredColoring(bool defer) { m_deferColoring = defer; }
+
+	bool FractalRenderer::recolor() {
+		const int64_t width	 = m_renderConfig.imageSize.x();
+		const int64_t height = m_renderConfig.imageSize.y();
+		const int64_t perPixel = m_sampleAlias * m_sampleAlias;
+
+		if (!m_samplesValid || !m_fractal || m_distanceColoring ||
+			m_samples.size() != (size_t)(width * height * perPixel) ||
+			m_fractalSurface.getWidth() != width ||
+			m_fractalSurface.getHeight() != height)
+			return false;
+
+		// Stop any earlier colouring pass. The data stays valid, since it is only
+		// invalidated by starting a new render
+		stopRender();
+
+		// Capture the new colouring function and palette. The view is unchanged, or the
+		// data would have been invalidated
+		FRAC_LOG("Recolouring Fractal...");
+		m_job = captureJob();
+		discardPublished();
+
+		std::lock_guard<std::mutex> lock(m_boxMutex);
+		m_boxesRemaining = queueColorPass();
+		if (m_boxesRemaining == 0) finishJob();
+		return true;
+	}
+
+	IterationSample *FractalRenderer::sampleSlot(int64_t px, int64_t py) {
+		if (!m_storeSamples) return nullptr;
+
+		const int64_t perPixel = m_sampleAlias * m_sampleAlias;
+		return m_samples.data() + (py * m_job->config.imageSize.x() + px) * perPixel;
+	}
+
+	void FractalRenderer::queuePlacedWorkers(const lrc::Vec2i &numBoxes) {
+		struct Placement {
+			std::mutex mutex;
+			std::condition_variable allStarted;
+			int64_t started = 0;
+
+			std::vector<int64_t> nodeWorkers;		 // Number of workers on each node
+			std::vector<std::vector<int64_t>> bands; // Boxes owned by each node
+			std::vector<size_t> next;				 // Next box to take from each band
+			std::vector<int64_t> firstRow;			 // First pixel row of each band
+			std::vector<int64_t> lastRow;			 // One past the last pixel row
+		};
+
+		// The pool size is what matters here, since every worker must be running at
+		// once to pass the start barrier
+		const auto numWorkers = (int64_t)m_threadPool.get_thread_count();
+		const auto numNodes	  = (int64_t)m_numaNodes.size();
+		const int64_t boxRows = numBoxes.y();
+		const int64_t boxH	  = m_job->config.boxSize.y();
+		const int64_t height  = m_job->config.imageSize.y();
+		const bool touch	  = !m_surfaceTouched;
+		m_surfaceTouched	  = true;
+
+		// The iteration data is placed the same way when it has just been allocated
+		const bool touchSamples = m_storeSamples && !m_samplesTouched;
+		const int64_t rowSamples =
+		  m_job->config.imageSize.x() * m_sampleAlias * m_sampleAlias;
+		if (m_storeSamples) m_samplesTouched = true;
+
+		auto placement = std::make_shared<Placement>();
+		placement->nodeWorkers.resize(numNodes, 0);
+		for (int64_t w = 0; w < numWorkers; ++w) ++placement->nodeWorkers[w % numNodes];
+
+		// Give each node a contiguous band of box rows, in proportion to its number of
+		// workers
+		int64_t workersBefore = 0;
+		for (int64_t node = 0; node < numNodes; ++node) {
+			const int64_t firstBoxRow = workersBefore * boxRows / numWorkers;
+			workersBefore += placement->nodeWorkers[node];
+			const int64_t lastBoxRow = workersBefore * boxRows / numWorkers;
+
+			// Boxes split around reflected pixels keep the row of the box they came from
+			std::vector<int64_t> band;
+			for (int64_t i = 0; i < (int64_t)m_renderBoxes.size(); ++i) {
+				const int64_t boxRow = m_renderBoxes[i].topLeft.y() / boxH;
+				if (boxRow >= firstBoxRow && boxRow < lastBoxRow) band.push_back(i);
+			}
+
+			placement->bands.push_back(std::move(band));
+			placement->next.push_back(0);
+			placement->firstRow.push_back(lrc::min(firstBoxRow * boxH, height));
+			placement->lastRow.push_back(lrc::min(lastBoxRow * boxH, height));
+		}
+
+		ci::Surface &target = *m_job->target;
+		for (int64_t w = 0; w < numWorkers; ++w) {
+			m_threadPool.push_task([this, &target, placement, w, numWorkers, numNodes,
+									touch, touchSamples, rowSamples]() {
+				const int64_t node				 = w % numNodes;
+				const int64_t slot				 = w / numNodes;
+				const std::vector<int64_t> &cpus = m_numaNodes[node].cpus;
+				topology::pinCurrentThread(cpus[slot % cpus.size()]);
+
+				// Pages are placed on the node of the thread that first writes to them,
+				// so each worker clears its share of its node's band before anything
+				// else touches the surface or the iteration data
+				const int64_t workers  = placement->nodeWorkers[node];
+				const int64_t bandTop  = placement->firstRow[node];
+				const int64_t bandRows = placement->lastRow[node] - bandTop;
+				const int64_t first	   = bandTop + bandRows * slot / workers;
+				const int64_t last	   = bandTop + bandRows * (slot + 1) / workers;
+				if (touch) {
+					const size_t rowBytes = target.getRowBytes();
+					std::memset(target.getData() + first * rowBytes,
+								0,
+								(last - first) * rowBytes);
+				}
+
+				if (touchSamples) {
+					std::memset(m_samples.data() + first * rowSamples,
+								0,
+								(last - first) * rowSamples * sizeof(IterationSample));
+				}
+
+				// Wait for every worker, so each one is on a different thread and no box
+				// is rendered before the surface has been placed
+				{
+					std::unique_lock<std::mutex> lock(placement->mutex);
+					if (++placement->started == numWorkers) {
+						placement->allStarted.notify_all();
+					} else {
+						placement->allStarted.wait(
+						  lock, [&]() { return placement->started == numWorkers; });
+					}
+				}
+
+				// Work through this node's band, then help the other nodes with theirs
+				for (int64_t offset = 0; offset < numNodes; ++offset) {
+					const int64_t band = (node + offset) % numNodes;
+					while (true) {
+						int64_t index;
+						{
+							std::lock_guard<std::mutex> lock(placement->mutex);
+							if (placement->next[band] >= placement->bands[band].size())
+								break;
+							index = placement->bands[band][placement->next[band]++];
+						}
+						renderQueuedBox(index);
+					}
+				}
+			});
+		}
 	}
 
 	void FractalRenderer::renderBox(const RenderBox &box, int64_t boxIndex) {
+		const RenderJob &job	   = *m_job;
+		const RenderConfig &config = job.config;
+		ci::Surface &target		   = *job.target;
+
 		// Update the render box state
 		m_renderBoxes[boxIndex].state = RenderBoxState::Rendering;
 		const double start			  = lrc::now();
+		const int64_t computedAtStart = pixelsComputedOnThread;
 
 		const int64_t inc = box.draftRender ? box.draftInc : 1;
 
-		HighVec2 fractalOrigin = lrc::map(
-		  static_cast<HighVec2>(box.topLeft),
-		  HighVec2({0, 0}),
-		  static_cast<HighVec2>(m_renderConfig.imageSize),
-		  m_renderConfig.fracTopLeft,
-		  m_renderConfig.fracTopLeft + static_cast<HighVec2>(m_renderConfig.fracSize));
-
-		HighVec2 step =
-		  m_renderConfig.fracSize / static_cast<HighVec2>(m_renderConfig.imageSize);
-
-		int64_t aliasFactor = m_renderConfig.antiAlias;
+		int64_t aliasFactor = config.antiAlias;
 		if (box.draftRender) aliasFactor = 1; // No anti-aliasing for drafts
 
-		HighPrecision scaleFactor =
-		  HighPrecision(1) / static_cast<HighPrecision>(aliasFactor);
-		HighVec2 aliasStepCorrect(scaleFactor, scaleFactor);
+		const BoxPosition position = boxPosition(box, aliasFactor);
 
-		const size_t supportedOptimisations = m_fractal->supportedOptimisations();
+		const size_t supportedOptimisations = job.fractal->supportedOptimisations();
 		const bool supportsOutlining =
 		  supportedOptimisations & optimisations::OUTLINE_OPTIMISATION;
 
 		bool blackEdges = true; // Assume edges are black to begin with
 
+		const int64_t imageWidth = config.imageSize.x();
+		const bool hasKnownPixels =
+		  m_knownPixels.size() == (size_t)(imageWidth * config.imageSize.y());
+
+		const bool boundaryTracing =
+		  job.boundaryTracing && !box.draftRender && !hasKnownPixels &&
+		  (supportedOptimisations & optimisations::BOUNDARY_TRACING);
+
+		// Specialised kernels and distance estimates are per pixel
+		const bool batchedRows =
+		  (supportedOptimisations & optimisations::BATCHED_ITERATION) && !job.kernels &&
+		  !job.distanceColoring && config.precision <= 64;
+
 		if (m_haltRender) return;
 
 		if (box.draftRender) {
@@ -187,94 +911,269 @@ namespace frac {
 				for (int64_t px = box.topLeft.x();
 					 px < box.topLeft.x() + box.dimensions.x();
 					 ++px) {
-					m_fractalSurface.setPixel(lrc::Vec2i(px, py),
-											  ci::ColorA {0.2, 0, 0.2, 0.5});
+					target.setPixel(lrc::Vec2i(px, py), ci::ColorA {0.2, 0, 0.2, 0.5});
 				}
 			}
 		}
 
-		if (supportsOutlining) {
+		if (supportsOutlining && !boundaryTracing) {
 			for (int64_t i = 0; i < 4; ++i) {
-				blackEdges &= renderEdge(
-				  box, fractalOrigin, aliasFactor, step, aliasStepCorrect, inc, i);
+				blackEdges &= renderEdge(box, position, aliasFactor, inc, i);
 			}
 		}
 
-		if (supportsOutlining && blackEdges) {
+		if (boundaryTracing) {
+			traceBox(box, position, aliasFactor);
+		} else if (supportsOutlining && blackEdges) {
 			for (int64_t py = box.topLeft.y() + 1;
 				 py < box.topLeft.y() + box.dimensions.y() - 1;
 				 py += inc) {
 				for (int64_t px = box.topLeft.x() + 1;
 					 px < box.topLeft.x() + box.dimensions.x() - 1;
 					 px += inc) {
-					m_fractalSurface.setPixel(lrc::Vec2i(px, py),
-											  ci::ColorA {0, 0, 0, 1});
+					target.setPixel(lrc::Vec2i(px, py), ci::ColorA {0, 0, 0, 1});
+
+					// The interior is assumed to be in the set
+					if (IterationSample *slot = sampleSlot(px, py)) {
+						const IterationSample inSet {(int32_t)config.maxIters, 0};
+						std::fill(slot, slot + aliasFactor * aliasFactor, inSet);
+					}
 				}
 			}
 		} else {
 			int64_t offset = 0;
 			if (supportsOutlining) offset = 1;
 
-			// Make the primary axis of iteration the x-axis to improve cache
-			// efficiency and increase performance.
-			for (int64_t py = box.topLeft.y() + offset;
-				 py < box.topLeft.y() + box.dimensions.y() - offset;
-				 py += inc) {
-				// Quick return if required. Without this, the
-				// render threads will continue running after the
-				// application is closed, leading to weird behaviour.
-				if (m_haltRender) return;
+			const int64_t left	 = box.topLeft.x() + offset;
+			const int64_t top	 = box.topLeft.y() + offset;
+			const int64_t right	 = box.topLeft.x() + box.dimensions.x() - offset;
+			const int64_t bottom = box.topLeft.y() + box.dimensions.y() - offset;
+
+			// With the distance estimate fill, the box is rendered in blocks which may
+			// be filled without iterating. Otherwise, the whole box is a single block
+			const bool distanceFill = distanceFillApplies(box);
+			int64_t blockSize = lrc::max(box.dimensions.x(), box.dimensions.y());
+			if (distanceFill) blockSize = distanceFillBlock;
+			blockSize = lrc::max(int64_t(1), blockSize);
+
+			for (int64_t blockY = top; blockY < bottom; blockY += blockSize) {
+				for (int64_t blockX = left; blockX < right; blockX += blockSize) {
+					const lrc::Vec2i blockEnd(lrc::min(blockX + blockSize, right),
+											  lrc::min(blockY + blockSize, bottom));
+					if (distanceFill &&
+						fillBlock(box,
+								  position,
+								  aliasFactor,
+								  lrc::Vec2i(blockX, blockY),
+								  blockEnd))
+						continue;
+
+					// Make the primary axis of iteration the x-axis to improve cache
+					// efficiency and increase performance.
+					for (int64_t py = blockY; py < blockEnd.y(); py += inc) {
+						// Quick return if required. Without this, the
+						// render threads will continue running after the
+						// application is closed, leading to weird behaviour.
+						if (m_haltRender) return;
+
+						if (batchedRows) {
+							renderRowLow(
+							  box, position, py, blockX, blockEnd.x(), inc, aliasFactor);
+							continue;
+						}
+
+						for (int64_t px = blockX; px < blockEnd.x(); px += inc) {
+							if (hasKnownPixels && m_knownPixels[py * imageWidth + px])
+								continue;
+
+							target.setPixel(lrc::Vec2i(px, py),
+											pixelColor(position,
+													   px - box.topLeft.x(),
+													   py - box.topLeft.y(),
+													   aliasFactor,
+													   sampleSlot(px, py)));
+						}
+					}
+				}
+			}
+		}
 
-				for (int64_t px = box.topLeft.x() + offset;
-					 px < box.topLeft.x() + box.dimensions.x() - offset;
-					 px += inc) {
-					// Anti-aliasing
-					auto pixPos = fractalOrigin + step * HighVec2(px - box.topLeft.x(),
-																  py - box.topLeft.y());
+		// Count the box's samples while they are still in cache
+		if (m_storeSamples && !m_haltRender) {
+			const int64_t rowSamples = box.dimensions.x() * aliasFactor * aliasFactor;
+			for (int64_t py = box.topLeft.y(); py < box.topLeft.y() + box.dimensions.y();
+				 ++py)
+				m_histogram.add(sampleSlot(box.topLeft.x(), py), rowSamples);
+		}
+
+		// Update the render box state
+		m_renderBoxes[boxIndex].state		   = RenderBoxState::Rendered;
+		m_renderBoxes[boxIndex].renderTime	   = lrc::now() - start;
+		m_renderBoxes[boxIndex].pixelsComputed = pixelsComputedOnThread - computedAtStart;
+	}
+
+	void FractalRenderer::traceBox(const RenderBox &box, const BoxPosition &position,
+								   int64_t aliasFactor) {
+		ci::Surface &target			= *m_job->target;
+		const int64_t width			= box.dimensions.x();
+		const int64_t height		= box.dimensions.y();
+		const int64_t samplesPerPix	= aliasFactor * aliasFactor;
+
+		// The colour of each pixel of the box, and the region it belongs to (see
+		// unknownPixel and computedPixel)
+		std::vector<ci::ColorA> colors(width * height);
+		std::vector<int32_t> regions(width * height, unknownPixel);
+
+		// Colour of a pixel, which is computed the first time it is needed
+		const auto colorAt = [&](int64_t x, int64_t y) -> const ci::ColorA & {
+			const int64_t i = y * width + x;
+			if (regions[i] == unknownPixel) {
+				const int64_t px = box.topLeft.x() + x;
+				const int64_t py = box.topLeft.y() + y;
+				colors[i]  = pixelColor(position, x, y, aliasFactor, sampleSlot(px, py));
+				regions[i] = computedPixel;
+				target.setPixel(lrc::Vec2i(px, py), colors[i]);
+			}
+			return colors[i];
+		};
+
+		const auto inRegion = [&](int64_t x, int64_t y, const ci::ColorA &color) {
+			if (x < 0 || y < 0 || x >= width || y >= height) return false;
+			return sameColor(colorAt(x, y), color);
+		};
+
+		// Whether a run of unknown pixels, following a pixel of a region along a row,
+		// is enclosed by the region. The run must end at a known pixel of the region's
+		// colour, no known pixel above or below it may have another colour, and its
+		// pixels on a coarse grid are computed and must have the region's colour too.
+		// A run that fails is left unknown, so the scan starts new regions in it and
+		// traces any island there
+		const auto runEnclosed = [&](int64_t first, int64_t end, int64_t y,
+									 const ci::ColorA &color) {
+			if (end >= width || !sameColor(colors[y * width + end], color)) return false;
+
+			for (int64_t x = first; x < end; ++x) {
+				for (int64_t ny = y - 1; ny <= y + 1; ny += 2) {
+					if (ny < 0 || ny >= height) continue;
+					const int64_t i = ny * width + x;
+					if (regions[i] != unknownPixel && !sameColor(colors[i], color))
+						return false;
+				}
+			}
 
-					ci::ColorA pix;
+			if (y % traceProbeStride != 0) return true;
+			for (int64_t x = first; x < end; ++x) {
+				if (x % traceProbeStride == 0 && !sameColor(colorAt(x, y), color))
+					return false;
+			}
 
-					if (m_renderConfig.precision <= 64) {
-						pix = pixelColorLow(pixPos, aliasFactor, step, aliasStepCorrect);
-					} else {
-						pix = pixelColorHigh(pixPos, aliasFactor, step, aliasStepCorrect);
+			return true;
+		};
+
+		int32_t region = 0;
+		for (int64_t y = 0; y < height; ++y) {
+			if (m_haltRender) return;
+
+			for (int64_t x = 0; x < width; ++x) {
+				if (regions[y * width + x] != unknownPixel) continue;
+
+				// Every pixel before this one in scan order is known, so this is the top
+				// left corner of a new region
+				const ci::ColorA color = colorAt(x, y);
+				regions[y * width + x] = ++region;
+
+				// Follow the boundary clockwise, keeping a hand on the pixels outside the
+				// region. Every state (pixel and heading) is visited at most once, and
+				// the trace is complete when the first move is about to be repeated
+				int64_t traceX = x, traceY = y, heading = 0, firstMove = -1;
+				int64_t left = x, right = x, bottom = y;
+				for (int64_t steps = 0; steps < 4 * width * height; ++steps) {
+					int64_t move = -1;
+					for (int64_t turn = 3; turn < 7 && move < 0; ++turn) {
+						const int64_t dir	= (heading + turn) % 4;
+						const int64_t nextX	= traceX + traceDirX[dir];
+						const int64_t nextY	= traceY + traceDirY[dir];
+						if (inRegion(nextX, nextY, color)) move = dir;
 					}
 
-					m_fractalSurface.setPixel(lrc::Vec2i(px, py), pix);
+					if (move < 0) break; // The region is a single pixel
+					if (traceX == x && traceY == y && move == firstMove) break;
+					if (firstMove < 0) firstMove = move;
+
+					traceX += traceDirX[move];
+					traceY += traceDirY[move];
+					heading							 = move;
+					regions[traceY * width + traceX] = region;
+					left							 = lrc::min(left, traceX);
+					right							 = lrc::max(right, traceX);
+					bottom							 = lrc::max(bottom, traceY);
+				}
+
+				// The tracer has computed every pixel bordering the region from outside,
+				// so a run of unknown pixels following a pixel of the region along a row
+				// is enclosed by it, unless the region surrounds an island of another
+				// colour that the trace never reached
+				for (int64_t fillY = y; fillY <= bottom; ++fillY) {
+					const int64_t row = fillY * width;
+					for (int64_t fillX = left + 1; fillX <= right; ++fillX) {
+						if (regions[row + fillX] != unknownPixel) continue;
+						if (regions[row + fillX - 1] != region) continue;
+
+						int64_t runEnd = fillX;
+						while (runEnd < width && regions[row + runEnd] == unknownPixel)
+							++runEnd;
+
+						if (runEnclosed(fillX, runEnd, fillY, color)) {
+							for (int64_t runX = fillX; runX < runEnd; ++runX) {
+								const int64_t i	 = row + runX;
+								const int64_t px = box.topLeft.x() + runX;
+								const int64_t py = box.topLeft.y() + fillY;
+								if (regions[i] == unknownPixel) {
+									colors[i] = color;
+									target.setPixel(lrc::Vec2i(px, py), color);
+									if (IterationSample *slot = sampleSlot(px, py))
+										std::copy(slot - samplesPerPix, slot, slot);
+								}
+								regions[i] = region;
+							}
+						}
+
+						fillX = runEnd;
+					}
 				}
 			}
 		}
+	}
 
-		// Update the render box state
-		m_renderBoxes[boxIndex].state	   = RenderBoxState::Rendered;
-		m_renderBoxes[boxIndex].renderTime = lrc::now() - start;
+	void FractalRenderer::setBoundaryTracing(bool trace) { m_boundaryTracing = trace; }
+
+	void FractalRenderer::setSymmetry(bool mirror) { m_symmetry = mirror; }
+
+	int64_t FractalRenderer::pixelsComputed() const {
+		int64_t total = 0;
+		for (const auto &box : m_renderBoxes) total += box.pixelsComputed;
+		return total;
 	}
 
-	bool FractalRenderer::renderEdge(const RenderBox &box, const HighVec2 &fractalOrigin,
-									 int64_t aliasFactor, const HighVec2 &step,
-									 const HighVec2 &aliasStepCorrect, int64_t inc,
-									 int64_t edge) {
-		bool edgesInSet = true;
+	bool FractalRenderer::renderEdge(const RenderBox &box, const BoxPosition &position,
+									 int64_t aliasFactor, int64_t inc, int64_t edge) {
+		ci::Surface &target = *m_job->target;
+		bool edgesInSet		= true;
 		if (edge & 1) { // Edge is 1 or 3 -> Right or left
 			int64_t px = 0;
 			if (edge == 3) px = box.dimensions.x() - 1;
 
 			for (int64_t py = box.topLeft.y(); py < box.topLeft.y() + box.dimensions.y();
 				 py += inc) {
-				// Anti-aliasing
-				auto pixPos = fractalOrigin + step * HighVec2(px, py - box.topLeft.y());
-
-				ci::ColorA pix;
-
-				if (m_renderConfig.precision <= 64) {
-					pix = pixelColorLow(pixPos, aliasFactor, step, aliasStepCorrect);
-				} else {
-					pix = pixelColorHigh(pixPos, aliasFactor, step, aliasStepCorrect);
-				}
+				ci::ColorA pix = pixelColor(position,
+											px,
+											py - box.topLeft.y(),
+											aliasFactor,
+											sampleSlot(box.topLeft.x() + px, py));
 
 				if (pix.r != 0 || pix.g != 0 || pix.b != 0) edgesInSet = false;
 
-				m_fractalSurface.setPixel(lrc::Vec2i(box.topLeft.x() + px, py), pix);
+				target.setPixel(lrc::Vec2i(box.topLeft.x() + px, py), pix);
 			}
 		} else { // Edge is 0 or 2 -> Top or bottom
 			int64_t py = 0;
@@ -282,63 +1181,274 @@ namespace frac {
 
 			for (int64_t px = box.topLeft.x(); px < box.topLeft.x() + box.dimensions.x();
 				 px += inc) {
-				// Anti-aliasing
-				auto pixPos = fractalOrigin + step * HighVec2(px - box.topLeft.x(), py);
-
-				ci::ColorA pix;
-
-				if (m_renderConfig.precision <= 64) {
-					pix = pixelColorLow(pixPos, aliasFactor, step, aliasStepCorrect);
-				} else {
-					pix = pixelColorHigh(pixPos, aliasFactor, step, aliasStepCorrect);
-				}
+				ci::ColorA pix = pixelColor(position,
+											px - box.topLeft.x(),
+											py,
+											aliasFactor,
+											sampleSlot(px, box.topLeft.y() + py));
 
 				if (pix.r != 0 || pix.g != 0 || pix.b != 0) edgesInSet = false;
 
-				m_fractalSurface.setPixel(lrc::Vec2i(px, box.topLeft.y() + py), pix);
+				target.setPixel(lrc::Vec2i(px, box.topLeft.y() + py), pix);
 			}
 		}
 		return edgesInSet;
 	}
 
-	ci::ColorA FractalRenderer::pixelColorLow(const LowVec2 &pixPos, int64_t aliasFactor,
-											  const LowVec2 &step,
-											  const LowVec2 &aliasStepCorrect) {
+	ci::ColorA FractalRenderer::pixelColorLow(const RenderJob &job, const LowVec2 &pixPos,
+											  int64_t aliasFactor,
+											  const LowVec2 &sampleStep,
+											  IterationSample *samples) const {
 		ci::ColorA pix(0, 0, 0, 1);
 
-		const ColorPalette &palette = m_renderConfig.palettes[m_paletteName];
+		const int64_t numSamples = aliasFactor * aliasFactor;
+
+		// The samples are iterated as one batch. The buffers are reused between pixels
+		thread_local std::vector<lrc::Complex<LowPrecision>> coords;
+		thread_local std::vector<std::pair<int64_t, lrc::Complex<LowPrecision>>> results;
+		coords.resize(numSamples);
+		results.resize(numSamples);
 
 		for (int64_t aliasY = 0; aliasY < aliasFactor; ++aliasY) {
 			for (int64_t aliasX = 0; aliasX < aliasFactor; ++aliasX) {
-				auto pos = pixPos + step * LowVec2(aliasX, aliasY) * aliasStepCorrect;
-				auto [iters, endPoint] =
-				  m_fractal->iterCoordLow(lrc::Complex<LowPrecision>(pos.x(), pos.y()));
-				pix += m_fractal->getColorLow(endPoint, iters, palette, m_colorFuncLow);
+				auto pos = pixPos + sampleStep * LowVec2(aliasX, aliasY);
+				coords[aliasY * aliasFactor + aliasX] =
+				  lrc::Complex<LowPrecision>(pos.x(), pos.y());
+			}
+		}
+
+		job.fractal->iterCoordsLow(coords.data(), numSamples, results.data());
+
+		for (int64_t i = 0; i < numSamples; ++i) {
+			const auto &[iters, endPoint] = results[i];
+			if (samples) samples[i] = makeSample(iters, endPoint);
+			pix +=
+			  job.fractal->getColorLow(endPoint, iters, *job.palette, job.colorFuncLow);
+		}
+
+		return pix / static_cast<float>(numSamples);
+	}
+
+	ci::ColorA FractalRenderer::pixelColorHigh(const RenderJob &job,
+											   const HighVec2 &pixPos,
+											   int64_t aliasFactor,
+											   const HighVec2 &sampleStep,
+											   IterationSample *samples) const {
+		ci::ColorA pix(0, 0, 0, 1);
+
+		const ColorPalette &palette = *job.palette;
+
+		for (int64_t aliasY = 0; aliasY < aliasFactor; ++aliasY) {
+			for (int64_t aliasX = 0; aliasX < aliasFactor; ++aliasX) {
+				auto pos = pixPos + sampleStep * HighVec2(aliasX, aliasY);
+				auto [iters, endPoint] = job.fractal->iterCoordHigh(
+				  lrc::Complex<HighPrecision>(pos.x(), pos.y()));
+				if (samples)
+					samples[aliasY * aliasFactor + aliasX] = makeSample(iters, endPoint);
+				pix +=
+				  job.fractal->getColorHigh(endPoint, iters, palette, job.colorFuncHigh);
 			}
 		}
 
 		return pix / static_cast<float>(aliasFactor * aliasFactor);
 	}
 
-	ci::ColorA FractalRenderer::pixelColorHigh(const HighVec2 &pixPos,
-											   int64_t aliasFactor, const HighVec2 &step,
-											   const HighVec2 &aliasStepCorrect) {
+	void FractalRenderer::renderRowLow(const RenderBox &box, const BoxPosition &position,
+									   int64_t py, int64_t firstX, int64_t lastX,
+									   int64_t inc, int64_t aliasFactor) {
+		const RenderJob &job		= *m_job;
+		const ColorPalette &palette = *job.palette;
+		const int64_t perPixel		= aliasFactor * aliasFactor;
+		const int64_t imageWidth	= job.config.imageSize.x();
+		const LowVec2 &pixelStep	= position.stepLow;
+		const LowVec2 &sampleStep	= position.sampleStepLow;
+		const bool hasKnownPixels =
+		  m_knownPixels.size() == (size_t)(imageWidth * job.config.imageSize.y());
+
+		// The buffers are reused between rows
+		thread_local std::vector<int64_t> columns;
+		thread_local std::vector<lrc::Complex<LowPrecision>> coords;
+		thread_local std::vector<std::pair<int64_t, lrc::Complex<LowPrecision>>> results;
+
+		columns.clear();
+		for (int64_t px = firstX; px < lastX; px += inc) {
+			if (!hasKnownPixels || !m_knownPixels[py * imageWidth + px])
+				columns.push_back(px);
+		}
+
+		const auto numPixels = (int64_t)columns.size();
+		coords.resize(numPixels * perPixel);
+		results.resize(numPixels * perPixel);
+
+		const LowVec2 rowPos =
+		  position.originLow + pixelStep * LowVec2(0, py - box.topLeft.y());
+		for (int64_t i = 0; i < numPixels; ++i) {
+			const LowVec2 pixPos =
+			  rowPos + pixelStep * LowVec2(columns[i] - box.topLeft.x(), 0);
+			for (int64_t aliasY = 0; aliasY < aliasFactor; ++aliasY) {
+				for (int64_t aliasX = 0; aliasX < aliasFactor; ++aliasX) {
+					const LowVec2 pos = pixPos + sampleStep * LowVec2(aliasX, aliasY);
+					coords[i * perPixel + aliasY * aliasFactor + aliasX] =
+					  lrc::Complex<LowPrecision>(pos.x(), pos.y());
+				}
+			}
+		}
+
+		job.fractal->iterCoordsLow(coords.data(), numPixels * perPixel, results.data());
+		pixelsComputedOnThread += numPixels;
+
+		for (int64_t i = 0; i < numPixels; ++i) {
+			IterationSample *samples = sampleSlot(columns[i], py);
+			ci::ColorA pix(0, 0, 0, 1);
+			for (int64_t sample = 0; sample < perPixel; ++sample) {
+				const auto &[iters, endPoint] = results[i * perPixel + sample];
+				if (samples) samples[sample] = makeSample(iters, endPoint);
+				pix +=
+				  job.fractal->getColorLow(endPoint, iters, palette, job.colorFuncLow);
+			}
+
+			job.target->setPixel(lrc::Vec2i(columns[i], py),
+								 pix / static_cast<float>(perPixel));
+		}
+	}
+
+	ci::ColorA FractalRenderer::pixelColorDistance(const RenderJob &job,
+												   const LowVec2 &pixPos,
+												   int64_t aliasFactor,
+												   const LowVec2 &sampleStep) const {
 		ci::ColorA pix(0, 0, 0, 1);
 
-		const ColorPalette &palette = m_renderConfig.palettes[m_paletteName];
+		const ColorPalette &palette = *job.palette;
 
 		for (int64_t aliasY = 0; aliasY < aliasFactor; ++aliasY) {
 			for (int64_t aliasX = 0; aliasX < aliasFactor; ++aliasX) {
-				auto pos = pixPos + step * HighVec2(aliasX, aliasY) * aliasStepCorrect;
-				auto [iters, endPoint] =
-				  m_fractal->iterCoordHigh(lrc::Complex<HighPrecision>(pos.x(), pos.y()));
-				pix += m_fractal->getColorHigh(endPoint, iters, palette, m_colorFuncHigh);
+				auto pos = pixPos + sampleStep * LowVec2(aliasX, aliasY);
+				const DistanceEstimate estimate = job.fractal->distanceEstimateLow(
+				  lrc::Complex<LowPrecision>(pos.x(), pos.y()));
+
+				if (estimate.interior || estimate.distance == 0) {
+					pix += ci::ColorA(0, 0, 0, 1);
+				} else {
+					pix += coloring::distanceColor(estimate.distance / job.pixelSpacing,
+												   palette);
+				}
 			}
 		}
 
 		return pix / static_cast<float>(aliasFactor * aliasFactor);
 	}
 
+	void FractalRenderer::setDistanceFill(bool fill) { m_distanceFill = fill; }
+
+	bool FractalRenderer::distanceFillApplies(const RenderBox &box) const {
+		const RenderJob &job = *m_job;
+		const size_t imagePixels =
+		  (size_t)(job.config.imageSize.x() * job.config.imageSize.y());
+
+		return job.distanceFill && !box.draftRender && job.config.precision <= 64 &&
+			   (job.fractal->supportedOptimisations() &
+				optimisations::DISTANCE_ESTIMATION) &&
+			   m_knownPixels.size() != imagePixels;
+	}
+
+	bool FractalRenderer::fillBlock(const RenderBox &box, const BoxPosition &position,
+									int64_t aliasFactor, const lrc::Vec2i &topLeft,
+									const lrc::Vec2i &bottomRight) {
+		const RenderJob &job = *m_job;
+		const lrc::Vec2i centre((topLeft.x() + bottomRight.x()) / 2,
+								(topLeft.y() + bottomRight.y()) / 2);
+		const LowVec2 centrePos =
+		  position.originLow + position.stepLow * LowVec2(centre.x() - box.topLeft.x(),
+														  centre.y() - box.topLeft.y());
+		++pixelsComputedOnThread;
+		const DistanceEstimate estimate = job.fractal->distanceEstimateLow(
+		  lrc::Complex<LowPrecision>(centrePos.x(), centrePos.y()));
+
+		// Every sample in the block lies within this distance of the centre, and the
+		// true distance to the boundary is at least a quarter of the estimate
+		const double stepRe = position.stepLow.x();
+		const double stepIm = position.stepLow.y();
+		const int64_t span	= lrc::max(bottomRight.x() - topLeft.x(),
+									   bottomRight.y() - topLeft.y());
+		const double radius = (double)span * std::hypot(stepRe, stepIm);
+		const double clear	= estimate.distance / 4 - radius;
+		if (clear <= 0) return false;
+
+		ci::ColorA color(0, 0, 0, 1);
+		if (!estimate.interior) {
+			// Outside the set, the pixels only share a colour once the distance
+			// colouring has saturated. Their iteration data would also differ
+			if (!job.distanceColoring || m_storeSamples) return false;
+			if (clear < coloring::distanceSaturation * job.pixelSpacing) return false;
+
+			color = coloring::distanceColor(coloring::distanceSaturation, *job.palette);
+		}
+
+		const IterationSample inSet {(int32_t)job.config.maxIters, 0};
+		for (int64_t py = topLeft.y(); py < bottomRight.y(); ++py) {
+			for (int64_t px = topLeft.x(); px < bottomRight.x(); ++px) {
+				job.target->setPixel(lrc::Vec2i(px, py), color);
+				if (IterationSample *slot = sampleSlot(px, py))
+					std::fill(slot, slot + aliasFactor * aliasFactor, inSet);
+			}
+		}
+
+		return true;
+	}
+
+	BoxPosition FractalRenderer::boxPosition(const RenderBox &box,
+											 int64_t aliasFactor) const {
+		const RenderConfig &config = m_job->config;
+
+		BoxPosition position;
+		position.origin =
+		  lrc::map(static_cast<HighVec2>(box.topLeft),
+				   HighVec2({0, 0}),
+				   static_cast<HighVec2>(config.imageSize),
+				   config.fracTopLeft,
+				   config.fracTopLeft + static_cast<HighVec2>(config.fracSize));
+		position.step = config.fracSize / static_cast<HighVec2>(config.imageSize);
+		position.sampleStep =
+		  position.step / static_cast<HighPrecision>(lrc::max(int64_t(1), aliasFactor));
+
+		position.originLow	   = position.origin;
+		position.stepLow	   = position.step;
+		position.sampleStepLow = position.sampleStep;
+		return position;
+	}
+
+	ci::ColorA FractalRenderer::pixelColor(const BoxPosition &position, int64_t x,
+										   int64_t y, int64_t aliasFactor,
+										   IterationSample *samples) {
+		++pixelsComputedOnThread;
+
+		const RenderJob &job		   = *m_job;
+		kernels::KernelContext context = job.kernelContext;
+		context.aliasFactor			   = aliasFactor;
+		const bool antiAlias		   = aliasFactor > 1;
+
+		if (job.config.precision > 64) {
+			const HighVec2 pixPos = position.origin + position.step * HighVec2(x, y);
+			if (job.kernels)
+				return job.kernels->highTier[antiAlias](
+				  context, pixPos, position.sampleStep, samples);
+			return pixelColorHigh(job, pixPos, aliasFactor, position.sampleStep, samples);
+		}
+
+		// The origin was rounded to double once, and offsets within the box are far
+		// smaller than it, so nothing per pixel needs high precision
+		const LowVec2 pixPos	  = position.originLow + position.stepLow * LowVec2(x, y);
+		const LowVec2 &sampleStep = position.sampleStepLow;
+
+		// Distance estimates are only made in double precision
+		if (job.distanceColoring)
+			return pixelColorDistance(job, pixPos, aliasFactor, sampleStep);
+
+		if (job.kernels)
+			return job.kernels->lowTier[antiAlias](context, pixPos, sampleStep, samples);
+		return pixelColorLow(job, pixPos, aliasFactor, sampleStep, samples);
+	}
+
 	void FractalRenderer::updateRenderConfig() {
 		m_fractal->updateRenderConfig(m_renderConfig);
 	}
@@ -348,12 +1458,49 @@ namespace frac {
 		int64_t w		 = m_renderConfig.imageSize.x();
 		int64_t h		 = m_renderConfig.imageSize.y();
 		m_fractalSurface = ci::Surface((int32_t)w, (int32_t)h, true);
+		m_surfaceTouched = false;
+		m_samplesValid	 = false;
+
+		// The front buffer is reallocated to match when it is next presented
+		discardPublished();
 		FRAC_LOG("Surface regenerated");
 	}
 
-	void FractalRenderer::updateFractalType(const std::shared_ptr<Fractal> &fractal) {
-		m_fractal = fractal;
-		m_fractal->updateRenderConfig(m_renderConfig);
+	void FractalRenderer::setKnownPixels(std::vector<uint8_t> mask,
+										 IterationBuffer samples) {
+		m_knownPixels  = std::move(mask);
+		m_knownSamples = !samples.empty();
+		if (!m_knownSamples) return;
+
+		// The supplied data has already been written, so the render threads must not
+		// clear it when they first touch the buffer
+		stopRender();
+		m_samples		 = std::move(samples);
+		m_samplesTouched = true;
+		m_samplesValid	 = false;
+	}
+
+	void FractalRenderer::updateFractalType(const std::string &name,
+											const json &settings) {
+		m_fractalName	  = name;
+		m_fractalSettings = settings;
+		m_fractal		  = createFractal(name, m_renderConfig, settings);
+		m_samplesValid	  = false;
+		selectKernels();
+	}
+
+	void FractalRenderer::selectKernels() {
+		if (!m_fractal) {
+			m_kernels = nullptr;
+			return;
+		}
+
+		m_kernels = kernels::findKernels(m_fractal->name(), sampleColorFuncName());
+	}
+
+	std::string FractalRenderer::sampleColorFuncName() const {
+		if (m_histogramColoring || m_distanceColoring) return coloring::histogramPreview;
+		return m_colorFuncName;
 	}
 
 	void FractalRenderer::updateConfigPrecision() {
@@ -400,21 +1547,26 @@ namespace frac {
 		const auto &colorFuncs = m_fractal->getLowPrecColoringAlgorithms();
 		std::vector<std::string> ret;
 		for (const auto &[name, palette] : colorFuncs) { ret.push_back(name); }
+		if (m_fractal->isEscapeTime()) ret.push_back(coloring::histogramEqualisation);
+		if (m_fractal->supportedOptimisations() & optimisations::DISTANCE_ESTIMATION)
+			ret.push_back(coloring::distanceEstimation);
 		return ret;
 	}
 
 	void FractalRenderer::setColorFunc(const std::string &name) {
-		m_colorFuncName = name;
-		m_colorFuncLow	= m_fractal->getLowPrecColoringAlgorithms().at(name);
-		m_colorFuncHigh = m_fractal->getHighPrecColoringAlgorithms().at(name);
+		m_colorFuncName		= name;
+		m_histogramColoring = name == coloring::histogramEqualisation;
+		m_distanceColoring	= name == coloring::distanceEstimation;
+
+		// Boxes are previewed with a per-sample function until the histogram is complete
+		const std::string sampleFunc = sampleColorFuncName();
+		m_colorFuncLow	= m_fractal->getLowPrecColoringAlgorithms().at(sampleFunc);
+		m_colorFuncHigh = m_fractal->getHighPrecColoringAlgorithms().at(sampleFunc);
+		selectKernels();
 	}
 
 	std::vector<std::string> FractalRenderer::getPaletteNames() const {
-		std::vector<std::string> ret;
-		for (const auto &[name, palette] : m_renderConfig.palettes) {
-			ret.push_back(name);
-		}
-		return ret;
+		return m_renderConfig.palettes->names();
 	}
 
 	void FractalRenderer::setPaletteName(const std::string &name) {
@@ -442,6 +1594,12 @@ namespace frac {
 	}
 
 	void FractalRenderer::exportSettings(const std::string &path) const {
+		std::fstream file(path, std::ios::out);
+		file << exportSettingsJson().dump(4);
+		file.close();
+	}
+
+	json FractalRenderer::exportSettingsJson() const {
 		// All updates to the render configuration must be copied to the settings
 		json settings = m_settings;
 
@@ -472,8 +1630,6 @@ namespace frac {
 		settings["renderConfig"]["colorFunc"]	 = m_colorFuncName;
 		settings["renderConfig"]["colorPalette"] = m_paletteName;
 
-		std::fstream file(path, std::ios::out);
-		file << settings.dump(4);
-		file.close();
+		return settings;
 	}
 } // namespace frac
@@ -7,12 +7,31 @@ namespace frac {
 		m_renderConfig = config;
 	}
 
+	void Fractal::configure(const json &settings) {}
+
 	size_t Fractal::supportedOptimisations() const {
 		return 0; // By default, assume no optimisations are valid
 	}
 
+	Symmetry Fractal::symmetry() const { return Symmetry::None; }
+
 	std::string Fractal::name() const { return "Generic Fractal"; }
 
+	bool Fractal::isEscapeTime() const { return false; }
+
+	void
+	Fractal::iterCoordsLow(const lrc::Complex<LowPrecision> *coords, int64_t count,
+						   std::pair<int64_t, lrc::Complex<LowPrecision>> *results)
+	  const {
+		for (int64_t i = 0; i < count; ++i) results[i] = iterCoordLow(coords[i]);
+	}
+
+	DistanceEstimate
+	Fractal::distanceEstimateLow(const lrc::Complex<LowPrecision> &coord) const {
+		auto [iters, endPoint] = iterCoordLow(coord);
+		return {iters, endPoint, 0, false};
+	}
+
 	ci::ColorA Fractal::getColorLow(const lrc::Complex<LowPrecision> &coord,
 									int64_t iters, const ColorPalette &palette,
 									const coloring::ColorFuncLow &colorFunc) const {
@@ -24,4 +43,44 @@ namespace frac {
 									 const coloring::ColorFuncHigh &colorFunc) const {
 		return colorFunc(coord, iters, palette);
 	}
+
+	double exteriorDistance(const lrc::Complex<LowPrecision> &endPoint,
+							const lrc::Complex<LowPrecision> &derivative) {
+		// 2 |z| ln|z| / |z'| is an upper bound on the distance, and the Koebe quarter
+		// theorem gives a quarter of it as a lower bound
+		const double radius = std::sqrt(endPoint.real() * endPoint.real() +
+										endPoint.imag() * endPoint.imag());
+		const double slope	= std::sqrt(derivative.real() * derivative.real() +
+										derivative.imag() * derivative.imag());
+		const double distance = 2 * radius * std::log(radius) / slope;
+		return std::isfinite(distance) && distance > 0 ? distance : 0;
+	}
+
+	std::shared_ptr<Fractal> createFractal(const std::string &name,
+										   const RenderConfig &config,
+										   const json &settings) {
+		std::shared_ptr<Fractal> fractal;
+		if (name == "Julia Set") {
+			fractal = std::make_shared<JuliaSet>(config);
+		} else if (name == "Newton's Fractal") {
+			fractal = std::make_shared<NewtonFractal>(config);
+		} else if (name == "Formula") {
+			fractal = std::make_shared<FormulaFractal>(config);
+		} else if (name == "Multibrot 3") {
+			fractal = std::make_shared<Multibrot3>(config);
+		} else if (name == "Multibrot 4") {
+			fractal = std::make_shared<Multibrot4>(config);
+		} else if (name == "Multibrot 5") {
+			fractal = std::make_shared<Multibrot5>(config);
+		} else if (name == "Burning Ship") {
+			fractal = std::make_shared<BurningShip>(config);
+		} else if (name == "Burning Ship 3") {
+			fractal = std::make_shared<BurningShip3>(config);
+		} else {
+			fractal = std::make_shared<Mandelbrot>(config);
+		}
+
+		if (settings.is_object()) fractal->configure(settings);
+		return fractal;
+	}
 } // namespace frac
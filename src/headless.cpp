@@ -0,0 +1,1015 @@
+#include <fractal/fractal.hpp>
+
+#if defined(_WIN32)
+#	include <fcntl.h>
+#	include <io.h>
+#endif
+
+namespace frac::headless {
+	namespace {
+		// Allocations made by GMP (and MPFR, which allocates through it) while the
+		// counting functions are installed (see runAllocations)
+		std::atomic<int64_t> multiprecisionAllocations {0};
+
+		void *(*defaultAlloc)(size_t)					= nullptr;
+		void *(*defaultRealloc)(void *, size_t, size_t) = nullptr;
+		void (*defaultFree)(void *, size_t)				= nullptr;
+
+		void *countingAlloc(size_t size) {
+			++multiprecisionAllocations;
+			return defaultAlloc(size);
+		}
+
+		void *countingRealloc(void *ptr, size_t oldSize, size_t newSize) {
+			++multiprecisionAllocations;
+			return defaultRealloc(ptr, oldSize, newSize);
+		}
+	} // namespace
+
+	Arguments::Arguments(int argc, char **argv) {
+		if (argc > 0) m_program = argv[0];
+
+		int i = 1;
+		if (argc > 1 && std::string(argv[1]).rfind("--", 0) != 0) m_mode = argv[i++];
+
+		for (; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg.rfind("--", 0) != 0) {
+				FRAC_WARN(fmt::format("Ignoring unexpected argument: {}", arg));
+				continue;
+			}
+
+			std::string key = arg.substr(2);
+			std::string value;
+
+			// Options take the next argument as their value, unless it is another option
+			if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0)
+				value = argv[++i];
+
+			m_values[key] = value;
+		}
+	}
+
+	const std::string &Arguments::program() const { return m_program; }
+	const std::string &Arguments::mode() const { return m_mode; }
+
+	bool Arguments::has(const std::string &key) const {
+		return m_values.find(key) != m_values.end();
+	}
+
+	std::string Arguments::get(const std::string &key,
+							   const std::string &fallback) const {
+		auto it = m_values.find(key);
+		if (it == m_values.end() || it->second.empty()) return fallback;
+		return it->second;
+	}
+
+	int64_t Arguments::getInt(const std::string &key, int64_t fallback) const {
+		std::string value = get(key);
+		if (value.empty()) return fallback;
+		try {
+			return std::stoll(value);
+		} catch (std::exception &e) {
+			FRAC_WARN(fmt::format("Invalid integer for --{}: {}", key, value));
+			return fallback;
+		}
+	}
+
+	bool loadSettings(const std::string &path, json &settings) {
+		std::fstream settingsFile(path, std::ios::in);
+		if (!settingsFile.is_open()) {
+			FRAC_ERROR(fmt::format("Failed to open settings file {}", path));
+			return false;
+		}
+
+		try {
+			settings = json::parse(settingsFile);
+		} catch (std::exception &e) {
+			FRAC_ERROR(
+			  fmt::format("Failed to parse settings file {}: {}", path, e.what()));
+			return false;
+		}
+
+		return true;
+	}
+
+	bool configureRenderer(FractalRenderer &renderer, const json &settings) {
+		try {
+			renderer.setConfig(settings);
+
+			const json &renderConfig = settings["renderConfig"];
+			std::string fractalType	 = renderConfig["fractalType"];
+			std::string colorFunc	 = renderConfig["colorFunc"];
+			std::string palette		 = renderConfig["colorPalette"];
+			float bailoutVal		 = renderConfig["fractals"][fractalType]["bail"];
+
+			renderer.updateFractalType(fractalType,
+									   renderConfig["fractals"][fractalType]);
+			renderer.setColorFunc(colorFunc);
+			renderer.setPaletteName(palette);
+			renderer.config().bail = bailoutVal;
+			renderer.updateConfigPrecision();
+			renderer.updateRenderConfig();
+		} catch (std::exception &e) {
+			FRAC_ERROR(fmt::format("Failed to configure renderer: {}", e.what()));
+			return false;
+		}
+
+		return true;
+	}
+
+	void applyOverrides(FractalRenderer &renderer, const Arguments &args) {
+		RenderConfig &config = renderer.config();
+
+		config.numThreads  = args.getInt("threads", config.numThreads);
+		config.draftRender = false; // Drafts are never useful without a window
+
+		// Changing the image size keeps the fractal-space height and rescales the width,
+		// so the pixels remain square
+		int64_t width  = args.getInt("width", config.imageSize.x());
+		int64_t height = args.getInt("height", config.imageSize.y());
+		if (width != config.imageSize.x() || height != config.imageSize.y()) {
+			HighVec2 center		 = config.fracTopLeft + config.fracSize / 2;
+			HighPrecision sizeIm = config.fracSize.y();
+			HighPrecision sizeRe = sizeIm * static_cast<HighPrecision>(width) /
+								   static_cast<HighPrecision>(height);
+			config.imageSize	 = lrc::Vec2i(width, height);
+			renderer.moveFractalCenter(center, HighVec2(sizeRe, sizeIm));
+		}
+
+		if (args.has("pin-threads")) renderer.setThreadPlacement(threadPlacement(args));
+		if (args.has("de-fill")) renderer.setDistanceFill(true);
+		if (args.has("trace")) renderer.setBoundaryTracing(true);
+
+		renderer.updateRenderConfig();
+	}
+
+	std::vector<topology::NumaNode> threadPlacement(const Arguments &args) {
+		if (!args.has("numa-nodes")) return topology::detect();
+		return topology::simulate(args.getInt("numa-nodes", 1));
+	}
+
+	void printUsage() {
+		fmt::print(R"(Usage: FractalRendererHeadless <mode> [options]
+
+Modes:
+  stream      Render an image of any size in bands, streaming it to disk
+  distribute  Render an image in bands across several local worker processes
+  worker      Serve band jobs from a coordinator (started by "distribute")
+  serve       Serve deep-zoom tiles over HTTP at /{z}/{x}/{y} (and /stats)
+  loadtest    Measure the throughput and latency of a running tile server
+  animate     Render a zoom animation to stdout as YUV4MPEG2 or a PPM sequence
+  expmap      Render a zoom animation from a single exponential map strip
+  batch       Render a list of settings files through one shared thread pool
+  placement   Compare render times with floating and NUMA-pinned threads
+  defill      Compare render times with and without the distance estimate fill
+  trace       Compare render times with and without boundary tracing (opt-in)
+  mirror      Compare render times with and without symmetry
+  powers      Compare iteration times of the power fractals with and without pow
+  formula     Compare iteration times of the formula interpreter and the Mandelbrot set
+  allocs      Count allocations made while iterating in high precision
+  dirty       Check the regions presented while rendering cover the written pixels
+
+Common options:
+  --settings <path>    Settings file (default: settings/settings.json)
+  --threads <n>        Number of render threads
+  --width <px>         Override the image width
+  --height <px>        Override the image height
+  --pin-threads        Pin render threads and give each NUMA node its own band
+  --numa-nodes <n>     Split the usable CPUs into n simulated NUMA nodes
+  --de-fill            Fill blocks proven to be inside (or far outside) the set
+  --trace              Trace and fill regions of one colour (may miss small islands)
+
+stream / distribute options:
+  --output <path>      Output file (.ppm for PPM, anything else for raw RGB8)
+  --resume             Continue a partially written output file
+  --band-mb <n>        (stream) Memory budget for a single band in MiB [256]
+  --workers <n>        (distribute) Number of worker processes [2]
+  --worker-threads <n> (distribute) Render threads per worker [cores / workers]
+  --job-rows <n>       (distribute) Image rows per job [64]
+
+serve / loadtest options:
+  --port <n>           TCP port on 127.0.0.1 [8080]
+  --tile-size <px>     (serve) Width and height of each tile [256]
+  --cache-tiles <n>    (serve) Number of rendered tiles to keep in memory [1024]
+  --clients <n>        (loadtest) Number of concurrent clients [16]
+  --duration <s>       (loadtest) Length of the test in seconds [10]
+  --max-zoom <n>       (loadtest) Deepest zoom level to request [8]
+
+animate / expmap options (the start view is taken from --settings):
+  --end-settings <path>     Settings file holding the final view
+  --zoom <factor>           Zoom into the center of the start view instead
+  --frames <n>              Total number of frames
+  --frames-per-octave <n>   Frames per doubling of the zoom, instead of --frames [60]
+  --fps <n>                 Frame rate written to the Y4M header [30]
+  --format <y4m|ppm>        Output format [y4m]
+  --no-reuse                (animate) Iterate every sample of every frame
+  --interpolate             (animate) Interpolate between reused samples (approximate)
+  --save-strip <path>       (expmap) Also save the log-polar strip as an image
+
+  e.g. FractalRendererHeadless animate --zoom 1e6 | ffmpeg -i - zoom.mp4
+
+batch options (--threads sets the size of the shared pool):
+  --jobs <path>        JSON array of {"settings": <path>, "output": <path>} objects
+  --max-in-flight <n>  Maximum number of jobs loaded at once [4]
+
+placement options (run under taskset or a cpuset to restrict the CPUs used):
+  --runs <n>           Number of renders of each kind, keeping the fastest [3]
+
+defill / trace / mirror / powers / formula options:
+  --runs <n>           Number of renders of each kind, keeping the fastest [3]
+  --distance-coloring  (defill) Colour by distance estimation, so far exterior blocks
+                       fill too
+
+allocs options:
+  --precision <bits>   Precision to iterate at (at least 65) [128]
+)");
+	}
+
+	int runStream(const Arguments &args) {
+		std::string output = args.get("output");
+		if (output.empty()) {
+			FRAC_ERROR("No output path specified");
+			printUsage();
+			return 1;
+		}
+
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		const int64_t bandBudget = args.getInt("band-mb", 256) * 1024 * 1024;
+		ImageStreamWriter writer(output,
+								 renderer.config().imageSize,
+								 ImageStreamWriter::formatFromPath(output),
+								 args.has("resume"));
+		if (!writer.isOpen()) return 1;
+
+		StreamRenderer streamRenderer(renderer, bandBudget);
+		return streamRenderer.render(writer) ? 0 : 1;
+	}
+
+	int runDistributed(const Arguments &args) {
+		std::string output = args.get("output");
+		if (output.empty()) {
+			FRAC_ERROR("No output path specified");
+			printUsage();
+			return 1;
+		}
+
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		// Workers are started by re-running this executable in worker mode
+		std::error_code ec;
+		std::string executable =
+		  std::filesystem::read_symlink("/proc/self/exe", ec).string();
+		if (ec || executable.empty()) executable = args.program();
+
+		const int64_t cores			   = (int64_t)std::thread::hardware_concurrency();
+		const int64_t workers		   = lrc::max(int64_t(1), args.getInt("workers", 2));
+		const int64_t threadsPerWorker = args.getInt("worker-threads", cores / workers);
+
+		ImageStreamWriter writer(output,
+								 renderer.config().imageSize,
+								 ImageStreamWriter::formatFromPath(output),
+								 args.has("resume"));
+		if (!writer.isOpen()) return 1;
+
+		DistributedRenderer distributed(
+		  renderer, executable, workers, threadsPerWorker, args.getInt("job-rows", 64));
+		return distributed.render(writer) ? 0 : 1;
+	}
+
+	int runServe(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		TileServer server(renderer,
+						  args.getInt("port", 8080),
+						  args.getInt("tile-size", 256),
+						  args.getInt("cache-tiles", 1024));
+		return server.run();
+	}
+
+	bool animationPath(const Arguments &args, FractalRenderer &renderer,
+					   AnimationRenderer::View &start, AnimationRenderer::View &end,
+					   int64_t &frames) {
+		const RenderConfig &config = renderer.config();
+		const HighVec2 two(2, 2);
+
+		start = {config.fracTopLeft + config.fracSize / two, config.fracSize.y()};
+		end	  = start;
+
+		if (args.has("end-settings")) {
+			json endSettings;
+			if (!loadSettings(args.get("end-settings"), endSettings)) return false;
+
+			FractalRenderer endRenderer;
+			endRenderer.setConfig(endSettings);
+			const RenderConfig &endConfig = endRenderer.config();
+			end.center = endConfig.fracTopLeft + endConfig.fracSize / two;
+			end.height = endConfig.fracSize.y();
+
+			// Make sure the deepest frame has enough precision
+			if (endConfig.precision > config.precision) {
+				renderer.config().precision = endConfig.precision;
+				lrc::prec2(endConfig.precision);
+				renderer.updateConfigPrecision();
+				renderer.updateRenderConfig();
+			}
+		} else {
+			std::string zoom = args.get("zoom", "1000");
+			HighPrecision factor;
+			scn::scan(zoom, "{}", factor);
+			end.height = start.height / factor;
+		}
+
+		// With a fixed number of frames per octave, the end view is moved slightly (by
+		// less than half a frame) so the rate is exact, which keeps sample grids one
+		// octave apart aligned
+		frames = args.getInt("frames", 0);
+		if (frames <= 0) {
+			const double rate =
+			  (double)lrc::max(int64_t(1), args.getInt("frames-per-octave", 60));
+			const double octaves =
+			  AnimationRenderer::octavesBetween(start.height, end.height);
+			const double sign = octaves < 0 ? -1.0 : 1.0;
+
+			frames	   = std::llround(std::abs(octaves) * rate) + 1;
+			end.height = AnimationRenderer::zoomHeight(
+			  start.height, sign * (double)(frames - 1) / rate);
+		}
+
+		return true;
+	}
+
+	bool animationFormat(const Arguments &args, AnimationRenderer::Format &format) {
+		const std::string name = args.get("format", "y4m");
+		if (name == "y4m") {
+			format = AnimationRenderer::Format::Y4M;
+		} else if (name == "ppm") {
+			format = AnimationRenderer::Format::PPM;
+		} else {
+			FRAC_ERROR(fmt::format("Unknown animation format: {}", name));
+			printUsage();
+			return false;
+		}
+
+#if defined(_WIN32)
+		// Frames are written to stdout, which must not translate line endings
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+		return true;
+	}
+
+	int runAnimate(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		AnimationRenderer::View start;
+		AnimationRenderer::View end;
+		int64_t frames;
+		AnimationRenderer::Format format;
+		if (!animationPath(args, renderer, start, end, frames)) return 1;
+		if (!animationFormat(args, format)) return 1;
+
+		AnimationRenderer animation(renderer, start, end, frames);
+		animation.setSampleReuse(!args.has("no-reuse"));
+		animation.setInterpolatedReuse(args.has("interpolate"));
+		return animation.render(stdout, format, args.getInt("fps", 30)) ? 0 : 1;
+	}
+
+	int runExpMap(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		AnimationRenderer::View start;
+		AnimationRenderer::View end;
+		int64_t frames;
+		AnimationRenderer::Format format;
+		if (!animationPath(args, renderer, start, end, frames)) return 1;
+		if (!animationFormat(args, format)) return 1;
+
+		// The exponential map can only zoom about a single point, so the whole
+		// sequence is centred on the target
+		ExpMapRenderer expMap(renderer, end.center, start.height, end.height);
+		expMap.renderStrip();
+
+		std::string stripPath = args.get("save-strip");
+		if (!stripPath.empty() && !expMap.saveStrip(stripPath)) {
+			FRAC_ERROR(fmt::format("Failed to save strip to {}", stripPath));
+			return 1;
+		}
+
+		return expMap.render(stdout, format, frames, args.getInt("fps", 30)) ? 0 : 1;
+	}
+
+	int runBatch(const Arguments &args) {
+		std::string jobFile = args.get("jobs");
+		if (jobFile.empty()) {
+			FRAC_ERROR("No job file specified");
+			printUsage();
+			return 1;
+		}
+
+		std::vector<BatchJob> jobs;
+		if (!BatchRunner::loadJobFile(jobFile, jobs)) return 1;
+
+		BatchRunner runner(args.getInt("threads", std::thread::hardware_concurrency()),
+						   args.getInt("max-in-flight", 4));
+		return runner.run(jobs) ? 0 : 1;
+	}
+
+	int runPlacement(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		const std::vector<topology::NumaNode> nodes = threadPlacement(args);
+		const RenderConfig &config					= renderer.config();
+		const int64_t runs = lrc::max(int64_t(1), args.getInt("runs", 3));
+
+		fmt::print("Topology: {}\n", topology::describe(nodes));
+		fmt::print("Rendering {}x{} on {} threads, fastest of {} runs\n",
+				   config.imageSize.x(),
+				   config.imageSize.y(),
+				   config.numThreads,
+				   runs);
+
+		// Alternate between the two, so both see the same clock speeds and caches
+		double fastest[2] = {std::numeric_limits<double>::max(),
+							 std::numeric_limits<double>::max()};
+		for (int64_t i = 0; i < runs; ++i) {
+			for (int64_t pinned = 0; pinned < 2; ++pinned) {
+				renderer.setThreadPlacement(pinned ? nodes
+												   : std::vector<topology::NumaNode>());
+
+				// Allocate a new surface every time, so page placement is measured too
+				renderer.regenerateSurface();
+
+				const double start = lrc::now();
+				renderer.renderFractal();
+				renderer.waitForRender();
+				fastest[pinned] = lrc::min(fastest[pinned], lrc::now() - start);
+			}
+		}
+
+		fmt::print("Floating: {}\n", lrc::formatTime(fastest[0]));
+		fmt::print("Pinned:   {}\n", lrc::formatTime(fastest[1]));
+		fmt::print("Speedup:  {:.3f}x\n", fastest[0] / fastest[1]);
+		return 0;
+	}
+
+	int runDistanceFill(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		const std::vector<std::string> funcs = renderer.getColorFuncs();
+		if (std::find(funcs.begin(), funcs.end(), coloring::distanceEstimation) ==
+			funcs.end()) {
+			FRAC_ERROR(fmt::format("{} does not support distance estimation",
+								   renderer.getFractalName()));
+			return 1;
+		}
+		if (args.has("distance-coloring"))
+			renderer.setColorFunc(coloring::distanceEstimation);
+
+		compareOptimisation(renderer,
+							lrc::max(int64_t(1), args.getInt("runs", 3)),
+							[&](bool fill) { renderer.setDistanceFill(fill); });
+		return 0;
+	}
+
+	int runBoundaryTrace(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		// Tracing is an opt-in approximation. Any changed pixel is reported as a
+		// failure, so it is clear whether it is exact for these settings
+		const int64_t changed = compareOptimisation(
+		  renderer,
+		  lrc::max(int64_t(1), args.getInt("runs", 3)),
+		  [&](bool trace) { renderer.setBoundaryTracing(trace); });
+		return changed == 0 ? 0 : 1;
+	}
+
+	int runSymmetry(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		// With anti-aliasing, reflected pixels are usually coloured from their samples
+		renderer.setKeepIterationData(true);
+
+		compareOptimisation(renderer,
+							lrc::max(int64_t(1), args.getInt("runs", 3)),
+							[&](bool mirror) { renderer.setSymmetry(mirror); });
+		return 0;
+	}
+
+	int runPowers(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		const RenderConfig &config = renderer.config();
+		const json &fractals	   = settings["renderConfig"]["fractals"];
+		const int64_t runs		   = lrc::max(int64_t(1), args.getInt("runs", 3));
+
+		fmt::print("Iterating {}x{} coordinates on one thread, fastest of {} runs\n",
+				   config.imageSize.x(),
+				   config.imageSize.y(),
+				   runs);
+
+		comparePower<Multibrot3>(
+		  config, fractals.value("Multibrot 3", json::object()), runs);
+		comparePower<Multibrot4>(
+		  config, fractals.value("Multibrot 4", json::object()), runs);
+		comparePower<Multibrot5>(
+		  config, fractals.value("Multibrot 5", json::object()), runs);
+		comparePower<BurningShip>(
+		  config, fractals.value("Burning Ship", json::object()), runs);
+		comparePower<BurningShip3>(
+		  config, fractals.value("Burning Ship 3", json::object()), runs);
+		return 0;
+	}
+
+	template<typename PowerFractalType>
+	void comparePower(const RenderConfig &config, const json &settings, int64_t runs) {
+		RenderConfig fractalConfig = config;
+		fractalConfig.bail		   = settings.value("bail", config.bail);
+		const PowerFractalType fractal(fractalConfig);
+		const std::vector<lrc::Complex<LowPrecision>> coords =
+		  defaultViewCoords(config, settings);
+
+		// Naive, unrolled and batched results
+		std::vector<std::pair<int64_t, lrc::Complex<LowPrecision>>> results[3];
+		for (auto &result : results) result.resize(coords.size());
+
+		// Alternate between the three, so all see the same clock speeds and caches
+		double fastest[3] = {std::numeric_limits<double>::max(),
+							 std::numeric_limits<double>::max(),
+							 std::numeric_limits<double>::max()};
+		for (int64_t i = 0; i < runs; ++i) {
+			double start = lrc::now();
+			for (size_t c = 0; c < coords.size(); ++c)
+				results[0][c] = fractal.iterCoordNaive(coords[c]);
+			fastest[0] = lrc::min(fastest[0], lrc::now() - start);
+
+			start = lrc::now();
+			for (size_t c = 0; c < coords.size(); ++c)
+				results[1][c] = fractal.iterCoordLow(coords[c]);
+			fastest[1] = lrc::min(fastest[1], lrc::now() - start);
+
+			start = lrc::now();
+			fractal.iterCoordsLow(coords.data(), coords.size(), results[2].data());
+			fastest[2] = lrc::min(fastest[2], lrc::now() - start);
+		}
+
+		// lrc::pow rounds differently, so a few points near the boundary may escape
+		// on a different iteration. The unrolled and batched results must agree
+		int64_t changed[2] = {0, 0};
+		for (size_t c = 0; c < coords.size(); ++c) {
+			if (results[0][c].first != results[1][c].first) ++changed[0];
+			if (results[1][c].first != results[2][c].first) ++changed[1];
+		}
+
+		fmt::print("{}:\n", fractal.name());
+		fmt::print("  lrc::pow: {}\n", lrc::formatTime(fastest[0]));
+		fmt::print("  Unrolled: {} ({:.3f}x, {} iteration counts differ from pow)\n",
+				   lrc::formatTime(fastest[1]),
+				   fastest[0] / fastest[1],
+				   changed[0]);
+		fmt::print("  Batched:  {} ({:.3f}x, {} iteration counts differ from unrolled)\n",
+				   lrc::formatTime(fastest[2]),
+				   fastest[0] / fastest[2],
+				   changed[1]);
+	}
+
+	int runFormula(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		const RenderConfig &config = renderer.config();
+		const json &fractals	   = settings["renderConfig"]["fractals"];
+		const json formulaSettings = fractals.value("Formula", json::object());
+		const int64_t runs		   = lrc::max(int64_t(1), args.getInt("runs", 3));
+
+		// A new FormulaFractal iterates z^2 + c from 0, so with the same bailout the
+		// iteration counts should only differ where the two round differently
+		RenderConfig fractalConfig = config;
+		fractalConfig.bail		   = formulaSettings.value("bail", config.bail);
+		const Mandelbrot mandelbrot(fractalConfig);
+		const FormulaFractal formula(fractalConfig);
+
+		const std::vector<lrc::Complex<LowPrecision>> coords =
+		  defaultViewCoords(config, formulaSettings);
+
+		fmt::print("Iterating {}x{} coordinates on one thread, fastest of {} runs\n",
+				   config.imageSize.x(),
+				   config.imageSize.y(),
+				   runs);
+
+		// Mandelbrot, single formula and batched formula results
+		std::vector<std::pair<int64_t, lrc::Complex<LowPrecision>>> results[3];
+		for (auto &result : results) result.resize(coords.size());
+
+		// Alternate between the three, so all see the same clock speeds and caches
+		double fastest[3] = {std::numeric_limits<double>::max(),
+							 std::numeric_limits<double>::max(),
+							 std::numeric_limits<double>::max()};
+		for (int64_t i = 0; i < runs; ++i) {
+			double start = lrc::now();
+			for (size_t c = 0; c < coords.size(); ++c)
+				results[0][c] = mandelbrot.iterCoordLow(coords[c]);
+			fastest[0] = lrc::min(fastest[0], lrc::now() - start);
+
+			start = lrc::now();
+			for (size_t c = 0; c < coords.size(); ++c)
+				results[1][c] = formula.iterCoordLow(coords[c]);
+			fastest[1] = lrc::min(fastest[1], lrc::now() - start);
+
+			start = lrc::now();
+			formula.iterCoordsLow(coords.data(), coords.size(), results[2].data());
+			fastest[2] = lrc::min(fastest[2], lrc::now() - start);
+		}
+
+		int64_t changed[2] = {0, 0};
+		for (size_t c = 0; c < coords.size(); ++c) {
+			if (results[0][c].first != results[1][c].first) ++changed[0];
+			if (results[0][c].first != results[2][c].first) ++changed[1];
+		}
+
+		fmt::print("Mandelbrot: {}\n", lrc::formatTime(fastest[0]));
+		fmt::print("Formula:    {} ({:.3f}x slower, {} iteration counts differ)\n",
+				   lrc::formatTime(fastest[1]),
+				   fastest[1] / fastest[0],
+				   changed[0]);
+		fmt::print("Batched:    {} ({:.3f}x slower, {} iteration counts differ)\n",
+				   lrc::formatTime(fastest[2]),
+				   fastest[2] / fastest[0],
+				   changed[1]);
+
+		// The renderer picks its own path for each fractal, so whole renders of the
+		// same view are timed too, with the same bailout and colouring. Symmetry is
+		// off, since only the Mandelbrot set could use it
+		LowVec2 topLeft;
+		LowVec2 size;
+		defaultView(config, formulaSettings, topLeft, size);
+		renderer.setSymmetry(false);
+		renderer.config().bail = fractalConfig.bail;
+
+		auto timeRender = [&](const std::string &name) {
+			renderer.updateFractalType(name, fractals.value(name, json::object()));
+			renderer.setColorFunc(coloring::histogramPreview);
+			renderer.moveFractalCorner(HighVec2(topLeft.x(), topLeft.y()),
+									   HighVec2(size.x(), size.y()));
+
+			double best = std::numeric_limits<double>::max();
+			for (int64_t i = 0; i < runs; ++i) {
+				const double start = lrc::now();
+				renderer.renderFractal();
+				renderer.waitForRender();
+				best = lrc::min(best, lrc::now() - start);
+			}
+			return best;
+		};
+
+		const double mandelbrotRender = timeRender("Mandelbrot");
+		const double formulaRender	  = timeRender("Formula");
+		const double renderRatio	  = formulaRender / mandelbrotRender;
+		fmt::print("Rendered on {} threads:\n", config.numThreads);
+		fmt::print("Mandelbrot: {}\n", lrc::formatTime(mandelbrotRender));
+		fmt::print("Formula:    {} ({:.3f}x slower)\n",
+				   lrc::formatTime(formulaRender),
+				   renderRatio);
+		return renderRatio <= 3 ? 0 : 1;
+	}
+
+	void defaultView(const RenderConfig &config, const json &settings, LowVec2 &topLeft,
+					 LowVec2 &size) {
+		topLeft = config.fracTopLeft;
+		size	= config.fracSize;
+		if (settings.contains("fracTopLeft") && settings.contains("fracSize")) {
+			topLeft = LowVec2(settings["fracTopLeft"]["Re"].get<double>(),
+							  settings["fracTopLeft"]["Im"].get<double>());
+			size	= LowVec2(settings["fracSize"]["Re"].get<double>(),
+							  settings["fracSize"]["Im"].get<double>());
+		}
+	}
+
+	std::vector<lrc::Complex<LowPrecision>>
+	defaultViewCoords(const RenderConfig &config, const json &settings) {
+		LowVec2 topLeft;
+		LowVec2 size;
+		defaultView(config, settings, topLeft, size);
+
+		const int64_t width	 = config.imageSize.x();
+		const int64_t height = config.imageSize.y();
+		std::vector<lrc::Complex<LowPrecision>> coords;
+		coords.reserve(width * height);
+		for (int64_t y = 0; y < height; ++y) {
+			for (int64_t x = 0; x < width; ++x) {
+				coords.emplace_back(topLeft.x() + size.x() * (double)x / (double)width,
+									topLeft.y() + size.y() * (double)y / (double)height);
+			}
+		}
+
+		return coords;
+	}
+
+	int runAllocations(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+
+		// Anything up to 64 bits is iterated in double precision
+		RenderConfig &config = renderer.config();
+		config.precision	 = lrc::max(int64_t(65), args.getInt("precision", 128));
+		lrc::prec2(config.precision);
+		renderer.updateConfigPrecision();
+		renderer.updateRenderConfig();
+
+		const std::string name = renderer.getFractalName();
+		const json &fractals   = settings["renderConfig"]["fractals"];
+		std::shared_ptr<Fractal> fractal =
+		  createFractal(name, config, fractals.value(name, json::object()));
+
+		// Coordinates along the middle row of the view
+		const int64_t width = config.imageSize.x();
+		const HighPrecision im =
+		  config.fracTopLeft.y() + config.fracSize.y() / static_cast<HighPrecision>(2);
+		std::vector<lrc::Complex<HighPrecision>> coords;
+		for (int64_t x = 0; x < width; ++x) {
+			const HighPrecision re = config.fracTopLeft.x() +
+									 config.fracSize.x() * static_cast<HighPrecision>(x) /
+									   static_cast<HighPrecision>(width);
+			coords.emplace_back(re, im);
+		}
+
+		RenderConfig iterConfig = config;
+
+		// The row is iterated with two iteration limits. Allocations made once per
+		// coordinate are the same for both, so any difference is made per iteration
+		auto iterateRow = [&](int64_t maxIters, int64_t &iterations) -> int64_t {
+			iterConfig.maxIters = maxIters;
+			fractal->updateRenderConfig(iterConfig);
+
+			iterations			 = 0;
+			const int64_t before = multiprecisionAllocations;
+			for (const auto &coord : coords)
+				iterations += fractal->iterCoordHigh(coord).first;
+			return multiprecisionAllocations - before;
+		};
+
+		// The counting functions allocate with the default ones, so memory allocated
+		// before they are installed can still be freed while they are
+		mp_get_memory_functions(&defaultAlloc, &defaultRealloc, &defaultFree);
+		mp_set_memory_functions(countingAlloc, countingRealloc, defaultFree);
+
+		// Allocate the thread's scratch variables before counting
+		int64_t iterations[2];
+		iterateRow(config.maxIters, iterations[0]);
+
+		const int64_t allocations[2] = {iterateRow(config.maxIters, iterations[0]),
+										iterateRow(config.maxIters * 2, iterations[1])};
+		mp_set_memory_functions(defaultAlloc, defaultRealloc, defaultFree);
+
+		const int64_t innerLoop = allocations[1] - allocations[0];
+		fmt::print("Iterating {} coordinates of the {} at {} bits\n",
+				   coords.size(),
+				   name,
+				   config.precision);
+		for (int64_t i = 0; i < 2; ++i) {
+			fmt::print(
+			  "{} iterations: {} allocations\n", iterations[i], allocations[i]);
+		}
+		fmt::print("Inner loop: {} allocations over {} iterations\n",
+				   innerLoop,
+				   iterations[1] - iterations[0]);
+		return innerLoop == 0 ? 0 : 1;
+	}
+
+	int runDirtyRegions(const Arguments &args) {
+		json settings;
+		if (!loadSettings(args.get("settings", FRACTAL_UI_SETTINGS_PATH), settings))
+			return 1;
+
+		FractalRenderer renderer;
+		if (!configureRenderer(renderer, settings)) return 1;
+		applyOverrides(renderer, args);
+		renderer.regenerateSurface();
+
+		// Rendered pixels are opaque, so any pixel still zero afterwards was not written.
+		// The first present allocates the front buffer, and is not counted
+		const RenderConfig &config = renderer.config();
+		const int64_t width		   = config.imageSize.x();
+		const int64_t height	   = config.imageSize.y();
+		ci::Surface &back		   = renderer.surface();
+		std::memset(back.getData(), 0, back.getRowBytes() * height);
+		std::vector<SurfaceRegion> regions;
+		renderer.presentSurface(regions);
+
+		std::vector<int32_t> coverage(width * height, 0);
+		int64_t presents = 0, numRegions = 0, outside = 0;
+		auto present = [&]() {
+			if (!renderer.presentSurface(regions)) return;
+			++presents;
+			for (const SurfaceRegion &region : regions) {
+				++numRegions;
+				const lrc::Vec2i end = region.topLeft + region.dimensions;
+				if (region.topLeft.x() < 0 || region.topLeft.y() < 0 || end.x() > width ||
+					end.y() > height) {
+					++outside;
+					continue;
+				}
+
+				for (int64_t y = region.topLeft.y(); y < end.y(); ++y) {
+					for (int64_t x = region.topLeft.x(); x < end.x(); ++x)
+						++coverage[y * width + x];
+				}
+			}
+		};
+
+		// Present while the render runs, as the window does each frame
+		RenderHandle handle = renderer.renderFractal();
+		while (!handle.finished()) {
+			present();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		renderer.waitForRender();
+		present();
+
+		// Pixels covered twice are expected in histogram mode, where the colouring pass
+		// rewrites every row, so they are only reported
+		const ci::Surface &front = renderer.frontSurface();
+		const uint8_t pixelInc	 = back.getPixelInc();
+		int64_t written = 0, missed = 0, extra = 0, overlapped = 0, mismatched = 0;
+		for (int64_t y = 0; y < height; ++y) {
+			const uint8_t *backRow	= back.getData(ci::ivec2(0, y));
+			const uint8_t *frontRow = front.getData(ci::ivec2(0, y));
+			for (int64_t x = 0; x < width; ++x) {
+				const uint8_t *pixel = backRow + x * pixelInc;
+				const bool wrote	 = std::any_of(
+				  pixel, pixel + pixelInc, [](uint8_t value) { return value != 0; });
+				const int32_t covered = coverage[y * width + x];
+
+				if (wrote) ++written;
+				if (wrote && covered == 0) ++missed;
+				if (!wrote && covered > 0) ++extra;
+				if (covered > 1) ++overlapped;
+				if (!std::equal(pixel, pixel + pixelInc, frontRow + x * pixelInc))
+					++mismatched;
+			}
+		}
+
+		fmt::print("Rendered {}x{}: {} regions over {} presents\n",
+				   width,
+				   height,
+				   numRegions,
+				   presents);
+		fmt::print("Written:    {} pixels\n", written);
+		fmt::print("Missed:     {} written pixels never presented\n", missed);
+		fmt::print("Extra:      {} unwritten pixels presented\n", extra);
+		fmt::print("Overlapped: {} pixels presented more than once\n", overlapped);
+		fmt::print("Outside:    {} regions outside the image\n", outside);
+		fmt::print("Mismatched: {} pixels differ between the buffers\n", mismatched);
+		return (missed == 0 && extra == 0 && outside == 0 && mismatched == 0) ? 0 : 1;
+	}
+
+	int64_t compareOptimisation(FractalRenderer &renderer, int64_t runs,
+								const std::function<void(bool)> &enable) {
+		const RenderConfig &config = renderer.config();
+
+		fmt::print("Rendering {}x{} on {} threads, fastest of {} runs\n",
+				   config.imageSize.x(),
+				   config.imageSize.y(),
+				   config.numThreads,
+				   runs);
+
+		// Alternate between the two, so both see the same clock speeds and caches
+		double fastest[2] = {std::numeric_limits<double>::max(),
+							 std::numeric_limits<double>::max()};
+		std::vector<uint8_t> pixels[2];
+		int64_t computed[2] = {0, 0};
+		for (int64_t i = 0; i < runs; ++i) {
+			for (int64_t optimised = 0; optimised < 2; ++optimised) {
+				enable(optimised);
+
+				const double start = lrc::now();
+				renderer.renderFractal();
+				renderer.waitForRender();
+				fastest[optimised]	= lrc::min(fastest[optimised], lrc::now() - start);
+				computed[optimised] = renderer.pixelsComputed();
+
+				ImageStreamWriter::packRows(
+				  renderer.surface(), config.imageSize.y(), pixels[optimised]);
+			}
+		}
+
+		// The optimisations are exact up to the features they can resolve, so very few
+		// pixels should change
+		int64_t changed = 0;
+		for (size_t i = 0; i < pixels[0].size(); i += 3) {
+			if (!std::equal(&pixels[0][i], &pixels[0][i] + 3, &pixels[1][i])) ++changed;
+		}
+
+		const auto total = (int64_t)(pixels[0].size() / 3);
+		fmt::print("Plain:     {} ({} pixels computed)\n",
+				   lrc::formatTime(fastest[0]),
+				   computed[0]);
+		fmt::print("Optimised: {} ({} pixels computed)\n",
+				   lrc::formatTime(fastest[1]),
+				   computed[1]);
+		fmt::print("Speedup:   {:.3f}x\n", fastest[0] / fastest[1]);
+		fmt::print("Changed:   {} of {} pixels\n", changed, total);
+		return changed;
+	}
+
+	int run(int argc, char **argv) {
+		Arguments args(argc, argv);
+
+		if (args.mode() == "stream") return runStream(args);
+		if (args.mode() == "distribute") return runDistributed(args);
+		if (args.mode() == "worker") return DistributedRenderer::runWorker();
+		if (args.mode() == "serve") return runServe(args);
+		if (args.mode() == "animate") return runAnimate(args);
+		if (args.mode() == "expmap") return runExpMap(args);
+		if (args.mode() == "batch") return runBatch(args);
+		if (args.mode() == "placement") return runPlacement(args);
+		if (args.mode() == "defill") return runDistanceFill(args);
+		if (args.mode() == "trace") return runBoundaryTrace(args);
+		if (args.mode() == "mirror") return runSymmetry(args);
+		if (args.mode() == "powers") return runPowers(args);
+		if (args.mode() == "formula") return runFormula(args);
+		if (args.mode() == "allocs") return runAllocations(args);
+		if (args.mode() == "dirty") return runDirtyRegions(args);
+		if (args.mode() == "loadtest") {
+			const int64_t clients = lrc::max(int64_t(1), args.getInt("clients", 16));
+			return TileServer::runLoadTest(args.getInt("port", 8080),
+										   clients,
+										   (double)args.getInt("duration", 10),
+										   args.getInt("max-zoom", 8));
+		}
+
+		printUsage();
+		return args.has("help") ? 0 : 1;
+	}
+} // namespace frac::headless
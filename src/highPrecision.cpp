@@ -0,0 +1,57 @@
+#include <fractal/fractal.hpp>
+
+namespace frac::highPrecision {
+	Scratch::Scratch(int64_t precision) :
+			precision(precision),
+			re(0, precision),
+			im(0, precision),
+			cRe(0, precision),
+			cIm(0, precision),
+			bailout(0, precision),
+			reSq(0, precision),
+			imSq(0, precision),
+			normSq(0, precision),
+			sumSq(0, precision) {}
+
+	Scratch &threadScratch(int64_t precision) {
+		thread_local Scratch scratch(precision);
+
+		// Assigning to a variable keeps its precision, so they must be replaced
+		if (scratch.precision != precision) scratch = Scratch(precision);
+		return scratch;
+	}
+
+	int64_t iterateQuadratic(Scratch &scratch, int64_t maxIters) {
+		int64_t iteration = 0;
+
+		// Only assignments and compound operators are used, which write into the
+		// existing variables
+		while (true) {
+			scratch.reSq = scratch.re;
+			scratch.reSq *= scratch.re;
+			scratch.imSq = scratch.im;
+			scratch.imSq *= scratch.im;
+			scratch.normSq = scratch.reSq;
+			scratch.normSq += scratch.imSq;
+			if (scratch.normSq > scratch.bailout || iteration >= maxIters) break;
+
+			// im = (re + im)^2 - (re^2 + im^2) + cIm. The rounding error is no larger
+			// than that of re^2 - im^2
+			scratch.sumSq = scratch.re;
+			scratch.sumSq += scratch.im;
+			scratch.sumSq *= scratch.sumSq;
+			scratch.im = scratch.sumSq;
+			scratch.im -= scratch.normSq;
+			scratch.im += scratch.cIm;
+
+			// re = re^2 - im^2 + cRe
+			scratch.re = scratch.reSq;
+			scratch.re -= scratch.imSq;
+			scratch.re += scratch.cRe;
+
+			++iteration;
+		}
+
+		return iteration;
+	}
+} // namespace frac::highPrecision
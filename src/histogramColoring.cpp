@@ -0,0 +1,88 @@
+#include <fractal/fractal.hpp>
+
+namespace frac::coloring {
+	namespace {
+		// Samples coloured per pass of the vectorisable loop in histogramColorBatch
+		constexpr int64_t batchSize = 256;
+	} // namespace
+
+	void IterationHistogram::reset(int64_t maxIters) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_maxIters = lrc::max(int64_t(1), maxIters);
+		m_threadCounts.clear();
+		m_cdf.clear();
+	}
+
+	void IterationHistogram::add(const IterationSample *samples, int64_t count) {
+		// Nodes in a std::map never move, so the histogram can be filled without
+		// holding the lock
+		std::vector<int64_t> *counts;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			counts = &m_threadCounts[std::this_thread::get_id()];
+			if (counts->empty()) counts->resize(m_maxIters, 0);
+		}
+
+		for (int64_t i = 0; i < count; ++i) {
+			const int64_t iters = samples[i].iters;
+			if (iters >= 0 && iters < m_maxIters) ++(*counts)[iters];
+		}
+	}
+
+	void IterationHistogram::finalise() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::vector<int64_t> merged(m_maxIters, 0);
+		for (const auto &[thread, counts] : m_threadCounts) {
+			for (size_t i = 0; i < counts.size(); ++i) merged[i] += counts[i];
+		}
+
+		// m_cdf[i] is the number of escaped samples that took fewer than i iterations
+		m_cdf.assign(m_maxIters + 1, 0.0f);
+		int64_t total = 0;
+		for (int64_t i = 0; i < m_maxIters; ++i) {
+			total += merged[i];
+			m_cdf[i + 1] = (float)total;
+		}
+
+		if (total == 0) return;
+		for (auto &value : m_cdf) value /= (float)total;
+	}
+
+	float IterationHistogram::equalise(float smoothIters) const {
+		if (m_cdf.empty()) return 0;
+
+		const float clamped = std::clamp(smoothIters, 0.0f, (float)m_maxIters);
+		const auto index	= lrc::min((int64_t)clamped, m_maxIters - 1);
+		const float frac	= clamped - (float)index;
+		return m_cdf[index] + (m_cdf[index + 1] - m_cdf[index]) * frac;
+	}
+
+	void histogramColorBatch(const IterationSample *samples, int64_t count,
+							 int64_t maxIters, const IterationHistogram &histogram,
+							 const ColorPalette &palette, ci::ColorA *out) {
+		// Spread the distribution over one cycle of the palette, without wrapping back
+		// round to the first colour at the end
+		const float paletteScale =
+		  palette.size() > 1 ? (float)(palette.size() - 1) : 1.0f;
+		float smooth[batchSize];
+
+		for (int64_t start = 0; start < count; start += batchSize) {
+			const int64_t end = lrc::min(start + batchSize, count);
+
+			for (int64_t i = start; i < end; ++i)
+				smooth[i - start] = smoothIterations(samples[i]);
+
+			for (int64_t i = start; i < end; ++i) {
+				if (samples[i].iters >= maxIters) {
+					out[i] = {0, 0, 0, 1};
+					continue;
+				}
+
+				const float equalised = histogram.equalise(smooth[i - start]);
+				const auto &color	  = palette.lookup(equalised * paletteScale);
+				out[i]				  = {color.x(), color.y(), color.z(), 1};
+			}
+		}
+	}
+} // namespace frac::coloring
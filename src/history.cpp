@@ -1,107 +1,499 @@
 #include <fractal/fractal.hpp>
 
 namespace frac {
-	void HistoryNode::append(HistoryNode *list) {
-		if (m_next) {
-			m_next->append(list);
-		} else {
-			m_next		   = list;
-			m_next->m_prev = this;
+	namespace {
+		// Longest runs of literal and repeated pixels a header byte can describe
+		constexpr size_t maxLiteral = 128;
+		constexpr size_t maxRepeat	= 129;
+
+		/// Run-length encode the pixels of a surface as RGBA. Each run starts with a
+		/// header byte. Below 128, it is followed by header + 1 literal pixels,
+		/// otherwise by a single pixel repeated header - 126 times. Large parts of most
+		/// renders are a single colour, so this is usually far smaller than the surface
+		/// \param surface The surface to encode
+		/// \return Encoded pixels
+		std::vector<uint8_t> encodeSurface(const ci::Surface &surface) {
+			const int64_t width		  = surface.getWidth();
+			const int64_t height	  = surface.getHeight();
+			const uint8_t pixelInc	  = surface.getPixelInc();
+			const uint8_t redOffset	  = surface.getRedOffset();
+			const uint8_t greenOffset = surface.getGreenOffset();
+			const uint8_t blueOffset  = surface.getBlueOffset();
+			const uint8_t alphaOffset = surface.getAlphaOffset();
+			const bool hasAlpha		  = surface.hasAlpha();
+
+			std::vector<uint32_t> pixels(width * height);
+			for (int64_t y = 0; y < height; ++y) {
+				const uint8_t *src = surface.getData(ci::ivec2(0, (int32_t)y));
+				for (int64_t x = 0; x < width; ++x) {
+					const uint32_t alpha  = hasAlpha ? src[alphaOffset] : 255;
+					pixels[y * width + x] = (uint32_t)src[redOffset] |
+											((uint32_t)src[greenOffset] << 8) |
+											((uint32_t)src[blueOffset] << 16) |
+											(alpha << 24);
+					src += pixelInc;
+				}
+			}
+
+			std::vector<uint8_t> out;
+			const auto putPixel = [&out](uint32_t pixel) {
+				for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(pixel >> (i * 8)));
+			};
+
+			const size_t numPixels = pixels.size();
+			size_t i			   = 0;
+			while (i < numPixels) {
+				size_t run = 1;
+				while (i + run < numPixels && run < maxRepeat &&
+					   pixels[i + run] == pixels[i])
+					++run;
+
+				if (run > 1) {
+					out.push_back((uint8_t)(run + 126));
+					putPixel(pixels[i]);
+					i += run;
+					continue;
+				}
+
+				// Literal pixels continue until the next pair of equal pixels
+				size_t count = 1;
+				while (i + count < numPixels && count < maxLiteral &&
+					   !(i + count + 1 < numPixels &&
+						 pixels[i + count] == pixels[i + count + 1]))
+					++count;
+
+				out.push_back((uint8_t)(count - 1));
+				for (size_t j = 0; j < count; ++j) putPixel(pixels[i + j]);
+				i += count;
+			}
+
+			return out;
 		}
-	}
 
-	void HistoryNode::killChildren() {
-		if (m_next) m_next->killChildren();
-		delete m_next;
-		m_next = nullptr;
-	}
+		/// Decode pixels produced by encodeSurface. Truncated data leaves the remaining
+		/// pixels untouched
+		/// \param encoded Encoded pixels
+		/// \param surface Destination surface, with the dimensions of the original
+		void decodeSurface(const std::vector<uint8_t> &encoded, ci::Surface &surface) {
+			const int64_t width		  = surface.getWidth();
+			const int64_t height	  = surface.getHeight();
+			const uint8_t pixelInc	  = surface.getPixelInc();
+			const uint8_t redOffset	  = surface.getRedOffset();
+			const uint8_t greenOffset = surface.getGreenOffset();
+			const uint8_t blueOffset  = surface.getBlueOffset();
+			const uint8_t alphaOffset = surface.getAlphaOffset();
+			const bool hasAlpha		  = surface.hasAlpha();
+			if (width <= 0 || height <= 0) return;
 
-	size_t HistoryNode::sizeForward(size_t prevSize) const {
-		if (m_next)
-			return m_next->sizeForward(prevSize + 1);
-		else
-			return prevSize;
-	}
+			int64_t x	 = 0;
+			int64_t y	 = 0;
+			uint8_t *dst = surface.getData(ci::ivec2(0, 0));
 
-	size_t HistoryNode::sizeBackward(size_t prevSize) const {
-		if (m_prev)
-			return m_prev->sizeBackward(prevSize + 1);
-		else
-			return prevSize;
-	}
+			const auto putPixel = [&](const uint8_t *rgba) {
+				if (y >= height) return;
+				dst[redOffset]	 = rgba[0];
+				dst[greenOffset] = rgba[1];
+				dst[blueOffset]	 = rgba[2];
+				if (hasAlpha) dst[alphaOffset] = rgba[3];
+				dst += pixelInc;
 
-	HistoryNode *HistoryNode::next() const { return m_next; }
-	HistoryNode *HistoryNode::prev() const { return m_prev; }
+				if (++x == width) {
+					x = 0;
+					if (++y < height) dst = surface.getData(ci::ivec2(0, (int32_t)y));
+				}
+			};
 
-	HistoryNode *HistoryNode::first() {
-		if (m_prev)
-			return m_prev->first();
-		else
-			return this;
-	}
+			size_t pos = 0;
+			while (pos < encoded.size()) {
+				const uint8_t header = encoded[pos++];
+				if (header >= 128) {
+					if (pos + 4 > encoded.size()) break;
+					for (int64_t j = 0; j < header - 126; ++j) putPixel(&encoded[pos]);
+					pos += 4;
+				} else {
+					const size_t count = (size_t)header + 1;
+					if (pos + count * 4 > encoded.size()) break;
+					for (size_t j = 0; j < count; ++j) putPixel(&encoded[pos + j * 4]);
+					pos += count * 4;
+				}
+			}
+		}
+	} // namespace
 
-	HistoryNode *HistoryNode::last() {
-		if (m_next)
-			return m_next->last();
-		else
-			return this;
-	}
+	HistoryNode::HistoryNode(HistoryBuffer *buffer, int64_t index, int64_t parent,
+							 int64_t depth) :
+			m_buffer(buffer),
+			m_index(index),
+			m_parent(parent),
+			m_depth(depth) {}
+
+	HistoryNode *HistoryNode::next() const { return m_buffer->node(m_activeChild); }
+	HistoryNode *HistoryNode::prev() const { return m_buffer->node(m_parent); }
+
+	size_t HistoryNode::branches() const { return m_children.size(); }
+	size_t HistoryNode::depth() const { return m_depth; }
 
 	void HistoryNode::set(const RenderConfig &config, const ci::Surface &surface) {
-		m_config  = config;
-		m_surface = surface;
+		setConfig(config);
+		setSurface(surface);
 	}
 
 	void HistoryNode::setConfig(const RenderConfig &config) { m_config = config; }
 
-	void HistoryNode::setSurface(const ci::Surface &surface) { m_surface = surface; }
+	void HistoryNode::setSurface(const ci::Surface &surface) {
+		const size_t oldBytes = m_resident ? m_snapshot.size() : 0;
+
+		m_buffer->releaseSpilled(*this);
+		m_width			= surface.getWidth();
+		m_height		= surface.getHeight();
+		m_snapshot		= encodeSurface(surface);
+		m_snapshotBytes = m_snapshot.size();
+		m_buffer->snapshotChanged(*this, oldBytes);
+
+		m_thumbnail		   = m_buffer->makeThumbnail(surface);
+		m_thumbnailTexture = nullptr;
+	}
 
 	const RenderConfig &HistoryNode::config() const { return m_config; }
-	const ci::Surface &HistoryNode::surface() const { return m_surface; }
-	RenderConfig &HistoryNode::config() { return m_config; }
-	ci::Surface &HistoryNode::surface() { return m_surface; }
+
+	ci::Surface HistoryNode::surface() const {
+		ci::Surface surface(m_width, m_height, true);
+		if (m_spillOffset < 0) {
+			decodeSurface(m_snapshot, surface);
+		} else {
+			std::vector<uint8_t> encoded;
+			if (m_buffer->readSpilled(*this, encoded)) decodeSurface(encoded, surface);
+		}
+		return surface;
+	}
+
+	const ci::Surface &HistoryNode::thumbnail() const { return m_thumbnail; }
+
+	const ci::gl::Texture2dRef &HistoryNode::thumbnailTexture() const {
+		if (!m_thumbnailTexture)
+			m_thumbnailTexture = ci::gl::Texture2d::create(m_thumbnail);
+		return m_thumbnailTexture;
+	}
+
+	void HistoryNode::restore(RenderConfig &config) const {
+		PaletteHandle palettes = std::move(config.palettes);
+		config				   = m_config;
+		config.palettes		   = std::move(palettes);
+	}
+
+	size_t HistoryNode::snapshotBytes() const { return m_snapshotBytes; }
 
 	HistoryBuffer::~HistoryBuffer() {
-		m_listHead->killChildren();
-		// No need to delete m_currentNode, since it will be killed recursively
-		LIBRAPID_ASSERT(!m_listHead->next() && !m_listHead->prev(),
-						"HistoryBuffer is not empty");
-		delete m_listHead;
+		if (!m_spillFile.is_open()) return;
+		m_spillFile.close();
+		std::error_code error;
+		std::filesystem::remove(m_spillPath, error);
 	}
 
 	void HistoryBuffer::append(const RenderConfig &config, const ci::Surface &surface) {
-		auto list = new HistoryNode;
-		list->set(config, surface);
-		if (m_listHead) {
-			m_listHead->append(list);
-			m_currentNode = m_listHead->last();
-		} else {
-			m_listHead	  = list;
-			m_currentNode = list;
+		const auto index	= (int64_t)m_nodes.size();
+		HistoryNode *parent = current();
+		const int64_t depth = parent ? parent->m_depth + 1 : 0;
+
+		m_nodes.push_back(std::make_unique<HistoryNode>(this, index, m_current, depth));
+		if (parent) {
+			// Any existing children are kept as other branches
+			parent->m_children.push_back(index);
+			parent->m_activeChild = index;
 		}
+
+		m_current = index;
+		m_branch.resize(depth);
+		m_branch.push_back(index);
+		m_nodes.back()->set(config, surface);
 	}
 
 	bool HistoryBuffer::undo() {
-		if (m_currentNode->prev()) {
-			m_currentNode = m_currentNode->prev();
+		HistoryNode *node = current();
+		if (node && node->prev()) {
+			m_current = node->m_parent;
 			return true;
 		}
 		return false;
 	}
 
 	bool HistoryBuffer::redo() {
-		if (m_currentNode->next()) {
-			m_currentNode = m_currentNode->next();
+		HistoryNode *node = current();
+		if (node && node->next()) {
+			m_current = node->m_activeChild;
 			return true;
 		}
 		return false;
 	}
 
-	size_t HistoryBuffer::size() const {
-		if (!m_listHead) return 0;
-		return m_listHead->sizeForward();
+	void HistoryBuffer::select(HistoryNode *selected) {
+		if (!selected) return;
+		m_current = selected->m_index;
+
+		// Every node on the way to the selected node must lead towards it
+		HistoryNode *child = selected;
+		while (HistoryNode *parent = child->prev()) {
+			parent->m_activeChild = child->m_index;
+			child				  = parent;
+		}
+
+		// The branch continues past the selected node as it did before
+		HistoryNode *tip = selected;
+		while (tip->next()) tip = tip->next();
+
+		m_branch.resize(tip->m_depth + 1);
+		for (HistoryNode *node = tip; node; node = node->prev())
+			m_branch[node->m_depth] = node->m_index;
+	}
+
+	void HistoryBuffer::reset() {
+		if (m_nodes.empty()) return;
+		m_nodes.resize(1);
+
+		HistoryNode &root = *m_nodes.front();
+		root.m_children.clear();
+		root.m_activeChild = -1;
+		m_current		   = 0;
+		m_branch.assign(1, 0);
+
+		// Bring the first snapshot back into memory, so the spill file can be reused
+		// from the start
+		if (root.m_spillOffset >= 0) {
+			std::vector<uint8_t> encoded;
+			if (readSpilled(root, encoded)) root.m_snapshot = std::move(encoded);
+			root.m_snapshotBytes = root.m_snapshot.size();
+			root.m_spillOffset	 = -1;
+		}
+
+		root.m_resident = true;
+		m_resident.assign(1, 0);
+		m_residentBytes = root.m_snapshot.size();
+		m_spillEnd		= 0;
+		m_spillFree.clear();
+	}
+
+	size_t HistoryBuffer::size() const { return m_branch.size(); }
+
+	size_t HistoryBuffer::nodeCount() const { return m_nodes.size(); }
+
+	HistoryNode *HistoryBuffer::first() const { return node(m_nodes.empty() ? -1 : 0); }
+	HistoryNode *HistoryBuffer::last() const {
+		return node(m_branch.empty() ? -1 : m_branch.back());
+	}
+
+	HistoryNode *HistoryBuffer::current() const { return node(m_current); }
+	HistoryNode *HistoryBuffer::at(size_t depth) const { return node(m_branch[depth]); }
+
+	void HistoryBuffer::setThumbnailWidth(int64_t width) {
+		m_thumbnailWidth = lrc::max(int64_t(1), width);
+	}
+
+	void HistoryBuffer::setMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+
+	void HistoryBuffer::setSpillBudget(size_t bytes) { m_spillBudget = bytes; }
+
+	size_t HistoryBuffer::memoryUsage() const { return m_residentBytes; }
+
+	HistoryNode *HistoryBuffer::node(int64_t index) const {
+		if (index < 0) return nullptr;
+		return m_nodes[index].get();
+	}
+
+	void HistoryBuffer::snapshotChanged(HistoryNode &node, size_t oldBytes) {
+		m_residentBytes = m_residentBytes - oldBytes + node.m_snapshot.size();
+
+		// Snapshots are spilled least recently stored first, so an updated node moves
+		// to the back of the queue
+		if (node.m_resident) {
+			auto queued = std::find(m_resident.begin(), m_resident.end(), node.m_index);
+			m_resident.erase(queued);
+		}
+		node.m_resident = true;
+		m_resident.push_back(node.m_index);
+
+		// The current node is the one most likely to be updated again, so it stays
+		int64_t keep = -1;
+		while (m_residentBytes > m_memoryBudget && !m_resident.empty()) {
+			const int64_t index = m_resident.front();
+			m_resident.pop_front();
+			if (index == m_current) {
+				keep = index;
+				continue;
+			}
+
+			HistoryNode &old = *m_nodes[index];
+			if (!spill(old)) {
+				// The configuration can still be re-rendered, so the snapshot is dropped
+				FRAC_WARN("Failed to spill history snapshot. Discarding it");
+				old.m_snapshotBytes = 0;
+			}
+
+			m_residentBytes -= old.m_snapshot.size();
+			old.m_snapshot.clear();
+			old.m_snapshot.shrink_to_fit();
+			old.m_resident = false;
+		}
+
+		if (keep >= 0) m_resident.push_back(keep);
+	}
+
+	bool HistoryBuffer::spill(HistoryNode &node) {
+		if (!m_spillFile.is_open()) {
+			std::error_code error;
+			m_spillPath = std::filesystem::temp_directory_path(error) /
+						  fmt::format("fractal-history-{}.bin", std::random_device()());
+			if (error) return false;
+
+			m_spillFile.open(m_spillPath,
+							 std::ios::in | std::ios::out | std::ios::binary |
+							   std::ios::trunc);
+			if (!m_spillFile.is_open()) return false;
+		}
+
+		// Take the first freed extent large enough for the snapshot, and only grow the
+		// file if there is none
+		const auto bytes = (int64_t)node.m_snapshot.size();
+		auto extent		 = m_spillFree.begin();
+		while (extent != m_spillFree.end() && extent->second < bytes) ++extent;
+
+		int64_t offset = m_spillEnd;
+		if (extent != m_spillFree.end()) {
+			offset = extent->first;
+		} else if ((size_t)(m_spillEnd + bytes) > m_spillBudget) {
+			return false;
+		}
+
+		m_spillFile.seekp(offset);
+		m_spillFile.write(reinterpret_cast<const char *>(node.m_snapshot.data()),
+						  (std::streamsize)bytes);
+		if (!m_spillFile) {
+			m_spillFile.clear();
+			return false;
+		}
+
+		if (extent != m_spillFree.end()) {
+			// Return whatever the snapshot did not use to the free list
+			if (extent->second > bytes)
+				m_spillFree[offset + bytes] = extent->second - bytes;
+			m_spillFree.erase(extent);
+		} else {
+			m_spillEnd += bytes;
+		}
+
+		node.m_spillOffset = offset;
+		return true;
+	}
+
+	void HistoryBuffer::releaseSpilled(HistoryNode &node) {
+		if (node.m_spillOffset < 0) return;
+
+		int64_t offset	   = node.m_spillOffset;
+		int64_t bytes	   = (int64_t)node.m_snapshotBytes;
+		node.m_spillOffset = -1;
+
+		// Merge with the free extents on either side, so they can hold larger snapshots
+		auto after = m_spillFree.lower_bound(offset);
+		if (after != m_spillFree.end() && offset + bytes == after->first) {
+			bytes += after->second;
+			after = m_spillFree.erase(after);
+		}
+		if (after != m_spillFree.begin()) {
+			auto before = std::prev(after);
+			if (before->first + before->second == offset) {
+				offset = before->first;
+				bytes += before->second;
+				m_spillFree.erase(before);
+			}
+		}
+
+		// Space at the end of the file is simply given back
+		if (offset + bytes == m_spillEnd) {
+			m_spillEnd = offset;
+		} else {
+			m_spillFree[offset] = bytes;
+		}
+	}
+
+	bool HistoryBuffer::readSpilled(const HistoryNode &node,
+									std::vector<uint8_t> &out) const {
+		if (!m_spillFile.is_open() || node.m_spillOffset < 0) return false;
+
+		// Flush pending writes before reading them back
+		m_spillFile.flush();
+		out.resize(node.m_snapshotBytes);
+		m_spillFile.seekg(node.m_spillOffset);
+		m_spillFile.read(reinterpret_cast<char *>(out.data()),
+						 (std::streamsize)out.size());
+		if (!m_spillFile) {
+			m_spillFile.clear();
+			return false;
+		}
+		return true;
 	}
 
-	HistoryNode *HistoryBuffer::first() const { return m_listHead->first(); }
-	HistoryNode *HistoryBuffer::last() const { return m_listHead->last(); }
+	ci::Surface HistoryBuffer::makeThumbnail(const ci::Surface &surface) {
+		const int64_t width	 = surface.getWidth();
+		const int64_t height = surface.getHeight();
+		if (width <= 0 || height <= 0) return {};
+
+		const int64_t thumbWidth  = lrc::min(width, m_thumbnailWidth);
+		const int64_t thumbHeight = lrc::max(int64_t(1), height * thumbWidth / width);
+		ci::Surface thumbnail((int32_t)thumbWidth, (int32_t)thumbHeight, true);
+
+		const uint8_t srcOffsets[3] = {
+		  surface.getRedOffset(), surface.getGreenOffset(), surface.getBlueOffset()};
+		const uint8_t dstOffsets[3] = {thumbnail.getRedOffset(),
+									   thumbnail.getGreenOffset(),
+									   thumbnail.getBlueOffset()};
+
+		const uint8_t pixelInc	= surface.getPixelInc();
+		const uint8_t dstInc	= thumbnail.getPixelInc();
+		const uint8_t dstAlpha	= thumbnail.getAlphaOffset();
+		const int64_t rowValues = width * pixelInc;
+
+		const auto filterRows = [&](int64_t firstRow, int64_t lastRow) {
+			// Column sums of every byte of the source rows covered by a thumbnail row
+			std::vector<uint32_t> sums(rowValues);
+
+			for (int64_t ty = firstRow; ty < lastRow; ++ty) {
+				const int64_t y0 = ty * height / thumbHeight;
+				const int64_t y1 = lrc::max(y0 + 1, (ty + 1) * height / thumbHeight);
+
+				// Summing whole rows of bytes has no branches, so it can be vectorised
+				std::fill(sums.begin(), sums.end(), 0);
+				for (int64_t y = y0; y < y1; ++y) {
+					const uint8_t *src = surface.getData(ci::ivec2(0, (int32_t)y));
+					for (int64_t i = 0; i < rowValues; ++i) sums[i] += src[i];
+				}
+
+				uint8_t *dst = thumbnail.getData(ci::ivec2(0, (int32_t)ty));
+				for (int64_t tx = 0; tx < thumbWidth; ++tx) {
+					const int64_t x0 = tx * width / thumbWidth;
+					const int64_t x1 = lrc::max(x0 + 1, (tx + 1) * width / thumbWidth);
+					const auto area	 = (uint32_t)((x1 - x0) * (y1 - y0));
+
+					for (int64_t channel = 0; channel < 3; ++channel) {
+						uint32_t total = 0;
+						for (int64_t x = x0; x < x1; ++x)
+							total += sums[x * pixelInc + srcOffsets[channel]];
+						dst[dstOffsets[channel]] = (uint8_t)((total + area / 2) / area);
+					}
+
+					dst[dstAlpha] = 255;
+					dst += dstInc;
+				}
+			}
+		};
+
+		const int64_t bandRows = lrc::max(int64_t(1), thumbHeight / 16);
+		for (int64_t row = 0; row < thumbHeight; row += bandRows) {
+			const int64_t lastRow = lrc::min(row + bandRows, thumbHeight);
+			m_thumbnailPool.push_task([filterRows, row, lastRow]() {
+				filterRows(row, lastRow);
+			});
+		}
+
+		m_thumbnailPool.wait_for_tasks();
+		return thumbnail;
+	}
 } // namespace frac
@@ -0,0 +1,182 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	ImageStreamWriter::ImageStreamWriter(const std::string &path,
+										 const lrc::Vec2i &imageSize, Format format,
+										 bool resume) :
+			m_path(path),
+			m_imageSize(imageSize), m_format(format) {
+		const int64_t rowBytes = m_imageSize.x() * 3;
+
+		std::string header;
+		if (m_format == Format::PPM)
+			header = fmt::format("P6\n{} {}\n255\n", m_imageSize.x(), m_imageSize.y());
+
+		std::error_code ec;
+		if (resume && std::filesystem::exists(path, ec)) {
+			auto existing = static_cast<int64_t>(std::filesystem::file_size(path, ec));
+
+			// Make sure the file on disk was written for an image of the same size,
+			// otherwise appending to it would produce garbage
+			bool compatible = !ec && existing >= headerSize();
+			if (compatible && m_format == Format::PPM) {
+				std::ifstream existingFile(path, std::ios::in | std::ios::binary);
+				std::string existingHeader(header.size(), '\0');
+				existingFile.read(existingHeader.data(), (std::streamsize)header.size());
+				compatible = existingFile && existingHeader == header;
+			}
+
+			if (compatible) {
+				m_rowsWritten = std::min<int64_t>((existing - headerSize()) / rowBytes,
+												  m_imageSize.y());
+
+				// Drop any partially written row from the end of the file
+				std::filesystem::resize_file(
+				  path, headerSize() + m_rowsWritten * rowBytes, ec);
+
+				m_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+				m_file.seekp(0, std::ios::end);
+
+				FRAC_LOG(fmt::format("Resuming {} from row {}", path, m_rowsWritten));
+				return;
+			}
+
+			FRAC_WARN(fmt::format("Cannot resume {}. Starting from scratch", path));
+			m_rowsWritten = 0;
+		}
+
+		m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!m_file.is_open()) {
+			FRAC_ERROR(fmt::format("Failed to open {} for writing", path));
+			return;
+		}
+
+		m_file.write(header.data(), (std::streamsize)header.size());
+	}
+
+	ImageStreamWriter::~ImageStreamWriter() {
+		if (m_file.is_open()) {
+			m_file.flush();
+			m_file.close();
+		}
+	}
+
+	ImageStreamWriter::Format ImageStreamWriter::formatFromPath(const std::string &path) {
+		std::string extension = std::filesystem::path(path).extension().string();
+		for (auto &c : extension) c = (char)std::tolower(c);
+		if (extension == ".ppm") return Format::PPM;
+		return Format::Raw;
+	}
+
+	bool ImageStreamWriter::isOpen() const { return m_file.is_open(); }
+
+	int64_t ImageStreamWriter::rowsWritten() const { return m_rowsWritten; }
+
+	bool ImageStreamWriter::writeRows(const ci::Surface &surface, int64_t rows) {
+		if (surface.getWidth() != m_imageSize.x() || rows > surface.getHeight()) {
+			FRAC_ERROR(fmt::format("Surface does not match the size of {}", m_path));
+			return false;
+		}
+
+		packRows(surface, rows, m_packBuffer);
+		return writePacked(m_packBuffer.data(), rows);
+	}
+
+	bool ImageStreamWriter::writePacked(const uint8_t *data, int64_t rows) {
+		if (!m_file.is_open()) return false;
+
+		if (m_rowsWritten + rows > m_imageSize.y()) {
+			FRAC_ERROR(fmt::format("Band of {} rows does not fit in {}", rows, m_path));
+			return false;
+		}
+
+		m_file.write(reinterpret_cast<const char *>(data),
+					 (std::streamsize)(m_imageSize.x() * rows * 3));
+
+		// Flush after every band so an interrupted render can always be resumed from
+		// the last complete band
+		m_file.flush();
+		m_rowsWritten += rows;
+		return static_cast<bool>(m_file);
+	}
+
+	void ImageStreamWriter::packRows(const ci::Surface &surface, int64_t rows,
+									 std::vector<uint8_t> &out) {
+		const int64_t width		  = surface.getWidth();
+		const uint8_t pixelInc	  = surface.getPixelInc();
+		const uint8_t redOffset	  = surface.getRedOffset();
+		const uint8_t greenOffset = surface.getGreenOffset();
+		const uint8_t blueOffset  = surface.getBlueOffset();
+
+		out.resize(width * rows * 3);
+		uint8_t *dst = out.data();
+
+		for (int64_t y = 0; y < rows; ++y) {
+			const uint8_t *src = surface.getData(ci::ivec2(0, (int32_t)y));
+			for (int64_t x = 0; x < width; ++x) {
+				*dst++ = src[redOffset];
+				*dst++ = src[greenOffset];
+				*dst++ = src[blueOffset];
+				src += pixelInc;
+			}
+		}
+	}
+
+	void ImageStreamWriter::encodeBMP(const ci::Surface &surface,
+									  std::vector<uint8_t> &out) {
+		const int64_t width		  = surface.getWidth();
+		const int64_t height	  = surface.getHeight();
+		const uint8_t pixelInc	  = surface.getPixelInc();
+		const uint8_t redOffset	  = surface.getRedOffset();
+		const uint8_t greenOffset = surface.getGreenOffset();
+		const uint8_t blueOffset  = surface.getBlueOffset();
+
+		// Rows are stored bottom-up in BGR order, each padded to a multiple of 4 bytes
+		const int64_t rowBytes	 = (width * 3 + 3) & ~int64_t(3);
+		const int64_t dataOffset = 14 + 40;
+		const int64_t fileSize	 = dataOffset + rowBytes * height;
+
+		out.assign(fileSize, 0);
+		uint8_t *header = out.data();
+
+		auto put16 = [](uint8_t *dst, uint32_t value) {
+			dst[0] = (uint8_t)value;
+			dst[1] = (uint8_t)(value >> 8);
+		};
+
+		auto put32 = [](uint8_t *dst, uint32_t value) {
+			for (int i = 0; i < 4; ++i) dst[i] = (uint8_t)(value >> (i * 8));
+		};
+
+		// BITMAPFILEHEADER
+		header[0] = 'B';
+		header[1] = 'M';
+		put32(header + 2, (uint32_t)fileSize);
+		put32(header + 10, (uint32_t)dataOffset);
+
+		// BITMAPINFOHEADER
+		put32(header + 14, 40);
+		put32(header + 18, (uint32_t)width);
+		put32(header + 22, (uint32_t)height);
+		put16(header + 26, 1);	// Colour planes
+		put16(header + 28, 24); // Bits per pixel
+		put32(header + 34, (uint32_t)(rowBytes * height));
+
+		for (int64_t y = 0; y < height; ++y) {
+			const uint8_t *src = surface.getData(ci::ivec2(0, (int32_t)y));
+			uint8_t *dst	   = out.data() + dataOffset + (height - 1 - y) * rowBytes;
+			for (int64_t x = 0; x < width; ++x) {
+				*dst++ = src[blueOffset];
+				*dst++ = src[greenOffset];
+				*dst++ = src[redOffset];
+				src += pixelInc;
+			}
+		}
+	}
+
+	int64_t ImageStreamWriter::headerSize() const {
+		if (m_format == Format::Raw) return 0;
+		return (int64_t)fmt::format("P6\n{} {}\n255\n", m_imageSize.x(), m_imageSize.y())
+		  .size();
+	}
+} // namespace frac
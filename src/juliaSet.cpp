@@ -5,11 +5,18 @@ namespace frac {
 
 	size_t JuliaSet::supportedOptimisations() const {
 		// Outlining is proven for the Mandelbrot set
-		return optimisations::OUTLINE_OPTIMISATION;
+		return optimisations::OUTLINE_OPTIMISATION | optimisations::DISTANCE_ESTIMATION;
+	}
+
+	Symmetry JuliaSet::symmetry() const {
+		// z^2 + c is unchanged by negating z, so -z escapes exactly as z does
+		return Symmetry::Origin;
 	}
 
 	std::string JuliaSet::name() const { return "Julia Set"; }
 
+	bool JuliaSet::isEscapeTime() const { return true; }
+
 	std::unordered_map<std::string, coloring::ColorFuncLow>
 	JuliaSet::getLowPrecColoringAlgorithms() const {
 		return {{"Logarithmic Scaling",
@@ -85,8 +92,26 @@ namespace frac {
 
 	std::pair<int64_t, lrc::Complex<HighPrecision>>
 	JuliaSet::iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const {
-		lrc::Complex<HighPrecision> c(-0.8, 0.156); // Julia set constant
-		auto z			  = coord;
+		// Iterate in the thread's preallocated variables, so nothing is allocated per
+		// iteration
+		highPrecision::Scratch &scratch =
+		  highPrecision::threadScratch(Fractal::m_renderConfig.precision);
+		scratch.re		= lrc::real(coord);
+		scratch.im		= lrc::imag(coord);
+		scratch.cRe		= -0.8; // Julia set constant
+		scratch.cIm		= 0.156;
+		scratch.bailout = Fractal::m_renderConfig.bail; // Bail when larger than this
+
+		const int64_t iteration =
+		  highPrecision::iterateQuadratic(scratch, Fractal::m_renderConfig.maxIters);
+		return {iteration, lrc::Complex<HighPrecision>(scratch.re, scratch.im)};
+	}
+
+	DistanceEstimate
+	JuliaSet::distanceEstimateLow(const lrc::Complex<LowPrecision> &coord) const {
+		lrc::Complex<LowPrecision> c(-0.8, 0.156); // Julia set constant
+		auto z = coord;
+		lrc::Complex<LowPrecision> dz(1, 0); // Derivative with respect to coord
 		int64_t iteration = 0;
 
 		// Bail when larger than this
@@ -94,10 +119,15 @@ namespace frac {
 
 		while (z.real() * z.real() + z.imag() * z.imag() <= bailout &&
 			   iteration < Fractal::m_renderConfig.maxIters) {
-			z = z * z + c;
+			dz = 2.0 * z * dz;
+			z  = z * z + c;
 			++iteration;
 		}
-		return {iteration, z};
+
+		// Interior distances are only estimated for the Mandelbrot set
+		if (z.real() * z.real() + z.imag() * z.imag() <= bailout)
+			return {iteration, z, 0, false};
+		return {iteration, z, exteriorDistance(z, dz), false};
 	}
 
 	ci::ColorA JuliaSet::getColorLow(
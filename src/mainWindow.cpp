@@ -8,8 +8,15 @@ namespace frac {
 		std::fstream settingsFile(FRACTAL_UI_SETTINGS_PATH, std::ios::in);
 		if (settingsFile.is_open()) {
 			m_renderer.setConfig(json::parse(settingsFile));
-			m_history.append(m_renderer.config(), m_renderer.surface());
-			m_historyNode = m_history.first();
+
+			// Snapshots beyond the budget are moved to disk
+			const json &history = m_renderer.settings()["menus"]["history"];
+			m_history.setMemoryBudget(history.value("memoryBudgetMB", size_t(256)) *
+									  1024 * 1024);
+			m_history.setSpillBudget(history.value("spillBudgetMB", size_t(4096)) *
+									 1024 * 1024);
+			m_history.setThumbnailWidth(history["frameWidth"].get<int64_t>());
+			m_history.append(m_renderer.config(), m_renderer.frontSurface());
 		} else {
 			FRAC_ERROR("Failed to open settings file");
 			quit();
@@ -69,6 +76,7 @@ namespace frac {
 		setFractalType(fractalType);
 		m_renderer.setColorFunc(colorFunc);
 		m_renderer.setPaletteName(palette);
+		m_renderer.setKeepIterationData(true);
 		m_renderer.config().bail = bailoutVal;
 		m_renderer.updateConfigPrecision();
 		m_renderer.updateRenderConfig();
@@ -77,34 +85,19 @@ namespace frac {
 	void MainWindow::appendConfigToHistory() {
 		FRAC_LOG("Appending to history");
 
-		if (m_historyNode != m_history.last()) {
-			// There is a pre-existing history, so it must be overwritten
-			m_historyNode->killChildren();
-		}
-
-		m_history.append(m_renderer.config(), m_renderer.surface());
-		m_historyNode = m_history.last();
+		// If the current node is not the last, this starts a new branch. The old one is
+		// kept, and can be returned to from the history window
+		m_history.append(m_renderer.config(), m_renderer.frontSurface());
 	}
 
 	void MainWindow::setFractalType(const std::string &name) {
-		std::shared_ptr<Fractal> newFracPtr;
-
-		if (name == "Mandelbrot") {
-			newFracPtr = std::make_shared<Mandelbrot>(m_renderer.config());
-		} else if (name == "Julia Set") {
-			newFracPtr = std::make_shared<JuliaSet>(m_renderer.config());
-		} else if (name == "Newton's Fractal") {
-			newFracPtr = std::make_shared<NewtonFractal>(m_renderer.config());
-		} else {
-			newFracPtr = std::make_shared<Mandelbrot>(m_renderer.config());
-		}
+		const json &fractals = m_renderer.settings()["renderConfig"]["fractals"];
 
 		// If changing the fractal, clear the history, since it is no longer
 		// valid
-		m_history.first()->killChildren();
-		m_historyNode = m_history.first();
+		m_history.reset();
 
-		m_renderer.updateFractalType(newFracPtr);
+		m_renderer.updateFractalType(name, fractals.value(name, json::object()));
 	}
 
 	std::vector<std::tuple<lrc::Vec2f, lrc::Vec2f, HistoryNode *>>
@@ -116,28 +109,30 @@ namespace frac {
 		const float historyFrameSep	  = settings["menus"]["history"]["frameSep"];
 
 		const auto windowWidth	   = (float)getWindowWidth();
+		const auto windowHeight	   = (float)getWindowHeight();
 		const RenderConfig &config = m_renderer.config();
-		size_t historySize		   = m_history.size();
-		HistoryNode *node		   = m_history.first();
-		int64_t index			   = 0;
-		int64_t totalHeight		   = 0;
-
-		while (node) {
-			float aspect = (float)config.imageSize.x() / (float)config.imageSize.y();
-			lrc::Vec2f renderSize(historyFrameWidth, historyFrameWidth / aspect);
+		const auto historySize	   = (int64_t)m_history.size();
+
+		float aspect = (float)config.imageSize.x() / (float)config.imageSize.y();
+		lrc::Vec2f renderSize(historyFrameWidth, historyFrameWidth / aspect);
+		const float frameStride = renderSize.y() + historyFrameSep;
+
+		// Frames are stacked with the newest at the top, so the frame at index i is
+		// drawn at historyFrameSep + frameStride * (historySize - i - 1) + scroll. Only
+		// the frames overlapping the window are returned
+		const float top			 = historyFrameSep + m_historyScrollTarget;
+		const auto firstFromTop	 = (int64_t)((0 - top - renderSize.y()) / frameStride);
+		const auto lastFromTop	 = (int64_t)((windowHeight - top) / frameStride);
+		const int64_t firstIndex = lrc::max(int64_t(0), historySize - 1 - lastFromTop);
+		const int64_t lastIndex =
+		  lrc::min(historySize - 1, historySize - 1 - lrc::max(int64_t(0), firstFromTop));
+
+		for (int64_t index = firstIndex; index <= lastIndex; ++index) {
 			lrc::Vec2f drawPos(windowWidth - historyFrameWidth - historyFrameSep,
-							   (renderSize.y() + historyFrameSep) *
-								   (float)(historySize - index - 1) +
-								 historyFrameSep);
-
-			totalHeight += (int64_t)(renderSize.y() + historyFrameSep);
-			drawPos.y(drawPos.y() + m_historyScrollTarget);
+							   frameStride * (float)(historySize - index - 1) + top);
 
 			ret.emplace_back(std::tuple<lrc::Vec2f, lrc::Vec2f, HistoryNode *>(
-			  drawPos, renderSize, node));
-
-			node = node->next();
-			index++;
+			  drawPos, renderSize, m_history.at(index)));
 		}
 
 		return ret;
@@ -146,24 +141,22 @@ namespace frac {
 	void MainWindow::undoLastMove() {
 		FRAC_LOG("Attempting to Undo...");
 		// Ensure a previous configuration actually exists
-		if (m_historyNode->prev()) {
+		if (m_history.undo()) {
 			FRAC_LOG("Undo successful");
-			m_historyNode = m_historyNode->prev();
 
 			// Update the render configuration
-			m_renderer.config() = m_historyNode->config();
+			m_history.current()->restore(m_renderer.config());
 			renderFractal(false);
 		}
 	}
 
 	void MainWindow::redoLastMove() {
 		FRAC_LOG("Attempting to Redo...");
-		if (m_historyNode->next()) {
+		if (m_history.redo()) {
 			FRAC_LOG("Redo successful");
-			m_historyNode = m_historyNode->next();
 
 			// Update the render configuration
-			m_renderer.config() = m_historyNode->config();
+			m_history.current()->restore(m_renderer.config());
 			renderFractal(false);
 		}
 	}
@@ -174,7 +167,20 @@ namespace frac {
 	}
 
 	void MainWindow::drawFractal() {
-		m_fractalTexture = ci::gl::Texture2d::create(m_renderer.surface());
+		// Only the regions the render threads have finished since the last frame are
+		// uploaded, and nothing is uploaded while the image is unchanged. The texture
+		// is recreated if the image has been resized
+		const bool changed		   = m_renderer.presentSurface(m_changedRegions);
+		const ci::Surface &surface = m_renderer.frontSurface();
+		if (!m_fractalTexture || m_fractalTexture->getWidth() != surface.getWidth() ||
+			m_fractalTexture->getHeight() != surface.getHeight()) {
+			m_fractalTexture = ci::gl::Texture2d::create(surface);
+		} else if (changed) {
+			for (const SurfaceRegion &region : m_changedRegions) {
+				glu::updateTexture(
+				  m_fractalTexture, surface, region.topLeft, region.dimensions);
+			}
+		}
 
 		const RenderConfig &config = m_renderer.config();
 		double aspect = (double)config.imageSize.x() / (double)config.imageSize.y();
@@ -216,7 +222,7 @@ namespace frac {
 
 		if (m_drawingZoomBox) {
 			// Draw an aspect-ratio corrected box
-			RenderConfig config = m_renderer.config();
+			const RenderConfig &config = m_renderer.config();
 			float aspectRatio = (float)config.imageSize.x() / (float)config.imageSize.y();
 			lrc::Vec2i correctedBox =
 			  aspectCorrectedBox(m_mouseDownPos, m_mousePos, aspectRatio);
@@ -416,6 +422,8 @@ namespace frac {
 						fmt::format("{:.3f}", stats.average).c_str());
 			ImGui::Text("Estimated Time Remaining: %s",
 						lrc::formatTime(stats.remainingTime).c_str());
+			ImGui::Text("Pixels Computed: %s",
+						fmt::format("{}", m_renderer.pixelsComputed()).c_str());
 		}
 		ImGui::End();
 
@@ -439,9 +447,15 @@ namespace frac {
 			{
 				static int currentFractalType		  = 0;
 				std::vector<std::string> fractalNames = {
-				  "Mandelbrot",		 // 0
-				  "Julia Set",		 // 1
-				  "Newton's Fractal" // 2
+				  "Mandelbrot",		  // 0
+				  "Julia Set",		  // 1
+				  "Newton's Fractal", // 2
+				  "Formula",		  // 3
+				  "Multibrot 3",	  // 4
+				  "Multibrot 4",	  // 5
+				  "Multibrot 5",	  // 6
+				  "Burning Ship",	  // 7
+				  "Burning Ship 3"	  // 8
 				};
 
 				ImGui::PushItemWidth(labelledItemWidth);
@@ -468,7 +482,13 @@ namespace frac {
 								 coloringFuncs.size())) {
 					stopRender();
 					m_renderer.setColorFunc(coloringFuncs[currentColoringFunc]);
-					renderFractal();
+
+					// Recolour the last render rather than iterating it again
+					if (m_renderer.recolor()) {
+						appendConfigToHistory();
+					} else {
+						renderFractal();
+					}
 				}
 			}
 
@@ -485,7 +505,12 @@ namespace frac {
 								 paletteNames.size())) {
 					stopRender();
 					m_renderer.setPaletteName(paletteNames[currentPalette]);
-					renderFractal();
+
+					if (m_renderer.recolor()) {
+						appendConfigToHistory();
+					} else {
+						renderFractal();
+					}
 				}
 			}
 
@@ -582,9 +607,8 @@ namespace frac {
 				std::fstream settingsFile(filePath, std::ios::in);
 				if (settingsFile.is_open()) {
 					m_renderer.setConfig(json::parse(settingsFile));
-					m_history.first()->killChildren();
-					m_history.append(m_renderer.config(), m_renderer.surface());
-					m_historyNode = m_history.first();
+					m_history.reset();
+					m_history.append(m_renderer.config(), m_renderer.frontSurface());
 					configureFractalDefault();
 					renderFractal();
 				} else {
@@ -606,7 +630,10 @@ namespace frac {
 		const std::vector<std::tuple<lrc::Vec2f, lrc::Vec2f, HistoryNode *>> frames =
 		  getHistoryFrameLocations();
 
-		int64_t totalHeight = 0;
+		const float aspect = (float)config.imageSize.x() / (float)config.imageSize.y();
+		const auto totalHeight =
+		  (int64_t)((historyFrameWidth / aspect + historyFrameSep) *
+					(float)m_history.size());
 
 		// Draw a bounding box for the frames to sit within
 		float boxLeft = windowWidth - historyFrameWidth - historyFrameSep * 2;
@@ -618,18 +645,15 @@ namespace frac {
 			const lrc::Vec2f frameSize = std::get<1>(frame);
 			const HistoryNode *node	   = std::get<2>(frame);
 
-			auto texture = ci::gl::Texture2d::create(node->surface());
-			totalHeight += (int64_t)(frameSize.y() + historyFrameSep);
-
-			// Don't draw the frame if it's not visible on the screen
-			if (framePos.y() > windowHeight || framePos.y() + frameSize.y() < 0) continue;
+			// Only visible frames are returned, and each thumbnail is uploaded once
+			const ci::gl::Texture2dRef &texture = node->thumbnailTexture();
 
 			ci::gl::color(ci::ColorA(1, 1, 1, 1));
 			ci::gl::draw(texture, ci::Rectf(framePos, framePos + frameSize));
 			ci::gl::color(ci::ColorA(0, 0, 0, 1));
 			glu::drawStrokedRectangle(framePos, framePos + frameSize, 3);
 
-			if (node == m_historyNode) {
+			if (node == m_history.current()) {
 				// If this frame is selected, outline it gold
 				ci::gl::color(ci::ColorA(1, 1, 0, 1));
 				glu::drawStrokedRectangle(framePos, framePos + frameSize, 4);
@@ -671,7 +695,6 @@ namespace frac {
 		updateHistoryItem();
 
 		RenderConfig &config = m_renderer.config();
-		ci::Surface &surface = m_renderer.surface();
 
 		lrc::Vec2i imagePixTopLeft	   = screenToImageSpace(pixTopLeft);
 		lrc::Vec2i imagePixBottomRight = screenToImageSpace(pixBottomRight);
@@ -692,33 +715,9 @@ namespace frac {
 		HighVec2 newFracSize = lrc::map(
 		  pixelDelta, HighVec2(0, 0), imageSize, HighVec2(0, 0), config.fracSize);
 
-		// Copy the pixels from the selected region to the new region
-		// A temporary buffer is required here because, at some point, the loop
-		// would be writing to the same pixels it is reading from, resulting in
-		// strange visual glitches.
-
-		int64_t imgWidth  = config.imageSize.x();
-		int64_t imgHeight = config.imageSize.y();
-		int64_t index	  = 0;
-		std::vector<ci::ColorA> newPixels(imgWidth * imgHeight);
-		for (int64_t y = 0; y < imgHeight; ++y) {
-			for (int64_t x = 0; x < imgWidth; ++x) {
-				lrc::Vec2i pixPos  = lrc::map(lrc::Vec2f(x, y),
-											  lrc::Vec2f(0, 0),
-											  lrc::Vec2f(imgWidth, imgHeight),
-											  lrc::Vec2f(imagePixTopLeft),
-											  lrc::Vec2f(imagePixBottomRight));
-				newPixels[index++] = surface.getPixel(pixPos);
-			}
-		}
-
-		// Write the new pixels to the surface
-		index = 0;
-		for (int64_t y = 0; y < imgHeight; ++y) {
-			for (int64_t x = 0; x < imgWidth; ++x) {
-				surface.setPixel({x, y}, newPixels[index++]);
-			}
-		}
+		// Stretch the selected region over the image, so it is shown until the new
+		// render replaces it
+		m_renderer.reprojectSurface(imagePixTopLeft, imagePixBottomRight);
 
 		config.fracTopLeft = newFracPos;
 		config.fracSize	   = newFracSize;
@@ -733,8 +732,8 @@ namespace frac {
 
 	void MainWindow::updateHistoryItem() {
 		// Update history buffer surface before re-rendering the fractal
-		if (m_history.size() > 0) {
-			m_history.last()->setSurface(m_renderer.surface());
+		if (HistoryNode *node = m_history.current()) {
+			node->setSurface(m_renderer.frontSurface());
 			FRAC_LOG("Writing to surface");
 		}
 	}
@@ -786,8 +785,8 @@ namespace frac {
 					m_mouseDownPos.y() >= framePos.y() &&
 					m_mouseDownPos.y() < framePos.y() + frameSize.y()) {
 					// Mouse was within this frame, so set it as current
-					m_historyNode		= node;
-					m_renderer.config() = node->config();
+					m_history.select(node);
+					node->restore(m_renderer.config());
 					renderFractal(false); // Re-render the fractal
 				}
 			}
@@ -1,6 +1,19 @@
 #include <fractal/fractal.hpp>
 
 namespace frac {
+	namespace {
+		// Newton steps allowed to locate the attracting cycle of an interior point
+		constexpr int64_t cycleNewtonSteps = 16;
+
+		// Newton's method has converged when a step is smaller than this (squared), and
+		// an orbit has returned to the cycle when it is within this (relative) distance
+		constexpr double cycleToleranceSq = 1e-20;
+
+		LowPrecision normSq(const lrc::Complex<LowPrecision> &z) {
+			return z.real() * z.real() + z.imag() * z.imag();
+		}
+	} // namespace
+
 	Mandelbrot::Mandelbrot(const RenderConfig &config) : Fractal(config) {}
 
 	/*
@@ -13,11 +26,18 @@ namespace frac {
 
 	size_t Mandelbrot::supportedOptimisations() const {
 		// Outlining is proven for the Mandelbrot set
-		return optimisations::OUTLINE_OPTIMISATION;
+		return optimisations::OUTLINE_OPTIMISATION | optimisations::DISTANCE_ESTIMATION;
+	}
+
+	Symmetry Mandelbrot::symmetry() const {
+		// Iterating conj(c) gives the conjugate of every iterate of c
+		return Symmetry::RealAxis;
 	}
 
 	std::string Mandelbrot::name() const { return "Mandelbrot"; }
 
+	bool Mandelbrot::isEscapeTime() const { return true; }
+
 	std::unordered_map<std::string, coloring::ColorFuncLow>
 	Mandelbrot::getLowPrecColoringAlgorithms() const {
 		return {{"Logarithmic Scaling",
@@ -98,24 +118,99 @@ namespace frac {
 
 	std::pair<int64_t, lrc::Complex<HighPrecision>>
 	Mandelbrot::iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const {
-		HighPrecision re_0 = lrc::real(coord); // Real component (initial)
-		HighPrecision im_0 = lrc::imag(coord); // Imaginary component (initial)
-		HighPrecision re = 0, im = 0;
-		HighPrecision tmp; // Temporary variable for use in the calculation
+		// Iterate in the thread's preallocated variables, so nothing is allocated per
+		// iteration
+		highPrecision::Scratch &scratch =
+		  highPrecision::threadScratch(Fractal::m_renderConfig.precision);
+		scratch.re		= 0;
+		scratch.im		= 0;
+		scratch.cRe		= lrc::real(coord);
+		scratch.cIm		= lrc::imag(coord);
+		scratch.bailout = 1 << 16; // Bail when larger than this
+
+		const int64_t iteration =
+		  highPrecision::iterateQuadratic(scratch, Fractal::m_renderConfig.maxIters);
+		return {iteration, lrc::Complex<HighPrecision>(scratch.re, scratch.im)};
+	}
+
+	DistanceEstimate
+	Mandelbrot::distanceEstimateLow(const lrc::Complex<LowPrecision> &coord) const {
+		using Complex = lrc::Complex<LowPrecision>;
+
+		Complex z(0, 0);
+		Complex dz(0, 0); // Derivative with respect to coord
 		int64_t iteration = 0;
 
+		// The iteration at which |z| last fell to a new minimum is the period of the
+		// attracting cycle of an interior point (the period of its atom domain)
+		LowPrecision minNormSq = std::numeric_limits<LowPrecision>::max();
+		int64_t period		   = 0;
+
 		// Bail when larger than this
-		double bailout = 1 << 16;
+		double bailout = Fractal::m_renderConfig.bail;
 
-		while (re * re + im * im <= bailout &&
-			   iteration < Fractal::m_renderConfig.maxIters) {
-			tmp = re * re - im * im + re_0;
-			im	= 2 * re * im + im_0;
-			re	= tmp;
+		while (normSq(z) <= bailout && iteration < Fractal::m_renderConfig.maxIters) {
+			dz = 2.0 * z * dz + 1.0;
+			z  = z * z + coord;
 			++iteration;
+
+			if (normSq(z) < minNormSq) {
+				minNormSq = normSq(z);
+				period	  = iteration;
+			}
+		}
+
+		if (normSq(z) > bailout) return {iteration, z, exteriorDistance(z, dz), false};
+		if (period == 0) return {iteration, z, 0, false};
+
+		// Find a point of the attracting cycle with Newton's method, starting from the
+		// orbit, which should already be close to it
+		Complex cycle = z;
+		for (int64_t step = 0; step < cycleNewtonSteps; ++step) {
+			Complex w = cycle;
+			Complex dw(1, 0);
+			for (int64_t i = 0; i < period; ++i) {
+				dw = 2.0 * w * dw;
+				w  = w * w + coord;
+			}
+
+			const Complex delta = (w - cycle) / (dw - 1.0);
+			cycle -= delta;
+			if (normSq(delta) < cycleToleranceSq) break;
+		}
+
+		// The atom domain period can be a multiple of the true period, which would
+		// overestimate the distance, so use the first return to the cycle instead
+		Complex w = cycle;
+		for (int64_t i = 1; i <= period; ++i) {
+			w = w * w + coord;
+			if (normSq(w - cycle) <= cycleToleranceSq * (1 + normSq(cycle))) {
+				period = i;
+				break;
+			}
 		}
 
-		return {iteration, lrc::Complex<HighPrecision>(re, im)};
+		// Derivatives of the cycle with respect to z and the coordinate
+		w = cycle;
+		Complex dw(1, 0), dc(0, 0), dwdw(0, 0), dcdw(0, 0);
+		for (int64_t i = 0; i < period; ++i) {
+			dcdw = 2.0 * (w * dcdw + dw * dc);
+			dwdw = 2.0 * (dw * dw + w * dwdw);
+			dw	 = 2.0 * w * dw;
+			dc	 = 2.0 * w * dc + 1.0;
+			w	 = w * w + coord;
+		}
+
+		// The point is only proven to be inside the set if Newton's method found a cycle
+		// and the cycle is attracting
+		const LowPrecision multiplier = normSq(dw);
+		if (normSq(w - cycle) > cycleToleranceSq * (1 + normSq(cycle)) || multiplier >= 1)
+			return {iteration, z, 0, false};
+
+		const Complex denominator = dcdw + dwdw * dc / (Complex(1, 0) - dw);
+		const double distance	  = (1 - multiplier) / std::sqrt(normSq(denominator));
+		if (!std::isfinite(distance)) return {iteration, z, 0, false};
+		return {iteration, z, distance, true};
 	}
 
 	ci::ColorA Mandelbrot::getColorLow(
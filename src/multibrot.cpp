@@ -0,0 +1,253 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	namespace {
+		// Number of coordinates iterated in lockstep by PowerFractal::iterCoordsLow
+		constexpr int64_t batchSize = 8;
+
+		/// Iterate z -> fold(z)^Power + c from z = 0 until z escapes
+		/// \param re_0 Real component of c
+		/// \param im_0 Imaginary component of c
+		/// \param bailout Squared magnitude at which z has escaped
+		/// \param maxIters Largest number of iterations to allow
+		/// \return <iterations, resulting coordinate>
+		template<int64_t Power, bool Fold, typename Scalar>
+		std::pair<int64_t, lrc::Complex<Scalar>> iterate(const Scalar &re_0,
+														  const Scalar &im_0,
+														  const Scalar &bailout,
+														  int64_t maxIters) {
+			Scalar re = 0, im = 0;
+			int64_t iteration = 0;
+
+			while (re * re + im * im <= bailout && iteration < maxIters) {
+				if constexpr (Fold) {
+					re = lrc::abs(re);
+					im = lrc::abs(im);
+				}
+
+				unrolledPower<Power>(re, im);
+				re += re_0;
+				im += im_0;
+				++iteration;
+			}
+
+			return {iteration, lrc::Complex<Scalar>(re, im)};
+		}
+	} // namespace
+
+	template<int64_t Power, bool Fold>
+	PowerFractal<Power, Fold>::PowerFractal(const RenderConfig &config) :
+			Fractal(config) {}
+
+	template<int64_t Power, bool Fold>
+	size_t PowerFractal<Power, Fold>::supportedOptimisations() const {
+		// Every Multibrot set is connected, so outlining is as valid as it is for the
+		// Mandelbrot set. The Burning Ship is not connected
+		if constexpr (Fold) return optimisations::BATCHED_ITERATION;
+		return optimisations::OUTLINE_OPTIMISATION | optimisations::BATCHED_ITERATION;
+	}
+
+	template<int64_t Power, bool Fold>
+	Symmetry PowerFractal<Power, Fold>::symmetry() const {
+		// Iterating conj(c) gives the conjugate of every iterate of c. Folding removes
+		// the sign of the imaginary component, so the Burning Ship is not symmetric
+		if constexpr (Fold) return Symmetry::None;
+		return Symmetry::RealAxis;
+	}
+
+	template<int64_t Power, bool Fold>
+	std::string PowerFractal<Power, Fold>::name() const {
+		if constexpr (!Fold) return fmt::format("Multibrot {}", Power);
+		if constexpr (Power == 2) return "Burning Ship";
+		return fmt::format("Burning Ship {}", Power);
+	}
+
+	template<int64_t Power, bool Fold>
+	bool PowerFractal<Power, Fold>::isEscapeTime() const {
+		return true;
+	}
+
+	template<int64_t Power, bool Fold>
+	std::unordered_map<std::string, coloring::ColorFuncLow>
+	PowerFractal<Power, Fold>::getLowPrecColoringAlgorithms() const {
+		return {{"Logarithmic Scaling",
+				 std::function([](const lrc::Complex<LowPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::logarithmicScaling(coord, iters, palette);
+				 })},
+				{"Paletted Logarithmic Scaling",
+				 std::function([](const lrc::Complex<LowPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::palettedLogarithmicScaling(coord, iters, palette);
+				 })},
+				{"Stepped Gradients",
+				 std::function([](const lrc::Complex<LowPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::steppedGradients(coord, iters, palette);
+				 })},
+				{"Fixed Iteration Palette",
+				 std::function([](const lrc::Complex<LowPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::fixedIterPalette(coord, iters, palette);
+				 })}};
+	}
+
+	template<int64_t Power, bool Fold>
+	std::unordered_map<std::string, coloring::ColorFuncHigh>
+	PowerFractal<Power, Fold>::getHighPrecColoringAlgorithms() const {
+		return {{"Logarithmic Scaling",
+				 std::function([](const lrc::Complex<HighPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::logarithmicScaling(coord, iters, palette);
+				 })},
+				{"Paletted Logarithmic Scaling",
+				 std::function([](const lrc::Complex<HighPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::palettedLogarithmicScaling(coord, iters, palette);
+				 })},
+				{"Stepped Gradients",
+				 std::function([](const lrc::Complex<HighPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::steppedGradients(coord, iters, palette);
+				 })},
+				{"Fixed Iteration Palette",
+				 std::function([](const lrc::Complex<HighPrecision> &coord,
+								  int64_t iters,
+								  const ColorPalette &palette) -> ci::ColorA {
+					 return coloring::fixedIterPalette(coord, iters, palette);
+				 })}};
+	}
+
+	template<int64_t Power, bool Fold>
+	std::pair<int64_t, lrc::Complex<LowPrecision>>
+	PowerFractal<Power, Fold>::iterCoordLow(
+	  const lrc::Complex<LowPrecision> &coord) const {
+		return iterate<Power, Fold>(lrc::real(coord),
+									lrc::imag(coord),
+									static_cast<LowPrecision>(m_renderConfig.bail),
+									m_renderConfig.maxIters);
+	}
+
+	template<int64_t Power, bool Fold>
+	void PowerFractal<Power, Fold>::iterCoordsLow(
+	  const lrc::Complex<LowPrecision> *coords, int64_t count,
+	  std::pair<int64_t, lrc::Complex<LowPrecision>> *results) const {
+		const double bailout   = m_renderConfig.bail;
+		const int64_t maxIters = m_renderConfig.maxIters;
+
+		// The coordinates are split into real and imaginary arrays and stepped
+		// together, so the step has no branches and can be vectorised
+		double re[batchSize], im[batchSize];
+		double re_0[batchSize], im_0[batchSize];
+		bool active[batchSize];
+
+		for (int64_t start = 0; start < count; start += batchSize) {
+			const int64_t lanes = lrc::min(batchSize, count - start);
+			int64_t remaining	= lanes;
+
+			for (int64_t lane = 0; lane < lanes; ++lane) {
+				re[lane]	 = 0;
+				im[lane]	 = 0;
+				re_0[lane]	 = coords[start + lane].real();
+				im_0[lane]	 = coords[start + lane].imag();
+				active[lane] = true;
+			}
+
+			for (int64_t iteration = 1; iteration <= maxIters && remaining > 0;
+				 ++iteration) {
+				// Lanes that have already escaped are stepped too, but never read again
+				for (int64_t lane = 0; lane < lanes; ++lane) {
+					double zRe = re[lane];
+					double zIm = im[lane];
+					if constexpr (Fold) {
+						zRe = lrc::abs(zRe);
+						zIm = lrc::abs(zIm);
+					}
+
+					unrolledPower<Power>(zRe, zIm);
+					re[lane] = zRe + re_0[lane];
+					im[lane] = zIm + im_0[lane];
+				}
+
+				for (int64_t lane = 0; lane < lanes; ++lane) {
+					const double radiusSq = re[lane] * re[lane] + im[lane] * im[lane];
+					if (!active[lane] || radiusSq <= bailout) continue;
+
+					results[start + lane] = {
+					  iteration, lrc::Complex<LowPrecision>(re[lane], im[lane])};
+					active[lane] = false;
+					--remaining;
+				}
+			}
+
+			for (int64_t lane = 0; lane < lanes; ++lane) {
+				if (!active[lane]) continue;
+				results[start + lane] = {
+				  maxIters, lrc::Complex<LowPrecision>(re[lane], im[lane])};
+			}
+		}
+	}
+
+	template<int64_t Power, bool Fold>
+	std::pair<int64_t, lrc::Complex<HighPrecision>>
+	PowerFractal<Power, Fold>::iterCoordHigh(
+	  const lrc::Complex<HighPrecision> &coord) const {
+		return iterate<Power, Fold>(lrc::real(coord),
+									lrc::imag(coord),
+									static_cast<HighPrecision>(m_renderConfig.bail),
+									m_renderConfig.maxIters);
+	}
+
+	template<int64_t Power, bool Fold>
+	std::pair<int64_t, lrc::Complex<LowPrecision>>
+	PowerFractal<Power, Fold>::iterCoordNaive(
+	  const lrc::Complex<LowPrecision> &coord) const {
+		lrc::Complex<LowPrecision> z(0, 0);
+		int64_t iteration = 0;
+
+		// Bail when larger than this
+		double bailout = m_renderConfig.bail;
+
+		while (z.real() * z.real() + z.imag() * z.imag() <= bailout &&
+			   iteration < m_renderConfig.maxIters) {
+			if constexpr (Fold)
+				z = lrc::Complex<LowPrecision>(lrc::abs(z.real()), lrc::abs(z.imag()));
+
+			z = lrc::pow(z, static_cast<LowPrecision>(Power)) + coord;
+			++iteration;
+		}
+
+		return {iteration, z};
+	}
+
+	template<int64_t Power, bool Fold>
+	ci::ColorA PowerFractal<Power, Fold>::getColorLow(
+	  const lrc::Complex<LowPrecision> &coord, int64_t iters, const ColorPalette &palette,
+	  const coloring::ColorFuncLow &colorFunc) const {
+		if (coord.real() * coord.real() + coord.imag() * coord.imag() < 4)
+			return {0, 0, 0, 1};
+		return colorFunc(coord, iters, palette);
+	}
+
+	template<int64_t Power, bool Fold>
+	ci::ColorA PowerFractal<Power, Fold>::getColorHigh(
+	  const lrc::Complex<HighPrecision> &coord, int64_t iters,
+	  const ColorPalette &palette, const coloring::ColorFuncHigh &colorFunc) const {
+		if (coord.real() * coord.real() + coord.imag() * coord.imag() < 4)
+			return {0, 0, 0, 1};
+		return colorFunc(coord, iters, palette);
+	}
+
+	template class PowerFractal<3, false>;
+	template class PowerFractal<4, false>;
+	template class PowerFractal<5, false>;
+	template class PowerFractal<2, true>;
+	template class PowerFractal<3, true>;
+} // namespace frac
@@ -1,10 +1,196 @@
 #include <fractal/fractal.hpp>
 
 namespace frac {
-	NewtonFractal::NewtonFractal(const RenderConfig &config) : Fractal(config) {}
+	namespace {
+		// Newton's method stops once it is within this distance of a root
+		constexpr double toleranceLow  = 1e-4;
+		constexpr double toleranceHigh = 1e-15;
+
+		// Number of coordinates iterated in lockstep by NewtonFractal::iterCoordsLow
+		constexpr int64_t batchSize = 8;
+
+		// Iterations of the Durand-Kerner method to allow when finding the roots
+		constexpr int64_t maxRootIters = 1000;
+
+		/// Evaluate a polynomial and its derivative in a single pass of Horner's method
+		/// \param coefficients Coefficients, highest power first
+		/// \param z Point to evaluate at
+		/// \param value Set to the value of the polynomial at z
+		/// \param derivative Set to the value of the derivative at z
+		template<typename T>
+		void horner(const std::vector<lrc::Complex<T>> &coefficients,
+					const lrc::Complex<T> &z, lrc::Complex<T> &value,
+					lrc::Complex<T> &derivative) {
+			value	   = coefficients[0];
+			derivative = lrc::Complex<T>(0, 0);
+			for (size_t i = 1; i < coefficients.size(); ++i) {
+				derivative = derivative * z + value;
+				value	   = value * z + coefficients[i];
+			}
+		}
+
+		template<typename T>
+		T squaredMagnitude(const lrc::Complex<T> &z) {
+			return z.real() * z.real() + z.imag() * z.imag();
+		}
+
+		/// Apply Newton's method to a coordinate until it is within the tolerance of a
+		/// root
+		/// \param coord The initial coordinate
+		/// \param coefficients Coefficients of the polynomial, highest power first
+		/// \param roots Roots of the polynomial
+		/// \param toleranceSq Square of the tolerance
+		/// \param maxIters Largest number of iterations to allow
+		/// \return <index of the root, final coordinate>, or <0, 0> if it does not
+		/// converge
+		template<typename T>
+		std::pair<int64_t, lrc::Complex<T>>
+		newtonIterate(const lrc::Complex<T> &coord,
+					  const std::vector<lrc::Complex<T>> &coefficients,
+					  const std::vector<lrc::Complex<T>> &roots, const T &toleranceSq,
+					  int64_t maxIters) {
+			lrc::Complex<T> z = coord;
+			lrc::Complex<T> value, derivative;
+
+			for (int64_t iteration = 0; iteration < maxIters; ++iteration) {
+				horner(coefficients, z, value, derivative);
+				if (squaredMagnitude(derivative) == 0) break;
+				z -= value / derivative;
+
+				for (size_t i = 0; i < roots.size(); ++i) {
+					if (squaredMagnitude(z - roots[i]) < toleranceSq)
+						return std::make_pair(static_cast<int64_t>(i), z);
+				}
+			}
+
+			return std::make_pair(int64_t(0), lrc::Complex<T>(0, 0));
+		}
+
+		/// Find every root of a polynomial with the Durand-Kerner method
+		/// \param coefficients Coefficients, highest power first. The first must be
+		/// non-zero
+		/// \return The roots, repeated according to their multiplicity
+		std::vector<lrc::Complex<LowPrecision>>
+		findRoots(const std::vector<lrc::Complex<LowPrecision>> &coefficients) {
+			using Complex = lrc::Complex<LowPrecision>;
+
+			// The method needs a monic polynomial
+			std::vector<Complex> monic;
+			for (const auto &coefficient : coefficients)
+				monic.push_back(coefficient / coefficients[0]);
+
+			// Start from powers of a number that is neither real nor a root of unity
+			std::vector<Complex> roots;
+			Complex guess(1, 0);
+			for (size_t i = 1; i < monic.size(); ++i) {
+				roots.push_back(guess);
+				guess = guess * Complex(0.4, 0.9);
+			}
+
+			Complex value, derivative;
+			for (int64_t iteration = 0; iteration < maxRootIters; ++iteration) {
+				LowPrecision largestStep = 0;
+
+				for (size_t i = 0; i < roots.size(); ++i) {
+					Complex denominator(1, 0);
+					for (size_t j = 0; j < roots.size(); ++j) {
+						if (j != i) denominator = denominator * (roots[i] - roots[j]);
+					}
+
+					horner(monic, roots[i], value, derivative);
+					const Complex step = value / denominator;
+					roots[i] -= step;
+					largestStep = lrc::max(largestStep, squaredMagnitude(step));
+				}
+
+				if (largestStep < 1e-30) break;
+			}
+
+			return roots;
+		}
+	} // namespace
+
+	NewtonFractal::NewtonFractal(const RenderConfig &config) : Fractal(config) {
+		setPolynomial({lrc::Complex<LowPrecision>(1, 0),
+					   lrc::Complex<LowPrecision>(0, 0),
+					   lrc::Complex<LowPrecision>(0, 0),
+					   lrc::Complex<LowPrecision>(-1, 0)});
+	}
+
+	void NewtonFractal::updateRenderConfig(const RenderConfig &config) {
+		Fractal::updateRenderConfig(config);
+		if (m_renderConfig.precision != m_rootsPrecision) findRootsHigh();
+	}
+
+	void NewtonFractal::configure(const json &settings) {
+		if (!settings.contains("polynomial")) return;
+
+		// Each coefficient is either a real number or a {"Re": ..., "Im": ...} object
+		std::vector<lrc::Complex<LowPrecision>> coefficients;
+		for (const auto &coefficient : settings["polynomial"]) {
+			if (coefficient.is_number()) {
+				coefficients.emplace_back(coefficient.get<LowPrecision>(), 0);
+			} else {
+				coefficients.emplace_back(coefficient["Re"].get<LowPrecision>(),
+										  coefficient["Im"].get<LowPrecision>());
+			}
+		}
+
+		if (!setPolynomial(std::move(coefficients)))
+			FRAC_ERROR("Newton's Fractal polynomial must have degree 1 or more");
+	}
+
+	bool
+	NewtonFractal::setPolynomial(std::vector<lrc::Complex<LowPrecision>> coefficients) {
+		// Leading zeros do not change the polynomial, but would stop the roots being
+		// found
+		auto leading =
+		  std::find_if(coefficients.begin(), coefficients.end(), [](const auto &c) {
+			  return squaredMagnitude(c) != 0;
+		  });
+		coefficients.erase(coefficients.begin(), leading);
+		if (coefficients.size() < 2) return false;
+
+		m_coefficientsLow = std::move(coefficients);
+		m_rootsLow		  = findRoots(m_coefficientsLow);
+		findRootsHigh();
+		return true;
+	}
+
+	void NewtonFractal::findRootsHigh() {
+		const int64_t prec = m_renderConfig.precision;
+
+		m_coefficientsHigh.clear();
+		for (const auto &coefficient : m_coefficientsLow) {
+			m_coefficientsHigh.emplace_back(HighPrecision(coefficient.real(), prec),
+											HighPrecision(coefficient.imag(), prec));
+		}
+
+		// Newton's method roughly doubles the number of correct bits with each step,
+		// starting from the precision of the low precision roots
+		const auto steps =
+		  2 + static_cast<int64_t>(std::ceil(std::log2(lrc::max(1.0, prec / 48.0))));
+
+		m_rootsHigh.clear();
+		lrc::Complex<HighPrecision> value, derivative;
+		for (const auto &rootLow : m_rootsLow) {
+			lrc::Complex<HighPrecision> root(HighPrecision(rootLow.real(), prec),
+											 HighPrecision(rootLow.imag(), prec));
+			for (int64_t step = 0; step < steps; ++step) {
+				horner(m_coefficientsHigh, root, value, derivative);
+				if (squaredMagnitude(derivative) == 0) break; // Repeated root
+				root -= value / derivative;
+			}
+			m_rootsHigh.push_back(root);
+		}
+
+		m_rootsPrecision = prec;
+	}
 
 	size_t NewtonFractal::supportedOptimisations() const {
-		return 0; // No optimisations supported (currently)
+		// Each pixel is coloured by the root it converges to, so the image is made of
+		// large regions of a single colour. Coordinates are iterated in lockstep lanes
+		return optimisations::BOUNDARY_TRACING | optimisations::BATCHED_ITERATION;
 	}
 
 	std::string NewtonFractal::name() const { return "Newton's Fractal"; }
@@ -31,61 +217,107 @@ namespace frac {
 
 	std::pair<int64_t, lrc::Complex<LowPrecision>>
 	NewtonFractal::iterCoordLow(const lrc::Complex<LowPrecision> &coord) const {
-		// Roots (solutions) of the polynomial
-		static std::vector<lrc::Complex<LowPrecision>> roots = {
-		  lrc::Complex<LowPrecision>(1, 0),
-		  lrc::Complex<LowPrecision>(-.5, sqrt(3) / 2),
-		  lrc::Complex<LowPrecision>(-.5, -sqrt(3) / 2)};
+		return newtonIterate(coord,
+							 m_coefficientsLow,
+							 m_rootsLow,
+							 toleranceLow * toleranceLow,
+							 m_renderConfig.maxIters);
+	}
 
-		constexpr double tolerance = 0.0001;
+	void NewtonFractal::iterCoordsLow(
+	  const lrc::Complex<LowPrecision> *coords, int64_t count,
+	  std::pair<int64_t, lrc::Complex<LowPrecision>> *results) const {
+		const double toleranceSq = toleranceLow * toleranceLow;
+		const size_t terms		 = m_coefficientsLow.size();
 
-		lrc::Complex<LowPrecision> z = coord;
+		// The coordinates are split into real and imaginary arrays and stepped
+		// together, so the inner loops have no branches and can be vectorised
+		double re[batchSize], im[batchSize];
+		double valueRe[batchSize], valueIm[batchSize];
+		double derivRe[batchSize], derivIm[batchSize];
+		bool active[batchSize];
 
-		for (int64_t iteration = 0; iteration < m_renderConfig.maxIters; iteration++) {
-			z -= f(z) / df(z);
+		for (int64_t start = 0; start < count; start += batchSize) {
+			const int64_t lanes	= lrc::min(batchSize, count - start);
+			int64_t remaining	= lanes;
 
-			for (int64_t i = 0; i < roots.size(); i++) {
-				lrc::Complex<LowPrecision> difference = z - roots[i];
+			for (int64_t lane = 0; lane < lanes; ++lane) {
+				re[lane]			  = coords[start + lane].real();
+				im[lane]			  = coords[start + lane].imag();
+				active[lane]		  = true;
+				results[start + lane] = {0, lrc::Complex<LowPrecision>(0, 0)};
+			}
 
-				// If the current iteration is close enough to a root, color the
-				// pixel.
-				if (lrc::abs(difference.real()) < tolerance &&
-					lrc::abs(difference.imag()) < tolerance) {
-					return std::make_pair(i, z);
+			for (int64_t iteration = 0;
+				 iteration < m_renderConfig.maxIters && remaining > 0;
+				 ++iteration) {
+				// Fused Horner evaluation of the polynomial and its derivative. Lanes
+				// that have already converged are stepped too, but never read again
+				for (int64_t lane = 0; lane < lanes; ++lane) {
+					valueRe[lane] = m_coefficientsLow[0].real();
+					valueIm[lane] = m_coefficientsLow[0].imag();
+					derivRe[lane] = 0;
+					derivIm[lane] = 0;
 				}
-			}
-		}
 
-		return std::make_pair(int64_t(0), lrc::Complex<LowPrecision>(0, 0));
-	}
+				for (size_t term = 1; term < terms; ++term) {
+					const double cRe = m_coefficientsLow[term].real();
+					const double cIm = m_coefficientsLow[term].imag();
 
-	std::pair<int64_t, lrc::Complex<HighPrecision>>
-	NewtonFractal::iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const {
-		// Roots (solutions) of the polynomial
-		static std::vector<lrc::Complex<HighPrecision>> roots = {
-		  lrc::Complex<HighPrecision>(1, 0),
-		  lrc::Complex<HighPrecision>(-.5, sqrt(3) / 2),
-		  lrc::Complex<HighPrecision>(-.5, -sqrt(3) / 2)};
-
-		HighPrecision tolerance = 1e-15;
+					for (int64_t lane = 0; lane < lanes; ++lane) {
+						const double zRe = re[lane];
+						const double zIm = im[lane];
+						const double vRe = valueRe[lane];
+						const double vIm = valueIm[lane];
+						const double dRe = derivRe[lane];
+						const double dIm = derivIm[lane];
 
-		lrc::Complex<HighPrecision> z = coord;
+						// derivative = derivative * z + value, value = value * z + c
+						derivRe[lane] = dRe * zRe - dIm * zIm + vRe;
+						derivIm[lane] = dRe * zIm + dIm * zRe + vIm;
+						valueRe[lane] = vRe * zRe - vIm * zIm + cRe;
+						valueIm[lane] = vRe * zIm + vIm * zRe + cIm;
+					}
+				}
 
-		for (int64_t iteration = 0; iteration < m_renderConfig.maxIters; iteration++) {
-			z -= f(z) / df(z);
+				// z -= value / derivative
+				for (int64_t lane = 0; lane < lanes; ++lane) {
+					const double denom =
+					  derivRe[lane] * derivRe[lane] + derivIm[lane] * derivIm[lane];
+					const double stepRe =
+					  valueRe[lane] * derivRe[lane] + valueIm[lane] * derivIm[lane];
+					const double stepIm =
+					  valueIm[lane] * derivRe[lane] - valueRe[lane] * derivIm[lane];
+					re[lane] -= stepRe / denom;
+					im[lane] -= stepIm / denom;
+				}
 
-			for (int64_t i = 0; i < roots.size(); i++) {
-				lrc::Complex<HighPrecision> difference = z - roots[i];
+				for (int64_t lane = 0; lane < lanes; ++lane) {
+					if (!active[lane]) continue;
 
-				// If the current iteration is close enough to a root, color the
-				// pixel.
-				if (lrc::abs(difference.real()) < tolerance &&
-					lrc::abs(difference.imag()) < tolerance) {
-					return std::make_pair(i, z);
+					for (size_t i = 0; i < m_rootsLow.size(); ++i) {
+						const double diffRe = re[lane] - m_rootsLow[i].real();
+						const double diffIm = im[lane] - m_rootsLow[i].imag();
+						if (diffRe * diffRe + diffIm * diffIm < toleranceSq) {
+							results[start + lane] = {
+							  static_cast<int64_t>(i),
+							  lrc::Complex<LowPrecision>(re[lane], im[lane])};
+							active[lane] = false;
+							--remaining;
+							break;
+						}
+					}
 				}
 			}
 		}
+	}
 
-		return std::make_pair(int64_t(0), lrc::Complex<HighPrecision>(0, 0));
+	std::pair<int64_t, lrc::Complex<HighPrecision>>
+	NewtonFractal::iterCoordHigh(const lrc::Complex<HighPrecision> &coord) const {
+		return newtonIterate(coord,
+							 m_coefficientsHigh,
+							 m_rootsHigh,
+							 HighPrecision(toleranceHigh * toleranceHigh),
+							 m_renderConfig.maxIters);
 	}
 } // namespace frac
@@ -38,4 +38,21 @@ namespace frac::glu {
 		ci::gl::drawLine(ci::vec2(-radius, 0), ci::vec2(radius, 0));
 		ci::gl::popMatrices();
 	}
+
+	void updateTexture(const ci::gl::Texture2dRef &texture, const ci::Surface &surface,
+					   const lrc::Vec2i &topLeft, const lrc::Vec2i &size) {
+		// Textures created from a surface store its rows top down, so texel rows match
+		// surface rows. The rectangle is read in place, with the surface's row length
+		const ci::ivec2 offset((int32_t)topLeft.x(), (int32_t)topLeft.y());
+		glPixelStorei(GL_UNPACK_ROW_LENGTH,
+					  (GLint)(surface.getRowBytes() / surface.getPixelInc()));
+		texture->update(surface.getData(offset),
+						GL_RGBA,
+						GL_UNSIGNED_BYTE,
+						0,
+						(int)size.x(),
+						(int)size.y(),
+						offset);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	}
 } // namespace frac::glu
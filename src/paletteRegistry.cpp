@@ -0,0 +1,48 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	namespace {
+		std::mutex registryMutex;
+		PaletteHandle currentSet;
+		int64_t latestVersion = 0;
+	} // namespace
+
+	PaletteSet::PaletteSet(std::unordered_map<std::string, ColorPalette> palettes,
+						   int64_t version) :
+			m_palettes(std::move(palettes)),
+			m_version(version) {}
+
+	const ColorPalette &PaletteSet::get(const std::string &name) const {
+		auto it = m_palettes.find(name);
+		if (it == m_palettes.end()) return m_empty;
+		return it->second;
+	}
+
+	bool PaletteSet::contains(const std::string &name) const {
+		return m_palettes.find(name) != m_palettes.end();
+	}
+
+	std::vector<std::string> PaletteSet::names() const {
+		std::vector<std::string> ret;
+		for (const auto &[name, palette] : m_palettes) ret.push_back(name);
+		return ret;
+	}
+
+	int64_t PaletteSet::version() const { return m_version; }
+
+	PaletteHandle
+	PaletteRegistry::publish(std::unordered_map<std::string, ColorPalette> palettes) {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		currentSet =
+		  std::make_shared<const PaletteSet>(std::move(palettes), ++latestVersion);
+		return currentSet;
+	}
+
+	PaletteHandle PaletteRegistry::current() {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		if (!currentSet)
+			currentSet = std::make_shared<const PaletteSet>(
+			  std::unordered_map<std::string, ColorPalette> {}, latestVersion);
+		return currentSet;
+	}
+} // namespace frac
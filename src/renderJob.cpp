@@ -0,0 +1,30 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	RenderHandle::RenderHandle(std::shared_ptr<const RenderJob> job,
+							   std::shared_ptr<RenderProgress> progress) :
+			m_job(std::move(job)),
+			m_progress(std::move(progress)),
+			m_future(m_progress->finished.get_future().share()) {}
+
+	bool RenderHandle::valid() const { return m_job != nullptr; }
+
+	const RenderJob &RenderHandle::job() const { return *m_job; }
+
+	double RenderHandle::progress() const {
+		if (!m_progress || m_progress->boxesTotal == 0) return 1;
+		return (double)m_progress->boxesDone.load() / (double)m_progress->boxesTotal;
+	}
+
+	bool RenderHandle::finished() const {
+		if (!m_future.valid()) return true;
+		return m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	bool RenderHandle::wait() const {
+		if (!m_future.valid()) return false;
+		return m_future.get();
+	}
+
+	const std::shared_future<bool> &RenderHandle::future() const { return m_future; }
+} // namespace frac
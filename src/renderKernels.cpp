@@ -0,0 +1,50 @@
+#include <fractal/fractal.hpp>
+
+namespace frac::kernels {
+	namespace {
+		// Kernels keyed by fractal name and colouring function name
+		using Registry = std::map<std::pair<std::string, std::string>, KernelSet>;
+
+		template<typename Iteration, typename Coloring>
+		KernelSet makeKernelSet() {
+			return {{&pixelKernel<Iteration, Coloring, LowPrecision, false>,
+					 &pixelKernel<Iteration, Coloring, LowPrecision, true>},
+					{&pixelKernel<Iteration, Coloring, HighPrecision, false>,
+					 &pixelKernel<Iteration, Coloring, HighPrecision, true>}};
+		}
+
+		// Register every colouring function offered by an escape-time fractal
+		template<typename Iteration>
+		void addEscapeTimeKernels(Registry &registry, const std::string &fractal) {
+			registry[{fractal, "Logarithmic Scaling"}] =
+			  makeKernelSet<Iteration, LogarithmicScaling>();
+			registry[{fractal, "Paletted Logarithmic Scaling"}] =
+			  makeKernelSet<Iteration, PalettedLogarithmicScaling>();
+			registry[{fractal, "Stepped Gradients"}] =
+			  makeKernelSet<Iteration, SteppedGradients>();
+			registry[{fractal, "Fixed Iteration Palette"}] =
+			  makeKernelSet<Iteration, FixedIterPalette>();
+		}
+	} // namespace
+
+	const KernelSet *findKernels(const std::string &fractal,
+								 const std::string &colorFunc) {
+		// Names match Fractal::name() and the keys of getLowPrecColoringAlgorithms().
+		// Newton's fractal is not specialised, so it always uses the virtual methods
+		static const auto registry = []() {
+			Registry result;
+			addEscapeTimeKernels<MandelbrotIteration>(result, "Mandelbrot");
+			addEscapeTimeKernels<JuliaIteration>(result, "Julia Set");
+			addEscapeTimeKernels<PowerIteration<3, false>>(result, "Multibrot 3");
+			addEscapeTimeKernels<PowerIteration<4, false>>(result, "Multibrot 4");
+			addEscapeTimeKernels<PowerIteration<5, false>>(result, "Multibrot 5");
+			addEscapeTimeKernels<PowerIteration<2, true>>(result, "Burning Ship");
+			addEscapeTimeKernels<PowerIteration<3, true>>(result, "Burning Ship 3");
+			return result;
+		}();
+
+		auto it = registry.find({fractal, colorFunc});
+		if (it == registry.end()) return nullptr;
+		return &it->second;
+	}
+} // namespace frac::kernels
@@ -0,0 +1,98 @@
+#include <fractal/fractal.hpp>
+
+namespace frac {
+	StreamRenderer::StreamRenderer(FractalRenderer &renderer, int64_t bandBudget) :
+			m_renderer(renderer), m_bandBudget(bandBudget) {}
+
+	int64_t StreamRenderer::bandHeight() const {
+		const RenderConfig &config = m_renderer.config();
+
+		// Surfaces are stored as 8-bit RGBA, so each row costs width * 4 bytes
+		const int64_t rowBytes = config.imageSize.x() * 4;
+		int64_t rows		   = lrc::max(int64_t(1), m_bandBudget / rowBytes);
+
+		// Keep whole render boxes in each band where possible, so no box is split
+		// across two bands
+		const int64_t boxHeight = config.boxSize.y();
+		if (rows > boxHeight) rows -= rows % boxHeight;
+
+		return lrc::min(rows, config.imageSize.y());
+	}
+
+	bool StreamRenderer::render(ImageStreamWriter &writer) {
+		// Take a copy of the full-image view, since it is modified for each band
+		const RenderConfig fullConfig = m_renderer.config();
+		const int64_t imageWidth	  = fullConfig.imageSize.x();
+		const int64_t imageHeight	  = fullConfig.imageSize.y();
+		const int64_t rowsPerBand	  = bandHeight();
+		const int64_t firstRow		  = writer.rowsWritten();
+
+		FRAC_LOG(fmt::format("Streaming {}x{} image in bands of {} rows, from row {}",
+							 imageWidth,
+							 imageHeight,
+							 rowsPerBand,
+							 firstRow));
+
+		const double start = lrc::now();
+		bool success	   = true;
+
+		for (int64_t row = firstRow; row < imageHeight; row += rowsPerBand) {
+			const int64_t rows = lrc::min(rowsPerBand, imageHeight - row);
+
+			// Only reallocate the surface when the band size changes (i.e. for the
+			// first and final bands)
+			m_renderer.config() = bandConfig(fullConfig, row, rows);
+			m_renderer.updateRenderConfig();
+			if (m_renderer.surface().getHeight() != rows ||
+				m_renderer.surface().getWidth() != imageWidth)
+				m_renderer.regenerateSurface();
+
+			m_renderer.renderFractal();
+			m_renderer.waitForRender();
+
+			if (!writer.writeRows(m_renderer.surface(), rows)) {
+				FRAC_ERROR(fmt::format("Failed to write band starting at row {}", row));
+				success = false;
+				break;
+			}
+
+			// Progress report
+			const int64_t done		= row + rows;
+			const double elapsed	= lrc::now() - start;
+			const double rowsPerSec = (double)(done - firstRow) / elapsed;
+			const double remaining	= (double)(imageHeight - done) / rowsPerSec;
+			fmt::print("\r[{:6.2f}%] {} / {} rows | {:.1f} rows/s | ETA {}   ",
+					   100.0 * (double)done / (double)imageHeight,
+					   done,
+					   imageHeight,
+					   rowsPerSec,
+					   lrc::formatTime(remaining));
+			std::fflush(stdout);
+		}
+
+		fmt::print("\n");
+
+		// Restore the full-image view. The surface is deliberately left at band size,
+		// since allocating the full image is exactly what streaming avoids
+		m_renderer.config() = fullConfig;
+		m_renderer.updateRenderConfig();
+
+		return success;
+	}
+
+	RenderConfig StreamRenderer::bandConfig(const RenderConfig &fullConfig,
+											int64_t firstRow, int64_t rows) {
+		// Fractal-space height of a single pixel row
+		const HighPrecision rowStep =
+		  fullConfig.fracSize.y() / static_cast<HighPrecision>(fullConfig.imageSize.y());
+
+		RenderConfig config = fullConfig;
+		config.imageSize	= lrc::Vec2i(fullConfig.imageSize.x(), rows);
+		config.fracTopLeft	= HighVec2(fullConfig.fracTopLeft.x(),
+									   fullConfig.fracTopLeft.y() +
+										 rowStep * static_cast<HighPrecision>(firstRow));
+		config.fracSize		= HighVec2(fullConfig.fracSize.x(),
+									   rowStep * static_cast<HighPrecision>(rows));
+		return config;
+	}
+} // namespace frac
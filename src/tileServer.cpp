@@ -0,0 +1,541 @@
+#include <fractal/fractal.hpp>
+
+#if !defined(_WIN32)
+#	include <arpa/inet.h>
+#	include <netinet/in.h>
+#	include <signal.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+
+namespace frac {
+#if !defined(_WIN32)
+	namespace {
+		// Connections beyond this limit are turned away with "503 Service Unavailable"
+		constexpr int64_t maxConnections = 512;
+
+		// Number of recent request latencies kept for the percentile statistics
+		constexpr size_t latencyWindow = 16384;
+
+		// Deeper tiles are rendered in high precision (see TileServer::renderTile), but
+		// the tile coordinates themselves must not overflow
+		constexpr int64_t deepestZoom = 62;
+
+		// Bits of precision kept beyond the spacing of a tile's pixels, so rounding the
+		// coordinates of neighbouring pixels never merges them
+		constexpr int64_t guardBits = 16;
+
+		bool sendAll(int socket, const void *data, size_t bytes) {
+			const auto *ptr = static_cast<const char *>(data);
+			while (bytes > 0) {
+				ssize_t sent = ::send(socket, ptr, bytes, MSG_NOSIGNAL);
+				if (sent < 0 && errno == EINTR) continue;
+				if (sent <= 0) return false;
+				ptr += sent;
+				bytes -= static_cast<size_t>(sent);
+			}
+			return true;
+		}
+
+		bool sendResponse(int socket, const std::string &status,
+						  const std::string &contentType, const void *body,
+						  size_t bytes) {
+			std::string header = fmt::format("HTTP/1.1 {}\r\n"
+											 "Content-Type: {}\r\n"
+											 "Content-Length: {}\r\n"
+											 "Access-Control-Allow-Origin: *\r\n"
+											 "Connection: close\r\n\r\n",
+											 status,
+											 contentType,
+											 bytes);
+			return sendAll(socket, header.data(), header.size()) &&
+				   sendAll(socket, body, bytes);
+		}
+
+		bool sendText(int socket, const std::string &status, const std::string &text) {
+			return sendResponse(socket, status, "text/plain", text.data(), text.size());
+		}
+
+		/// Check whether the peer is still connected, without consuming any data
+		bool clientConnected(int socket) {
+			char byte;
+			ssize_t received = ::recv(socket, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+			if (received > 0) return true;
+			if (received == 0) return false; // Orderly shutdown
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		}
+
+		/// Parse a path of the form /{z}/{x}/{y}, optionally followed by an extension
+		/// or query string
+		bool parseTilePath(const std::string &path, TileKey &key) {
+			std::string trimmed = path.substr(0, path.find_first_of(".?"));
+			std::replace(trimmed.begin(), trimmed.end(), '/', ' ');
+
+			std::istringstream stream(trimmed);
+			std::string rest;
+			if (!(stream >> key.z >> key.x >> key.y) || (stream >> rest)) return false;
+
+			if (key.z < 0 || key.z > deepestZoom) return false;
+			const int64_t tilesPerSide = int64_t(1) << key.z;
+			return key.x >= 0 && key.x < tilesPerSide && key.y >= 0 &&
+				   key.y < tilesPerSide;
+		}
+
+		/// Connect to the tile server on the loopback interface
+		int connectLocal(int64_t port) {
+			int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+			if (sock < 0) return -1;
+
+			sockaddr_in addr {};
+			addr.sin_family		 = AF_INET;
+			addr.sin_port		 = htons((uint16_t)port);
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+			if (::connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+				::close(sock);
+				return -1;
+			}
+			return sock;
+		}
+
+		/// The value below which \p fraction of the sorted samples fall
+		double percentile(const std::vector<double> &sorted, double fraction) {
+			if (sorted.empty()) return 0;
+			return sorted[(size_t)(fraction * (double)(sorted.size() - 1))];
+		}
+	} // namespace
+#endif
+
+	TileServer::TileServer(FractalRenderer &renderer, int64_t port, int64_t tileSize,
+						   int64_t cacheSize) :
+			m_renderer(renderer),
+			m_port(port),
+			m_tileSize(lrc::max(int64_t(1), tileSize)),
+			m_cacheSize(lrc::max(int64_t(0), cacheSize)) {
+		// Tiles are square, so expand the configured view to a square about its center
+		const RenderConfig &config = m_renderer.config();
+		const HighVec2 &size	   = config.fracSize;
+		const HighVec2 center	   = config.fracTopLeft + size / HighVec2(2, 2);
+
+		m_rootSize		= size.x() > size.y() ? size.x() : size.y();
+		m_rootTopLeft	= center - HighVec2(m_rootSize, m_rootSize) / HighVec2(2, 2);
+		m_basePrecision = config.precision;
+
+		m_latencies.reserve(latencyWindow);
+	}
+
+	TileServer::~TileServer() {
+		m_running = false;
+		m_workAvailable.notify_all();
+		if (m_dispatcher.joinable()) m_dispatcher.join();
+	}
+
+	int TileServer::run() {
+#if defined(_WIN32)
+		FRAC_ERROR("The tile server is only supported on POSIX systems");
+		return 1;
+#else
+		signal(SIGPIPE, SIG_IGN);
+
+		int server = ::socket(AF_INET, SOCK_STREAM, 0);
+		if (server < 0) {
+			FRAC_ERROR(fmt::format("socket() failed: {}", std::strerror(errno)));
+			return 1;
+		}
+
+		int reuse = 1;
+		setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		sockaddr_in addr {};
+		addr.sin_family		 = AF_INET;
+		addr.sin_port		 = htons((uint16_t)m_port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if (::bind(server, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+			::listen(server, 128) != 0) {
+			FRAC_ERROR(fmt::format(
+			  "Failed to listen on port {}: {}", m_port, std::strerror(errno)));
+			::close(server);
+			return 1;
+		}
+
+		// Every tile is rendered at the same size, so the surface is only allocated once
+		m_renderer.config().imageSize = lrc::Vec2i(m_tileSize, m_tileSize);
+		m_renderer.updateRenderConfig();
+		m_renderer.regenerateSurface();
+
+		m_startTime	 = lrc::now();
+		m_running	 = true;
+		m_dispatcher = std::thread(&TileServer::dispatchLoop, this);
+
+		fmt::print("Serving {}x{} tiles at http://127.0.0.1:{}/{{z}}/{{x}}/{{y}}\n",
+				   m_tileSize,
+				   m_tileSize,
+				   m_port);
+
+		while (m_running) {
+			int client = ::accept(server, nullptr, nullptr);
+			if (client < 0) {
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				FRAC_ERROR(fmt::format("accept() failed: {}", std::strerror(errno)));
+				break;
+			}
+
+			if (m_activeConnections >= maxConnections) {
+				sendText(client, "503 Service Unavailable", "Too many connections\n");
+				::close(client);
+				continue;
+			}
+
+			++m_activeConnections;
+			std::thread([this, client]() {
+				handleConnection(client);
+				--m_activeConnections;
+			}).detach();
+		}
+
+		::close(server);
+
+		// Connection threads refer to this object, so wait for them to finish before
+		// returning
+		m_running = false;
+		m_workAvailable.notify_all();
+		if (m_dispatcher.joinable()) m_dispatcher.join();
+		while (m_activeConnections > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+		return 1;
+#endif
+	}
+
+	TileServer::TileData TileServer::requestTile(const TileKey &key, int client) {
+#if defined(_WIN32)
+		return nullptr;
+#else
+		std::shared_ptr<Tile> tile;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_requests;
+
+			auto cached = m_cacheIndex.find(key);
+			if (cached != m_cacheIndex.end()) {
+				m_cache.splice(m_cache.begin(), m_cache, cached->second);
+				++m_cacheHits;
+				return m_cache.front().second;
+			}
+
+			// Join an existing render of this tile if there is one
+			auto it = m_tiles.find(key);
+			if (it != m_tiles.end()) {
+				tile = it->second;
+				++m_coalesced;
+			} else {
+				tile		 = std::make_shared<Tile>();
+				tile->key	 = key;
+				tile->result = tile->promise.get_future().share();
+				m_tiles[key] = tile;
+			}
+
+			tile->waiters += 1;
+			tile->lastRequested = ++m_requestCounter;
+		}
+
+		m_workAvailable.notify_one();
+
+		while (tile->result.wait_for(std::chrono::milliseconds(20)) !=
+			   std::future_status::ready) {
+			if (m_running && clientConnected(client)) continue;
+
+			// The client has gone away (or the server is stopping). If nobody else
+			// wants the tile and it has not been started yet, drop it from the queue.
+			// Tiles already being rendered are small enough that they are left to
+			// finish and be cached instead
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto queued = m_tiles.find(tile->key);
+			if (--tile->waiters == 0 && !tile->rendering && queued != m_tiles.end() &&
+				queued->second == tile) {
+				m_tiles.erase(queued);
+				tile->promise.set_value(nullptr);
+				++m_cancelled;
+			}
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		tile->waiters -= 1;
+		return tile->result.get();
+#endif
+	}
+
+	void TileServer::dispatchLoop() {
+		auto hasQueuedTile = [this]() {
+			for (const auto &[key, tile] : m_tiles) {
+				if (!tile->rendering) return true;
+			}
+			return false;
+		};
+
+		while (true) {
+			std::shared_ptr<Tile> tile;
+
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_workAvailable.wait(lock,
+									 [&]() { return !m_running || hasQueuedTile(); });
+				if (!m_running) break;
+
+				// Render the most recently requested tile first. When panning or zooming,
+				// this is the part of the map the user is looking at now, rather than
+				// somewhere they have already moved away from
+				for (const auto &[key, queued] : m_tiles) {
+					if (queued->rendering) continue;
+					if (!tile || queued->lastRequested > tile->lastRequested) {
+						tile = queued;
+					}
+				}
+				tile->rendering = true;
+			}
+
+			TileData data = renderTile(tile->key);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_tiles.erase(tile->key);
+				m_cache.emplace_front(tile->key, data);
+				m_cacheIndex[tile->key] = m_cache.begin();
+				while ((int64_t)m_cache.size() > m_cacheSize) {
+					m_cacheIndex.erase(m_cache.back().first);
+					m_cache.pop_back();
+				}
+				++m_tilesRendered;
+			}
+
+			tile->promise.set_value(data);
+		}
+
+		// Release anybody still waiting on a queued tile
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto &[key, tile] : m_tiles) tile->promise.set_value(nullptr);
+		m_tiles.clear();
+	}
+
+	TileServer::TileData TileServer::renderTile(const TileKey &key) {
+		// Telling neighbouring samples apart takes log2(magnitude / spacing) bits,
+		// where the magnitude is that of the largest coordinate in the tile. Orbits
+		// reach a magnitude of 2 before they escape, so it is never taken as less.
+		// Once a double cannot hold that many bits, the tile is iterated in high
+		// precision. Anything up to 64 bits is iterated in double precision
+		RenderConfig &config	= m_renderer.config();
+		const double rootSize	= static_cast<double>(m_rootSize);
+		const double tileExtent	= rootSize / std::ldexp(1.0, (int)key.z);
+		const double sampleStep	= tileExtent / (double)m_tileSize /
+								  (double)lrc::max(int64_t(1), config.antiAlias);
+
+		double magnitude = 2;
+		for (int64_t corner = 0; corner < 4; ++corner) {
+			const double re = static_cast<double>(m_rootTopLeft.x()) +
+							  tileExtent * (double)(key.x + (corner & 1));
+			const double im = static_cast<double>(m_rootTopLeft.y()) +
+							  tileExtent * (double)(key.y + (corner >> 1));
+			magnitude = lrc::max(magnitude, lrc::max(std::abs(re), std::abs(im)));
+		}
+
+		const int64_t bits =
+		  (int64_t)std::ceil(std::log2(magnitude / sampleStep)) + guardBits;
+
+		config.precision = m_basePrecision;
+		if (bits > std::numeric_limits<double>::digits)
+			config.precision = lrc::max(config.precision, lrc::max(bits, int64_t(65)));
+		lrc::prec2(config.precision);
+		m_renderer.updateConfigPrecision();
+
+		// The corner is computed at the tile's precision, since it is a multiple of the
+		// tile size away from the root corner
+		const int64_t prec		 = config.precision;
+		const auto tilesPerSide	 = static_cast<HighPrecision>(int64_t(1) << key.z);
+		const HighPrecision size = HighPrecision(m_rootSize, prec) / tilesPerSide;
+		const HighVec2 root(HighPrecision(m_rootTopLeft.x(), prec),
+							HighPrecision(m_rootTopLeft.y(), prec));
+		const HighVec2 offset(size * static_cast<HighPrecision>(key.x),
+							  size * static_cast<HighPrecision>(key.y));
+
+		m_renderer.moveFractalCorner(root + offset, HighVec2(size, size));
+		m_renderer.renderFractal();
+		m_renderer.waitForRender();
+
+		auto data = std::make_shared<std::vector<uint8_t>>();
+		ImageStreamWriter::encodeBMP(m_renderer.surface(), *data);
+		return data;
+	}
+
+	void TileServer::handleConnection(int client) {
+#if !defined(_WIN32)
+		const double start = lrc::now();
+
+		std::string request;
+		char buffer[1024];
+		while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+			ssize_t received = ::recv(client, buffer, sizeof(buffer), 0);
+			if (received < 0 && errno == EINTR) continue;
+			if (received <= 0) break;
+			request.append(buffer, received);
+		}
+
+		std::istringstream requestLine(request);
+		std::string method;
+		std::string path;
+		requestLine >> method >> path;
+
+		TileKey key {};
+		if (method != "GET") {
+			sendText(client, "405 Method Not Allowed", "Only GET is supported\n");
+		} else if (path == "/stats") {
+			std::string stats = statsJson();
+			sendResponse(
+			  client, "200 OK", "application/json", stats.data(), stats.size());
+		} else if (!parseTilePath(path, key)) {
+			sendText(client, "404 Not Found", "Expected /{z}/{x}/{y}\n");
+		} else if (TileData data = requestTile(key, client)) {
+			if (sendResponse(client, "200 OK", "image/bmp", data->data(), data->size())) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				const double latency = lrc::now() - start;
+				if (m_latencies.size() < latencyWindow) {
+					m_latencies.push_back(latency);
+				} else {
+					m_latencies[m_latencyIndex] = latency;
+				}
+				m_latencyIndex = (m_latencyIndex + 1) % latencyWindow;
+			}
+		}
+
+		::close(client);
+#endif
+	}
+
+	std::string TileServer::statsJson() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::vector<double> sorted = m_latencies;
+		std::sort(sorted.begin(), sorted.end());
+
+		const double elapsed = lrc::now() - m_startTime;
+
+		int64_t queued = 0;
+		for (const auto &[key, tile] : m_tiles) queued += tile->rendering ? 0 : 1;
+
+		json stats;
+		stats["uptime"]			= elapsed;
+		stats["requests"]		= m_requests;
+		stats["requestsPerSec"] = (double)m_requests / elapsed;
+		stats["tilesRendered"]	= m_tilesRendered;
+		stats["cacheHits"]		= m_cacheHits;
+		stats["coalesced"]		= m_coalesced;
+		stats["cancelled"]		= m_cancelled;
+		stats["queued"]			= queued;
+		stats["cachedTiles"]	= m_cache.size();
+		stats["latencyP50"]		= percentile(sorted, 0.50);
+		stats["latencyP99"]		= percentile(sorted, 0.99);
+		return stats.dump(4);
+	}
+
+	int TileServer::runLoadTest(int64_t port, int64_t clients, double duration,
+								int64_t maxZoom) {
+#if defined(_WIN32)
+		FRAC_ERROR("The tile server is only supported on POSIX systems");
+		return 1;
+#else
+		signal(SIGPIPE, SIG_IGN);
+
+		std::mutex resultMutex;
+		std::vector<double> latencies;
+		int64_t failures = 0;
+		int64_t bytes	 = 0;
+
+		const double start = lrc::now();
+
+		auto client = [&](int64_t seed) {
+			std::mt19937_64 rng(seed);
+			std::vector<double> localLatencies;
+			int64_t localFailures = 0;
+			int64_t localBytes	  = 0;
+			std::vector<char> buffer(1 << 16);
+
+			while (lrc::now() - start < duration) {
+				// Request tiles in a small window around the center of each zoom
+				// level, the way a map viewer zooming into one spot would. This gives a
+				// realistic mix of cache hits, coalesced requests and fresh renders
+				const int64_t z		 = (int64_t)(rng() % (uint64_t)(maxZoom + 1));
+				const int64_t side	 = int64_t(1) << z;
+				const int64_t window = lrc::min(side, int64_t(4));
+				const int64_t first	 = (side - window) / 2;
+				const int64_t x		 = first + (int64_t)(rng() % (uint64_t)window);
+				const int64_t y		 = first + (int64_t)(rng() % (uint64_t)window);
+
+				const double requestStart = lrc::now();
+				int sock				  = connectLocal(port);
+				if (sock < 0) {
+					++localFailures;
+					continue;
+				}
+
+				std::string request = fmt::format(
+				  "GET /{}/{}/{} HTTP/1.1\r\nHost: localhost\r\n\r\n", z, x, y);
+				if (!sendAll(sock, request.data(), request.size())) {
+					::close(sock);
+					++localFailures;
+					continue;
+				}
+
+				// The server closes the connection once the response is complete
+				int64_t received = 0;
+				bool ok			 = false;
+				while (true) {
+					ssize_t n = ::recv(sock, buffer.data(), buffer.size(), 0);
+					if (n < 0 && errno == EINTR) continue;
+					if (n <= 0) break;
+					if (received == 0)
+						ok = std::strncmp(buffer.data(), "HTTP/1.1 200", 12) == 0;
+					received += n;
+				}
+				::close(sock);
+
+				if (ok) {
+					localLatencies.push_back(lrc::now() - requestStart);
+					localBytes += received;
+				} else {
+					++localFailures;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(resultMutex);
+			latencies.insert(
+			  latencies.end(), localLatencies.begin(), localLatencies.end());
+			failures += localFailures;
+			bytes += localBytes;
+		};
+
+		std::vector<std::thread> threads;
+		for (int64_t i = 0; i < clients; ++i) threads.emplace_back(client, i + 1);
+		for (auto &thread : threads) thread.join();
+
+		const double elapsed = lrc::now() - start;
+		std::sort(latencies.begin(), latencies.end());
+
+		fmt::print("Requests:   {} ok, {} failed ({} clients, {:.1f}s)\n",
+				   latencies.size(),
+				   failures,
+				   clients,
+				   elapsed);
+		fmt::print("Throughput: {:.1f} tiles/s, {:.2f} MiB/s\n",
+				   (double)latencies.size() / elapsed,
+				   (double)bytes / elapsed / (1024.0 * 1024.0));
+		fmt::print("Latency:    p50 {} | p99 {} | max {}\n",
+				   lrc::formatTime(percentile(latencies, 0.50)),
+				   lrc::formatTime(percentile(latencies, 0.99)),
+				   lrc::formatTime(latencies.empty() ? 0.0 : latencies.back()));
+
+		return latencies.empty() ? 1 : 0;
+#endif
+	}
+} // namespace frac
@@ -0,0 +1,137 @@
+#include <fractal/fractal.hpp>
+
+#if defined(__linux__)
+#	include <sched.h>
+#endif
+
+namespace frac::topology {
+	namespace {
+		// Logical CPUs the process is allowed to run on, in ascending order
+		std::vector<int64_t> usableCpus() {
+			std::vector<int64_t> cpus;
+
+#if defined(__linux__)
+			cpu_set_t mask;
+			CPU_ZERO(&mask);
+			if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+				for (int64_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+					if (CPU_ISSET(cpu, &mask)) cpus.push_back(cpu);
+				}
+			}
+#endif
+
+			if (cpus.empty()) {
+				const int64_t count =
+				  lrc::max(int64_t(1), (int64_t)std::thread::hardware_concurrency());
+				for (int64_t cpu = 0; cpu < count; ++cpu) cpus.push_back(cpu);
+			}
+
+			return cpus;
+		}
+
+		// Parse a kernel CPU list, such as "0-7,16-23"
+		std::vector<int64_t> parseCpuList(const std::string &list) {
+			std::vector<int64_t> cpus;
+			std::stringstream stream(list);
+			std::string range;
+
+			while (std::getline(stream, range, ',')) {
+				if (range.empty() || !std::isdigit((unsigned char)range[0])) continue;
+
+				const size_t dash	= range.find('-');
+				const int64_t first = std::stoll(range.substr(0, dash));
+				const int64_t last =
+				  dash == std::string::npos ? first : std::stoll(range.substr(dash + 1));
+				for (int64_t cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+			}
+
+			return cpus;
+		}
+	} // namespace
+
+	std::vector<NumaNode> detect() {
+		const std::vector<int64_t> usable = usableCpus();
+		std::vector<NumaNode> nodes;
+
+#if defined(__linux__)
+		const std::filesystem::path nodeDir("/sys/devices/system/node");
+		for (int64_t id = 0;; ++id) {
+			std::ifstream file(nodeDir / fmt::format("node{}", id) / "cpulist");
+			if (!file.is_open()) break;
+
+			std::string list;
+			std::getline(file, list);
+
+			NumaNode node {id, {}};
+			for (int64_t cpu : parseCpuList(list)) {
+				if (std::binary_search(usable.begin(), usable.end(), cpu))
+					node.cpus.push_back(cpu);
+			}
+
+			if (!node.cpus.empty()) nodes.push_back(std::move(node));
+		}
+#endif
+
+		if (nodes.empty()) nodes.push_back({0, usable});
+		return nodes;
+	}
+
+	std::vector<NumaNode> simulate(int64_t nodes) {
+		const std::vector<int64_t> usable = usableCpus();
+		const int64_t count = std::clamp(nodes, int64_t(1), (int64_t)usable.size());
+
+		std::vector<NumaNode> result;
+		for (int64_t id = 0; id < count; ++id) {
+			// Contiguous ranges, as sibling cores usually are
+			const size_t first = usable.size() * id / count;
+			const size_t last  = usable.size() * (id + 1) / count;
+			result.push_back({id, {usable.begin() + first, usable.begin() + last}});
+		}
+
+		return result;
+	}
+
+	bool pinCurrentThread(int64_t cpu) {
+#if defined(__linux__)
+		if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+
+		cpu_set_t mask;
+		CPU_ZERO(&mask);
+		CPU_SET(cpu, &mask);
+
+		// On Linux, a pid of 0 applies to the calling thread only
+		return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+		return false;
+#endif
+	}
+
+	std::string describe(const std::vector<NumaNode> &nodes) {
+		std::string result =
+		  fmt::format("{} node{}:", nodes.size(), nodes.size() == 1 ? "" : "s");
+
+		for (const auto &node : nodes) {
+			result += " [";
+
+			// Collapse consecutive CPUs into ranges
+			for (size_t i = 0; i < node.cpus.size();) {
+				size_t j = i;
+				while (j + 1 < node.cpus.size() && node.cpus[j + 1] == node.cpus[j] + 1)
+					++j;
+
+				if (i > 0) result += ",";
+				if (i == j) {
+					result += fmt::format("{}", node.cpus[i]);
+				} else {
+					result += fmt::format("{}-{}", node.cpus[i], node.cpus[j]);
+				}
+
+				i = j + 1;
+			}
+
+			result += "]";
+		}
+
+		return result;
+	}
+} // namespace frac::topology